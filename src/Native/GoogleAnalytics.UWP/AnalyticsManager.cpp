@@ -4,10 +4,16 @@
 //
 
 #include "pch.h"
+#include <algorithm>
 #include "AnalyticsManager.h"
 #include "TimeSpanHelper.h"
 #include "DateTimeHelper.h"
+#include "TimeSource.h"
 #include "HitBuilder.h"
+#include "HitBatcher.h"
+#include "PayloadEncoder.h"
+#include "GzipEncoder.h"
+#include "HitValidator.h"
 
 using namespace GoogleAnalytics;
 using namespace Platform;
@@ -23,6 +29,75 @@ using namespace Windows::Networking::Connectivity;
 using namespace Windows::ApplicationModel;
 using namespace Windows::ApplicationModel::Core;
 
+namespace
+{
+	// how many hits of each HitPriority, in order, are taken per turn when the queues are drained
+	const size_t PriorityWeights[] = { 16, 4, 1 };
+
+	const size_t PriorityCount = sizeof(PriorityWeights) / sizeof(PriorityWeights[0]);
+
+	// the largest payload Google Analytics accepts for a single hit
+	const size_t MaxPayloadSize = 8192;
+
+	// the transport calls back on a thread of its own; dispatching carries on from a task
+	task<HitResponse> RequestAsync(std::function<void(IHitTransport::ResponseHandler)> request)
+	{
+		task_completion_event<HitResponse> completed;
+		request([completed](const HitResponse& response) { completed.set(response); });
+		return create_task(completed);
+	}
+
+	String^ ToPlatformString(const std::wstring& text)
+	{
+		return ref new String(text.c_str(), (unsigned int)text.size());
+	}
+
+	// counts a thread using the current ring of a queue for as long as it is in scope
+	class RingUse
+	{
+	public:
+		explicit RingUse(std::atomic<int>& users)
+			: users(users)
+		{
+			users++;
+		}
+
+		~RingUse()
+		{
+			users--;
+		}
+
+	private:
+		std::atomic<int>& users;
+	};
+
+	// takes the hits of the trackers the manager creates, with the tracker level parameters kept apart
+	class TrackerHitSink : public ITrackerHitSink
+	{
+	public:
+		explicit TrackerHitSink(AnalyticsManager^ manager)
+			: manager(manager)
+		{
+		}
+
+		virtual void EnqueueTrackerHit(std::shared_ptr<const HitRecord> trackerParameters, IMap<String^, String^>^ params) override
+		{
+			manager->EnqueueTrackerHit(std::move(trackerParameters), params);
+		}
+
+	private:
+		AnalyticsManager^ manager;
+	};
+
+	// frees the retired rings, all but the last, once drained; with no thread using a ring, none can still be pushing to a retired one
+	template <typename T>
+	void ReleaseRetiredRings(std::vector<std::unique_ptr<IngestionRing<T>>>& rings, const std::atomic<int>& users)
+	{
+		if (rings.size() < 2 || users.load() != 0) return;
+		rings.erase(std::remove_if(begin(rings), end(rings) - 1, [](const std::unique_ptr<IngestionRing<T>>& ring) { return ring->Size() == 0; }), end(rings) - 1);
+	}
+}
+
 String^ AnalyticsManager::Key_AppOptOut = "GoogleAnaltyics.AppOptOut";
 
 AnalyticsManager^ AnalyticsManager::current = nullptr;
@@ -35,6 +110,10 @@ Uri^ AnalyticsManager::endPointUnsecure = ref new Uri("http://www.google-analyti
 
 Uri^ AnalyticsManager::endPointSecure = ref new Uri("https://ssl.google-analytics.com/collect");
 
+Uri^ AnalyticsManager::endPointUnsecureBatch = ref new Uri("http://www.google-analytics.com/batch");
+
+Uri^ AnalyticsManager::endPointSecureBatch = ref new Uri("https://ssl.google-analytics.com/batch");
+
 AnalyticsManager^ AnalyticsManager::Current::get()
 {
 	if (!current)
@@ -46,20 +125,55 @@ AnalyticsManager^ AnalyticsManager::Current::get()
 
 AnalyticsManager::AnalyticsManager(GoogleAnalytics::IPlatformInfoProvider^ platformInfoProvider) :
 	isEnabled(true),
-	timer(nullptr),
-	hitTokenBucket(ref new TokenBucket(60, .5)),
+	hitTokenBucket(60, .5),
+	flushPolicy(20, 64 * 1024, 0),
+	flushTimer(nullptr),
+	flushDue(0),
 	reportUncaughtExceptions(false),
 	autoTrackNetworkConnectivity(false),
 	autoAppLifetimeMonitoring(false),
 	fireEventsOnUIThread(false),
 	dispatcher(nullptr),
-	hitSentListenerCount(0), hitMalformedListenerCount(0), hitFailedListenerCount(0)
+	hitSentListenerCount(0), hitMalformedListenerCount(0), hitFailedListenerCount(0), hitDroppedListenerCount(0), hitsCompletedListenerCount(0),
+	isUIActionPosted(false),
+	transportIsSecure(false),
+	maxConnections(2),
+	useHttp2(false),
+	maxConcurrentRequests(2),
+	maxConcurrentStreams(16),
+	connectionIdleTimeout(TimeSpanHelper::FromSeconds(60)),
+	counters(std::make_shared<DispatchCounters>()),
+	scheduler(std::make_shared<DispatchScheduler>(2, counters)),
+	ingestionUsers(0),
+	overflowPolicy(QueueOverflowPolicy::DropOldest),
+	isDrainScheduled(false),
+	captureUsers(0),
+	isPreparing(false),
+	aggregationDue(0),
+	isConnected(true),
+	isDeferringLowPriority(false),
+	isDrainingBacklog(false),
+	backlogBucket(20, 5),
+	offlineQueueLimit(1000),
+	payloadPolicy(OversizedPayloadPolicy::Truncate),
+	maxGetPayloadSize(2000),
+	queuedBytes(0),
+	queuedClassBytes(),
+	queueMemoryLimit(2 * 1024 * 1024),
+	evictionPolicy(QueueEvictionPolicy::DropLowestPriority)
 {
+	ingestionRings.push_back(std::make_unique<IngestionRing<Hit^>>(4096));
+	ingestion.store(ingestionRings.back().get());
+	captureRings.push_back(std::make_unique<IngestionRing<CapturedHit>>(1024));
+	capture.store(captureRings.back().get());
+
 	this->platformTrackingInfo = platformInfoProvider;
 	DefaultTracker = nullptr;
 	AppOptOut = false;
 	IsSecure = true;
 	PostData = true;
+	BatchDispatch = false;
+	CompressPostData = false;
 	BustCache = false;
 	dispatchPeriod = TimeSpanHelper::FromTicks(0);
 }
@@ -68,7 +182,7 @@ Tracker^ AnalyticsManager::CreateTracker(String^ propertyId)
 {
 	if (trackers.find(propertyId) == end(trackers))
 	{
-		auto tracker = ref new Tracker(propertyId, platformTrackingInfo, this);
+		auto tracker = ref new Tracker(propertyId, platformTrackingInfo, std::make_shared<TrackerHitSink>(this));
 		tracker->AppName = Package::Current->Id->Name;
 		tracker->AppVersion = Package::Current->Id->Version.Major.ToString() + "." + Package::Current->Id->Version.Minor.ToString() + "." + Package::Current->Id->Version.Build.ToString() + "." + Package::Current->Id->Version.Revision.ToString();
 
@@ -99,334 +213,1672 @@ TimeSpan AnalyticsManager::DispatchPeriod::get()
 	return dispatchPeriod;
 }
 
-void AnalyticsManager::DispatchPeriod::set(TimeSpan value)
+void AnalyticsManager::DispatchPeriod::set(TimeSpan value)
+{
+	if (dispatchPeriod.Duration != value.Duration)
+	{
+		dispatchPeriod = value;
+		flushPolicy.SetMaxAge(dispatchPeriod.Duration > 0 ? dispatchPeriod.Duration * 100 : 0);
+		// hits already waiting keep their place in the cycle, but are due by the new period
+		DisarmFlushTimer();
+		auto due = flushPolicy.GetDue();
+		if (due >= 0)
+		{
+			ArmFlushTimer(due);
+		}
+		else
+		{
+			// hits queued before periodic dispatching was turned on, which no cycle covers yet
+			HoldQueuedHits();
+		}
+	}
+}
+
+int AnalyticsManager::FlushHitThreshold::get()
+{
+	return (int)flushPolicy.GetMaxHits();
+}
+
+void AnalyticsManager::FlushHitThreshold::set(int value)
+{
+	flushPolicy.SetMaxHits(value > 0 ? (size_t)value : 0);
+}
+
+int AnalyticsManager::FlushByteThreshold::get()
+{
+	return (int)flushPolicy.GetMaxBytes();
+}
+
+void AnalyticsManager::FlushByteThreshold::set(int value)
+{
+	flushPolicy.SetMaxBytes(value > 0 ? (size_t)value : 0);
+}
+
+bool AnalyticsManager::IsEnabled::get()
+{
+	return isEnabled;
+}
+void AnalyticsManager::IsEnabled::set(bool value)
+{
+	if (isEnabled != value)
+	{
+		isEnabled = value;
+		if (isEnabled)
+		{
+			if (dispatchPeriod.Duration >= 0)
+			{
+				DispatchAsync();
+			}
+		}
+	}
+}
+
+bool AnalyticsManager::FireEventsOnUIThread::get()
+{
+	return fireEventsOnUIThread;
+}
+
+void AnalyticsManager::FireEventsOnUIThread::set(bool value)
+{
+	if (fireEventsOnUIThread != value)
+	{
+		if (value)
+		{
+			if (dispatcher == nullptr)
+			{
+				auto window = CoreWindow::GetForCurrentThread();
+				if (window != nullptr)
+				{
+					dispatcher = window->Dispatcher;
+				}
+
+				if (dispatcher == nullptr)
+				{
+					throw ref new WrongThreadException("FireEventsOnUIThread must be called from UI Thread");
+				}
+			}
+		}
+		fireEventsOnUIThread = value;
+	}
+}
+
+bool AnalyticsManager::AutoAppLifetimeMonitoring::get()
+{
+	return autoAppLifetimeMonitoring;
+}
+
+void AnalyticsManager::AutoAppLifetimeMonitoring::set(bool value)
+{
+	if (autoAppLifetimeMonitoring != value)
+	{
+		autoAppLifetimeMonitoring = value;
+		if (autoAppLifetimeMonitoring)
+		{
+			coreAppSuspendingEventToken = CoreApplication::Suspending += ref new EventHandler<SuspendingEventArgs^>(this, &AnalyticsManager::CoreApplication_Suspending);
+			coreAppResumingEventToken = CoreApplication::Resuming += ref new EventHandler<Object^>(this, &AnalyticsManager::CoreApplication_Resuming);
+		}
+		else
+		{
+			CoreApplication::Suspending -= coreAppSuspendingEventToken;
+			CoreApplication::Resuming -= coreAppResumingEventToken;
+			coreAppResumingEventToken.Value = 0;
+			coreAppSuspendingEventToken.Value = 0;
+		}
+	}
+}
+
+void AnalyticsManager::Clear()
+{
+	PrepareCapturedHits();
+	aggregator.Clear();
+	DrainIngestion();
+	std::lock_guard<std::mutex> lg(hitLock);
+	for (size_t priority = 0; priority < PriorityCount; priority++)
+	{
+		while (!hits[priority].empty())
+		{
+			AcknowledgeHit(PopHit(priority));
+		}
+	}
+}
+
+HitValidationResult^ AnalyticsManager::ValidateHit(Hit^ hit)
+{
+	if (!hit)
+	{
+		throw ref new InvalidArgumentException("hit");
+	}
+	return ref new HitValidationResult(HitValidator::Validate(hit->Flatten()));
+}
+
+IAsyncAction^ AnalyticsManager::DispatchAsync()
+{
+	return create_async([this]() { return _DispatchAsync(); });
+}
+
+task<void> AnalyticsManager::_DispatchAsync()
+{
+	// whatever is queued from here on counts toward the next flush
+	ResetFlushCycle();
+	if (!isEnabled) return task<void>([]() {});
+
+	PrepareCapturedHits();
+	return FlushQueue().then([this](task<void> t) {
+		HoldQueuedHits();
+		t.get();
+	});
+}
+
+void AnalyticsManager::OnHitQueued(Hit^ hit)
+{
+	long long due = 0;
+	auto trigger = FlushPolicy::Trigger::Age;
+	switch (flushPolicy.Add(hit->GetByteSize(), TimeSource::MonotonicNow(), due, trigger))
+	{
+	case FlushPolicy::Action::FlushNow:
+		if (trigger == FlushPolicy::Trigger::HitCount)
+		{
+			counters->FlushesOnHitThreshold++;
+		}
+		else
+		{
+			counters->FlushesOnByteThreshold++;
+		}
+		// off the caller's thread, which may be preparing captured hits itself
+		create_task([this]() { return _DispatchAsync(); });
+		break;
+	case FlushPolicy::Action::ArmTimer:
+		ArmFlushTimer(due);
+		break;
+	default:
+		break;
+	}
+}
+
+void AnalyticsManager::ResetFlushCycle()
+{
+	flushPolicy.Reset();
+	DisarmFlushTimer();
+}
+
+void AnalyticsManager::HoldQueuedHits()
+{
+	// offline, UpdateConnectionStatus dispatches again once the network is back
+	if (dispatchPeriod.Duration <= 0 || !isConnected) return;
+	DrainIngestion();
+	auto now = TimeSource::MonotonicNow();
+	size_t count = 0;
+	size_t bytes = 0;
+	long long oldest = now;
+	{
+		std::lock_guard<std::mutex> lg(hitLock);
+		// bulk hits held back on a metered network are not part of any cycle; UpdateConnectionStatus dispatches them
+		size_t priorityCount = isDeferringLowPriority ? (size_t)HitPriority::Bulk : PriorityCount;
+		for (size_t priority = 0; priority < priorityCount; priority++)
+		{
+			if (hits[priority].empty()) continue;
+			count += hits[priority].size();
+			bytes += queuedClassBytes[priority];
+			// each class is in queue order, so its front is its oldest hit
+			oldest = (std::min)(oldest, now - GetHitAge(hits[priority].front()) * 100);
+		}
+	}
+	long long due = 0;
+	if (flushPolicy.Hold(count, bytes, oldest, now, due) == FlushPolicy::Action::ArmTimer)
+	{
+		ArmFlushTimer(due);
+	}
+}
+
+void AnalyticsManager::ArmFlushTimer(long long due)
+{
+	std::lock_guard<std::mutex> lg(flushLock);
+	// coalesced: a timer due no later already covers this cycle
+	if (flushTimer && flushDue <= due) return;
+	if (flushTimer)
+	{
+		flushTimer->Cancel();
+	}
+	auto delay = (std::max)(due - TimeSource::MonotonicNow(), 1000000LL);
+	flushDue = due;
+	flushTimer = ThreadPoolTimer::CreateTimer(ref new TimerElapsedHandler([this](ThreadPoolTimer^ timer) {
+		{
+			std::lock_guard<std::mutex> lg(flushLock);
+			// disarmed or replaced while this one was firing
+			if (flushTimer != timer) return;
+			flushTimer = nullptr;
+		}
+		counters->FlushesOnAge++;
+		_DispatchAsync();
+	}), TimeSpanHelper::FromTicks(delay / 100));
+}
+
+void AnalyticsManager::DisarmFlushTimer()
+{
+	std::lock_guard<std::mutex> lg(flushLock);
+	if (flushTimer)
+	{
+		flushTimer->Cancel();
+		flushTimer = nullptr;
+	}
+}
+
+task<void> AnalyticsManager::FlushQueue()
+{
+	DrainIngestion();
+	// nothing goes out while offline; UpdateConnectionStatus dispatches again once the network is back
+	if (!isConnected) return task<void>([]() {});
+
+	auto now = std::chrono::steady_clock::now();
+	bool isDeferring = isDeferringLowPriority;
+	bool isDraining = isDrainingBacklog;
+	bool isBacklogLeft = false;
+	auto circuit = retryPolicy.GetState(now);
+	std::vector<Hit^> hitsToSend;
+	std::vector<Hit^> expiredHits;
+	if (circuit != RetryPolicy::CircuitState::Open)
+	{
+		bool isWaiting = false;
+		auto nextDue = std::chrono::steady_clock::time_point::max();
+		{
+			std::lock_guard<std::mutex> lg(hitLock);
+			auto queuedHits = TakeQueuedHits();
+			for (auto it = begin(queuedHits); it != end(queuedHits); ++it)
+			{
+				auto hit = *it;
+				bool isCritical = hit->Priority == HitPriority::Critical;
+				if (IsHitExpired(hit))
+				{
+					expiredHits.push_back(hit);
+				}
+				else if (hit->GetNotBefore() > now || (circuit == RetryPolicy::CircuitState::HalfOpen && !hitsToSend.empty()))
+				{
+					// backing off, or only one hit is let through to probe a half open circuit
+					isWaiting = true;
+					nextDue = (std::min)(nextDue, (std::max)(hit->GetNotBefore(), now));
+					PushHit(hit);
+				}
+				else if (isDeferring && hit->Priority == HitPriority::Bulk)
+				{
+					// held back until the network is no longer metered; UpdateConnectionStatus dispatches again then
+					PushHit(hit);
+				}
+				else if (isDraining && !isCritical && (isBacklogLeft || !backlogBucket.Consume()))
+				{
+					// pacing the backlog; the next hit is let through once the bucket has refilled a token
+					isWaiting = true;
+					isBacklogLeft = true;
+					nextDue = (std::min)(nextDue, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / (std::max)(backlogBucket.GetFillRate(), 0.001))));
+					PushHit(hit);
+				}
+				else
+				{
+					hitsToSend.push_back(hit);
+				}
+			}
+		}
+		for (auto it = begin(expiredHits); it != end(expiredHits); ++it)
+		{
+			DropHit(*it, HitDropReason::Expired);
+		}
+		if (isDraining && !isBacklogLeft)
+		{
+			// the whole backlog went out
+			isDrainingBacklog = false;
+		}
+		if (isWaiting)
+		{
+			ScheduleRetryDispatch(nextDue);
+		}
+	}
+	else
+	{
+		bool isWaiting;
+		{
+			std::lock_guard<std::mutex> lg(hitLock);
+			isWaiting = HasQueuedHits();
+		}
+		if (isWaiting)
+		{
+			ScheduleRetryDispatch(retryPolicy.GetOpenUntil());
+		}
+	}
+	if (!hitsToSend.empty())
+	{
+		DispatchQueuedHits(hitsToSend);
+	}
+	// completes once these hits, and whatever earlier dispatches still have on the wire, are done
+	return scheduler->Flush().then([this](task<void> t) {
+		RaiseHitsCompleted();
+		t.get();
+	});
+}
+
+void AnalyticsManager::PushHit(Hit^ hit)
+{
+	hits[(size_t)hit->Priority].push(hit);
+	queuedBytes += hit->GetByteSize();
+	queuedClassBytes[(size_t)hit->Priority] += hit->GetByteSize();
+	counters->QueuedBytes = (long long)queuedBytes;
+	if (counters->PeakQueuedBytes < (long long)queuedBytes)
+	{
+		counters->PeakQueuedBytes = (long long)queuedBytes;
+	}
+}
+
+Hit^ AnalyticsManager::PopHit(size_t priority)
+{
+	auto hit = hits[priority].front();
+	hits[priority].pop();
+	queuedBytes -= hit->GetByteSize();
+	queuedClassBytes[priority] -= hit->GetByteSize();
+	counters->QueuedBytes = (long long)queuedBytes;
+	return hit;
+}
+
+std::vector<Hit^> AnalyticsManager::TakeQueuedHits()
+{
+	size_t count = 0;
+	for (auto queue = std::begin(hits); queue != std::end(hits); ++queue)
+	{
+		count += queue->size();
+	}
+	std::vector<Hit^> result;
+	result.reserve(count);
+	while (result.size() < count)
+	{
+		// every class gets its turn, so a flood of bulk hits slows normal ones down but never starves them
+		for (size_t priority = 0; priority < PriorityCount; priority++)
+		{
+			for (size_t taken = 0; taken < PriorityWeights[priority] && !hits[priority].empty(); taken++)
+			{
+				result.push_back(PopHit(priority));
+			}
+		}
+	}
+	return result;
+}
+
+bool AnalyticsManager::HasQueuedHits()
+{
+	for (auto queue = std::begin(hits); queue != std::end(hits); ++queue)
+	{
+		if (!queue->empty()) return true;
+	}
+	return false;
+}
+
+bool AnalyticsManager::IsCritical(IMap<String^, String^>^ params)
+{
+	if (!params->HasKey("t") || params->Lookup("t") != "exception") return false;
+	return !params->HasKey("exf") || params->Lookup("exf") == "1";
+}
+
+void AnalyticsManager::EnqueueHit(IMap<String^, String^>^ params)
+{
+	if (!AppOptOut)
+	{
+		Enqueue(ref new Hit(params));
+	}
+}
+
+void AnalyticsManager::EnqueueTrackerHit(std::shared_ptr<const HitRecord> trackerParameters, IMap<String^, String^>^ params)
+{
+	if (!AppOptOut)
+	{
+		// usually runs on the UI thread: only capture the hit here and leave building, persisting and encoding it to the thread pool
+		CapturedHit captured;
+		captured.MonotonicTimeStamp = TimeSource::MonotonicNow();
+		captured.TrackerParameters = std::move(trackerParameters);
+		captured.Parameters = std::make_shared<HitRecord>(Hit::ToRecord(params));
+		if (IsCritical(params))
+		{
+			// the process may be about to end: prepare the hit, and everything captured before it, before returning
+			PrepareCapturedHits();
+			PrepareHit(captured);
+		}
+		else
+		{
+			bool isCaptured;
+			{
+				RingUse use(captureUsers);
+				isCaptured = capture.load()->TryPush(captured);
+			}
+			if (isCaptured)
+			{
+				SchedulePreparation();
+			}
+			else
+			{
+				counters->HitsProcessedOnCapture++;
+				PrepareHit(captured);
+			}
+		}
+		counters->CaptureLatency.Record(TimeSource::MonotonicNow() - captured.MonotonicTimeStamp);
+	}
+}
+
+void AnalyticsManager::SchedulePreparation()
+{
+	if (!isPreparing.exchange(true))
+	{
+		ThreadPool::RunAsync(ref new WorkItemHandler([this](IAsyncAction^ operation) {
+			PrepareCapturedHits();
+			isPreparing.store(false);
+			// a hit captured between the last pop and clearing the flag would otherwise wait for the next one
+			bool isPending;
+			{
+				RingUse use(captureUsers);
+				isPending = capture.load()->Size() != 0;
+			}
+			if (isPending)
+			{
+				SchedulePreparation();
+			}
+		}));
+	}
+}
+
+void AnalyticsManager::PrepareCapturedHits()
+{
+	std::vector<CapturedHit> capturedHits;
+	{
+		std::lock_guard<std::mutex> cl(captureLock);
+		for (auto ring = begin(captureRings); ring != end(captureRings); ++ring)
+		{
+			CapturedHit captured;
+			while ((*ring)->TryPop(captured))
+			{
+				capturedHits.push_back(std::move(captured));
+			}
+		}
+		ReleaseRetiredRings(captureRings, captureUsers);
+	}
+	// prepared outside of the lock: preparing may drop hits, and listeners to HitDropped may well send or dispatch again
+	for (auto it = begin(capturedHits); it != end(capturedHits); ++it)
+	{
+		PrepareHit(*it);
+	}
+}
+
+void AnalyticsManager::PrepareHit(CapturedHit& captured)
+{
+	// the user may have opted out since the hit was captured
+	if (AppOptOut) return;
+
+	auto now = TimeSource::MonotonicNow();
+	auto timeStamp = DateTimeHelper::FromUniversalTime(TimeSource::UniversalNow() - (now - captured.MonotonicTimeStamp) / 100);
+	Enqueue(ref new Hit(captured.TrackerParameters, std::move(*captured.Parameters), timeStamp, captured.MonotonicTimeStamp));
+	counters->PreparationLatency.Record(TimeSource::MonotonicNow() - captured.MonotonicTimeStamp);
+}
+
+void AnalyticsManager::Enqueue(Hit^ hit)
+{
+	if (aggregator.HasRules() && Aggregate(hit)) return;
+	Submit(hit);
+}
+
+void AnalyticsManager::Submit(Hit^ hit)
+{
+	LogHit(hit);
+	if (hit->Priority == HitPriority::Critical)
+	{
+		// the process may be about to end: written out now rather than on the group commit timer
+		auto log = std::atomic_load(&hitLog);
+		if (log)
+		{
+			log->Commit();
+		}
+		// sent right away along with whatever else is queued, whatever the dispatch period, backlog pacing or throttling
+		{
+			std::lock_guard<std::mutex> lg(hitLock);
+			PushHit(hit);
+		}
+		EnforceQueueLimits();
+		if (CanDispatch())
+		{
+			// off the caller's thread, often the UI thread
+			create_task([this]() { return FlushQueue(); });
+		}
+		return;
+	}
+	bool isDeferred = isDeferringLowPriority && hit->Priority == HitPriority::Bulk;
+	if (DispatchPeriod.Duration == 0 && CanDispatch() && !isDeferred && !isDrainingBacklog && retryPolicy.GetState(std::chrono::steady_clock::now()) == RetryPolicy::CircuitState::Closed)
+	{
+		scheduler->Schedule([this, hit]() { return DispatchImmediateHit(hit); }).then([this](task<void>) {
+			RaiseHitsCompleted();
+		});
+	}
+	else
+	{
+		Ingest(hit);
+		if (!CanDispatch())
+		{
+			// nothing drains the ingestion queue while disabled or offline, so the queue limits are enforced as hits come in
+			DrainIngestion();
+		}
+		if (DispatchPeriod.Duration == 0 && CanDispatch() && !isDeferred)
+		{
+			// dispatching is paused or pacing a backlog; send it along with the others once hits are let through again
+			ScheduleRetryDispatch(retryPolicy.GetOpenUntil());
+		}
+		else if (DispatchPeriod.Duration > 0 && !isDeferred)
+		{
+			OnHitQueued(hit);
+		}
+	}
+}
+
+void AnalyticsManager::Ingest(Hit^ hit)
+{
+	RingUse use(ingestionUsers);
+	auto ring = ingestion.load();
+	switch (overflowPolicy)
+	{
+	case QueueOverflowPolicy::DropNewest:
+		if (!ring->TryPush(hit))
+		{
+			DropHit(hit, HitDropReason::QueueOverflow);
+		}
+		break;
+	case QueueOverflowPolicy::Block:
+		if (!ring->TryPush(hit))
+		{
+			counters->OverflowDrains++;
+			// this thread only waits: the drain, and the dispatcher locks it takes, stay on the thread pool
+			std::unique_lock<std::mutex> wl(ingestionWaitLock);
+			do
+			{
+				ScheduleIngestionDrain();
+				// bounded, in case room was made between the push and the wait
+				ingestionDrained.wait_for(wl, std::chrono::milliseconds(1));
+			} while (!ring->TryPush(hit));
+		}
+		break;
+	default:
+		while (!ring->TryPush(hit))
+		{
+			Hit^ oldest;
+			bool isEvicted;
+			{
+				// the ring takes items out on one thread at a time, the one holding ingestionLock
+				std::lock_guard<std::mutex> il(ingestionLock);
+				isEvicted = ring->TryPop(oldest);
+			}
+			if (isEvicted)
+			{
+				DropHit(oldest, HitDropReason::QueueOverflow);
+			}
+		}
+		break;
+	}
+}
+
+void AnalyticsManager::ScheduleIngestionDrain()
+{
+	if (!isDrainScheduled.exchange(true))
+	{
+		ThreadPool::RunAsync(ref new WorkItemHandler([this](IAsyncAction^ operation) {
+			// cleared first, so room asked for while draining gets a drain of its own
+			isDrainScheduled.store(false);
+			DrainIngestion();
+		}));
+	}
+}
+
+void AnalyticsManager::DrainIngestion()
+{
+	{
+		std::lock_guard<std::mutex> il(ingestionLock);
+		std::lock_guard<std::mutex> lg(hitLock);
+		for (auto ring = begin(ingestionRings); ring != end(ingestionRings); ++ring)
+		{
+			Hit^ hit;
+			while ((*ring)->TryPop(hit))
+			{
+				PushHit(hit);
+			}
+		}
+		ReleaseRetiredRings(ingestionRings, ingestionUsers);
+	}
+	ingestionDrained.notify_all();
+	EnforceQueueLimits();
+}
+
+void AnalyticsManager::EnforceQueueLimits()
+{
+	std::vector<Hit^> offlineHits;
+	std::vector<Hit^> evictedHits;
+	{
+		std::lock_guard<std::mutex> lg(hitLock);
+		if (!isConnected)
+		{
+			size_t count = 0;
+			for (auto queue = std::begin(hits); queue != std::end(hits); ++queue)
+			{
+				count += queue->size();
+			}
+			// the least urgent hits go first
+			for (size_t priority = PriorityCount; priority-- > 0 && count > (size_t)offlineQueueLimit;)
+			{
+				while (!hits[priority].empty() && count > (size_t)offlineQueueLimit)
+				{
+					offlineHits.push_back(PopHit(priority));
+					count--;
+				}
+			}
+		}
+		if (queueMemoryLimit > 0 && queuedBytes > (size_t)queueMemoryLimit)
+		{
+			EvictHits(evictedHits);
+		}
+	}
+	// listeners to HitDropped may well touch the queue again
+	for (auto it = begin(offlineHits); it != end(offlineHits); ++it)
+	{
+		DropHit(*it, HitDropReason::OfflineLimit);
+	}
+	for (auto it = begin(evictedHits); it != end(evictedHits); ++it)
+	{
+		DropHit(*it, HitDropReason::MemoryLimit);
+	}
+}
+
+void AnalyticsManager::EvictHits(std::vector<Hit^>& evicted)
+{
+	size_t limit = (size_t)queueMemoryLimit;
+	switch (evictionPolicy)
+	{
+	case QueueEvictionPolicy::DropOldest:
+		while (queuedBytes > limit)
+		{
+			// hits are queued in the order they were sent, so the oldest hit is at the front of one of the queues
+			size_t oldest = PriorityCount;
+			for (size_t priority = 0; priority < PriorityCount; priority++)
+			{
+				if (!hits[priority].empty() && (oldest == PriorityCount || hits[priority].front()->TimeStamp.UniversalTime < hits[oldest].front()->TimeStamp.UniversalTime))
+				{
+					oldest = priority;
+				}
+			}
+			if (oldest == PriorityCount) break;
+			evicted.push_back(PopHit(oldest));
+		}
+		break;
+	case QueueEvictionPolicy::SampleDown:
+		for (size_t priority = PriorityCount; priority-- > 0 && queuedBytes > limit;)
+		{
+			while (queuedBytes > limit && !hits[priority].empty())
+			{
+				// one pass drops every other hit, starting with the oldest, and puts the others back in order
+				size_t count = hits[priority].size();
+				for (size_t index = 0; index < count; index++)
+				{
+					auto hit = PopHit(priority);
+					if (index % 2 == 0 && queuedBytes + hit->GetByteSize() > limit)
+					{
+						evicted.push_back(hit);
+					}
+					else
+					{
+						PushHit(hit);
+					}
+				}
+			}
+		}
+		break;
+	default:
+		for (size_t priority = PriorityCount; priority-- > 0 && queuedBytes > limit;)
+		{
+			while (queuedBytes > limit && !hits[priority].empty())
+			{
+				evicted.push_back(PopHit(priority));
+			}
+		}
+		break;
+	}
+}
+
+void AnalyticsManager::DropHit(Hit^ hit, HitDropReason reason)
+{
+	switch (reason)
+	{
+	case HitDropReason::QueueOverflow:
+		counters->HitsDroppedOnOverflow++;
+		break;
+	case HitDropReason::MemoryLimit:
+		counters->HitsDroppedOnMemoryLimit++;
+		break;
+	case HitDropReason::OfflineLimit:
+		counters->HitsDroppedOffline++;
+		break;
+	case HitDropReason::Expired:
+		counters->HitsExpired++;
+		break;
+	case HitDropReason::PayloadTooLarge:
+		counters->HitsDroppedOversized++;
+		break;
+	}
+	AcknowledgeHit(hit);
+	RecordCompletion(hit, HitStatus::Dropped, 0, nullptr, reason, nullptr);
+	HitDropped(this, ref new HitDroppedEventArgs(hit, reason));
+}
+
+void AnalyticsManager::AggregateEvents(String^ category, TimeSpan window, int countMetricIndex)
+{
+	SetAggregationRule(category, false, window, countMetricIndex, 0, 0);
+}
+
+void AnalyticsManager::AggregateTimings(String^ category, TimeSpan window, int countMetricIndex)
+{
+	SetAggregationRule(category, true, window, countMetricIndex, 0, 0);
+}
+
+void AnalyticsManager::AggregateTimings(String^ category, TimeSpan window, int countMetricIndex, int minMetricIndex, int maxMetricIndex)
+{
+	SetAggregationRule(category, true, window, countMetricIndex, minMetricIndex, maxMetricIndex);
+}
+
+void AnalyticsManager::SetAggregationRule(String^ category, bool isTiming, TimeSpan window, int countMetricIndex, int minMetricIndex, int maxMetricIndex)
+{
+	auto isMetric = [](int index) {
+		return index > 0 && MeasurementProtocol::IsValid(MeasurementProtocol::MakeKey(MeasurementProtocol::IndexedParameter::CustomMetric, (unsigned int)index));
+	};
+	if (!category) throw ref new InvalidArgumentException("category");
+	if (!isMetric(countMetricIndex)) throw ref new InvalidArgumentException("countMetricIndex");
+	if (minMetricIndex != 0 && (!isMetric(minMetricIndex) || minMetricIndex == countMetricIndex)) throw ref new InvalidArgumentException("minMetricIndex");
+	if (maxMetricIndex != 0 && (!isMetric(maxMetricIndex) || maxMetricIndex == countMetricIndex || maxMetricIndex == minMetricIndex)) throw ref new InvalidArgumentException("maxMetricIndex");
+
+	HitAggregator::Rule rule;
+	rule.Window = window.Duration * 100;
+	rule.CountMetricIndex = (unsigned int)countMetricIndex;
+	rule.MinMetricIndex = (unsigned int)minMetricIndex;
+	rule.MaxMetricIndex = (unsigned int)maxMetricIndex;
+	aggregator.SetRule(std::wstring(category->Data(), category->Length()), isTiming, rule);
+}
+
+bool AnalyticsManager::Aggregate(Hit^ hit)
+{
+	HitRecord flattened;
+	const HitRecord* record = &hit->GetRecord();
+	if (hit->GetBaseRecord())
+	{
+		flattened = hit->Flatten();
+		record = &flattened;
+	}
+
+	bool isNewGroup;
+	long long due;
+	if (!aggregator.TryAdd(*record, hit->TimeStamp.UniversalTime, hit->GetMonotonicTimeStamp(), TimeSource::MonotonicNow(), isNewGroup, due))
+	{
+		return false;
+	}
+	if (isNewGroup)
+	{
+		ScheduleAggregationFlush(due);
+	}
+	else
+	{
+		counters->HitsAggregated++;
+	}
+	return true;
+}
+
+void AnalyticsManager::FlushAggregatedHits(long long now)
+{
+	auto aggregated = aggregator.TakeDue(now);
+	for (auto it = begin(aggregated); it != end(aggregated); ++it)
+	{
+		Submit(ref new Hit(nullptr, std::move(it->Record), DateTimeHelper::FromUniversalTime(it->UniversalTimeStamp), it->MonotonicTimeStamp));
+	}
+	if (now >= 0)
+	{
+		auto next = aggregator.GetNextDue();
+		if (next >= 0)
+		{
+			ScheduleAggregationFlush(next);
+		}
+	}
+}
+
+void AnalyticsManager::ScheduleAggregationFlush(long long due)
+{
+	std::lock_guard<std::mutex> lg(aggregationLock);
+	if (aggregationTimer && aggregationDue <= due) return;
+	if (aggregationTimer)
+	{
+		aggregationTimer->Cancel();
+	}
+	auto delay = (std::max)(due - TimeSource::MonotonicNow(), 1000000LL);
+	aggregationDue = due;
+	aggregationTimer = ThreadPoolTimer::CreateTimer(ref new TimerElapsedHandler([this](ThreadPoolTimer^ timer) {
+		{
+			std::lock_guard<std::mutex> lg(aggregationLock);
+			if (aggregationTimer == timer)
+			{
+				aggregationTimer = nullptr;
+			}
+		}
+		FlushAggregatedHits(TimeSource::MonotonicNow());
+	}), TimeSpanHelper::FromTicks(delay / 100));
+}
+
+int AnalyticsManager::CaptureCapacity::get()
+{
+	std::lock_guard<std::mutex> cl(captureLock);
+	return (int)capture.load()->Capacity();
+}
+
+void AnalyticsManager::CaptureCapacity::set(int value)
+{
+	std::lock_guard<std::mutex> cl(captureLock);
+	// as with the ingestion queue, the previous ring is kept until it has been drained
+	captureRings.push_back(std::make_unique<IngestionRing<CapturedHit>>(value > 0 ? (size_t)value : 1));
+	capture.store(captureRings.back().get());
+}
+
+int AnalyticsManager::IngestionCapacity::get()
+{
+	std::lock_guard<std::mutex> il(ingestionLock);
+	return (int)ingestion.load()->Capacity();
+}
+
+void AnalyticsManager::IngestionCapacity::set(int value)
+{
+	std::lock_guard<std::mutex> il(ingestionLock);
+	// a thread may still be pushing to the previous ring, so it is kept until DrainIngestion has emptied it and no thread uses a ring
+	ingestionRings.push_back(std::make_unique<IngestionRing<Hit^>>(value > 0 ? (size_t)value : 1));
+	ingestion.store(ingestionRings.back().get());
+}
+
+long long AnalyticsManager::QueueMemoryLimit::get()
+{
+	return queueMemoryLimit;
+}
+
+void AnalyticsManager::QueueMemoryLimit::set(long long value)
+{
+	queueMemoryLimit = value;
+	EnforceQueueLimits();
+}
+
+int AnalyticsManager::MaxGetPayloadSize::get()
+{
+	return maxGetPayloadSize;
+}
+
+void AnalyticsManager::MaxGetPayloadSize::set(int value)
+{
+	maxGetPayloadSize = value < 0 ? 0 : value;
+}
+
+OversizedPayloadPolicy AnalyticsManager::PayloadPolicy::get()
+{
+	return payloadPolicy;
+}
+
+void AnalyticsManager::PayloadPolicy::set(OversizedPayloadPolicy value)
+{
+	payloadPolicy = value;
+}
+
+QueueEvictionPolicy AnalyticsManager::EvictionPolicy::get()
+{
+	return evictionPolicy;
+}
+
+void AnalyticsManager::EvictionPolicy::set(QueueEvictionPolicy value)
+{
+	evictionPolicy = value;
+}
+
+QueueOverflowPolicy AnalyticsManager::OverflowPolicy::get()
+{
+	return overflowPolicy;
+}
+
+void AnalyticsManager::OverflowPolicy::set(QueueOverflowPolicy value)
+{
+	overflowPolicy = value;
+}
+
+IAsyncAction^ AnalyticsManager::SuspendAsync()
+{
+	return create_async([this]() { return _SuspendAsync(); });
+}
+
+task<void> AnalyticsManager::_SuspendAsync()
+{
+	// merged hits still waiting for their window to end would otherwise only exist in memory
+	PrepareCapturedHits();
+	FlushAggregatedHits(-1);
+
+	return _DispatchAsync().then([this] {
+		DisarmFlushTimer();
+		auto log = std::atomic_load(&hitLog);
+		if (log)
+		{
+			log->Commit();
+		}
+	});
+}
+
+void AnalyticsManager::Resume()
+{
+	if (dispatchPeriod.Duration > 0)
+	{
+		// hits queued while suspended, or left over by the dispatch on suspension, are due a period from now at the latest
+		HoldQueuedHits();
+		auto due = flushPolicy.GetDue();
+		if (due >= 0)
+		{
+			ArmFlushTimer(due);
+		}
+	}
+}
+
+task<void> AnalyticsManager::DispatchQueuedHits(std::vector<Hit^> hits)
+{
+	auto transport = GetTransport();
+	bool batching = BatchDispatch && PostData && !IsDebug;
+	std::vector<task<void>> tasks;
+	std::vector<Hit^> batchHits;
+	std::vector<std::string> batchPayloads;
+	// the whole round is admitted through the bucket at once; hits beyond what it grants wait for the next one. Critical hits do not take tokens.
+	size_t throttled = (size_t)std::count_if(begin(hits), end(hits), [](Hit^ hit) { return hit->Priority != HitPriority::Critical; });
+	size_t admitted = !isEnabled ? 0 : ThrottlingEnabled ? hitTokenBucket.TryConsumeN(throttled) : throttled;
+	size_t position = 0;
+	bool isThrottled = false;
+	for (auto it = begin(hits); it != end(hits); ++it)
+	{
+		Hit^ hit = *it;
+		bool isCritical = hit->Priority == HitPriority::Critical;
+
+		if (isEnabled && (isCritical || position++ < admitted))
+		{
+			long long queueTime = GetHitAge(hit) / 10000;
+			auto payload = EncodeHit(hit, queueTime);
+			if (payload.empty())
+			{
+				DropHit(hit, HitDropReason::PayloadTooLarge);
+			}
+			else if (batching)
+			{
+				batchHits.push_back(hit);
+				batchPayloads.push_back(std::move(payload));
+			}
+			else
+			{
+				tasks.push_back(scheduler->Schedule([this, hit, transport, payload]() { return DispatchHitData(hit, transport, payload); }, isCritical));
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lg(hitLock);
+			PushHit(hit);
+			isThrottled = true;
+		}
+	}
+	if (isThrottled)
+	{
+		// new hits may have been queued while these were out
+		EnforceQueueLimits();
+	}
+
+	if (!batchHits.empty())
+	{
+		std::vector<size_t> payloadSizes;
+		for (auto it = begin(batchPayloads); it != end(batchPayloads); ++it)
+		{
+			payloadSizes.push_back(it->size());
+		}
+		auto batches = HitBatcher().Pack(payloadSizes);
+		for (auto batch = begin(batches); batch != end(batches); ++batch)
+		{
+			size_t contentSize = 0;
+			for (auto index = begin(*batch); index != end(*batch); ++index)
+			{
+				contentSize += batchPayloads[*index].size() + 1;
+			}
+			std::vector<Hit^> hitsInBatch;
+			std::vector<const std::string*> payloadsInBatch;
+			std::string content;
+			content.reserve(contentSize);
+			bool isUrgent = false;
+			for (auto index = begin(*batch); index != end(*batch); ++index)
+			{
+				if (!content.empty()) content += '\n';
+				content += batchPayloads[*index];
+				hitsInBatch.push_back(batchHits[*index]);
+				payloadsInBatch.push_back(&batchPayloads[*index]);
+				isUrgent = isUrgent || batchHits[*index]->Priority == HitPriority::Critical;
+			}
+			std::string contentEncoding;
+			if (CompressPostData)
+			{
+				auto compressed = CompressPayloads(payloadsInBatch, content.size());
+				if (!compressed.empty())
+				{
+					content.swap(compressed);
+					contentEncoding = "gzip";
+				}
+			}
+			tasks.push_back(scheduler->Schedule([this, hitsInBatch, transport, content, contentEncoding]() { return DispatchBatch(hitsInBatch, transport, content, contentEncoding); }, isUrgent));
+		}
+	}
+	return when_all(begin(tasks), end(tasks));
+}
+
+task<void> AnalyticsManager::DispatchImmediateHit(Hit^ payload)
+{
+	// encoded once the scheduler lets it through, so its time in the ingestion ring, the preparation stage and the scheduler is counted
+	auto payloadData = EncodeHit(payload, GetHitAge(payload) / 10000);
+	if (payloadData.empty())
+	{
+		DropHit(payload, HitDropReason::PayloadTooLarge);
+		return task<void>([]() {});
+	}
+	return DispatchHitData(payload, GetTransport(), payloadData);
+}
+
+task<void> AnalyticsManager::DispatchHitData(Hit^ hit, std::shared_ptr<IHitTransport> transport, std::string payload)
+{
+	auto started = TimeSource::MonotonicNow();
+	return SendHitAsync(hit, transport, payload).then([this, hit, started](HitResponse response) {
+		counters->RequestLatency.Record(TimeSource::MonotonicNow() - started);
+		if (response.IsReceived())
+		{
+			retryPolicy.RecordSuccess();
+			if (response.IsSuccessStatusCode())
+			{
+				OnHitSent(hit, response);
+			}
+			else
+			{
+				OnHitMalformed(hit, response);
+			}
+		}
+		else
+		{
+			if (retryPolicy.RecordFailure(std::chrono::steady_clock::now()))
+			{
+				counters->CircuitBreaks++;
+			}
+			OnHitFailed(hit, ToPlatformString(response.Error));
+		}
+	}, task_continuation_context::use_current());
+}
+
+task<void> AnalyticsManager::DispatchBatch(std::vector<Hit^> hits, std::shared_ptr<IHitTransport> transport, std::string content, std::string contentEncoding)
+{
+	std::wstring endPoint((IsSecure ? endPointSecureBatch : endPointUnsecureBatch)->RawUri->Data());
+	auto started = TimeSource::MonotonicNow();
+	counters->HitsSentByPost += (long long)hits.size();
+	return RequestAsync([transport, endPoint, content, contentEncoding](IHitTransport::ResponseHandler completed) {
+		transport->Post(endPoint, content, contentEncoding, completed);
+	}).then([this, hits, started](HitResponse response) {
+		counters->RequestLatency.Record(TimeSource::MonotonicNow() - started);
+		if (response.IsReceived())
+		{
+			retryPolicy.RecordSuccess();
+			if (response.IsSuccessStatusCode())
+			{
+				OnBatchSent(hits, response);
+			}
+			else
+			{
+				OnBatchMalformed(hits, response);
+			}
+		}
+		else
+		{
+			if (retryPolicy.RecordFailure(std::chrono::steady_clock::now()))
+			{
+				counters->CircuitBreaks++;
+			}
+			OnBatchFailed(hits, ToPlatformString(response.Error));
+		}
+	}, task_continuation_context::use_current());
+}
+
+task<HitResponse> AnalyticsManager::SendHitAsync(Hit^ payload, std::shared_ptr<IHitTransport> transport, const std::string& payloadData)
+{
+	std::wstring endPoint((IsDebug ? (IsSecure ? endPointSecureDebug : endPointUnsecureDebug) : (IsSecure ? endPointSecure : endPointUnsecure))->RawUri->Data());
+
+	// a long URL is as likely to be cut short on the way as it is to be rejected, so larger hits go by POST whatever the setting
+	if (PostData || payloadData.size() > (size_t)maxGetPayloadSize)
+	{
+		counters->HitsSentByPost++;
+		if (CompressPostData)
+		{
+			auto compressed = CompressPayloads(std::vector<const std::string*>(1, &payloadData), payloadData.size());
+			if (!compressed.empty())
+			{
+				return RequestAsync([transport, endPoint, compressed](IHitTransport::ResponseHandler completed) {
+					transport->Post(endPoint, compressed, "gzip", completed);
+				});
+			}
+		}
+		std::string content(payloadData);
+		return RequestAsync([transport, endPoint, content](IHitTransport::ResponseHandler completed) {
+			transport->Post(endPoint, content, std::string(), completed);
+		});
+	}
+	else
+	{
+		counters->HitsSentByGet++;
+		// the encoded payload is plain ASCII
+		std::wstring url(endPoint);
+		url += L'?';
+		url.append(begin(payloadData), end(payloadData));
+		return RequestAsync([transport, url](IHitTransport::ResponseHandler completed) {
+			transport->Get(url, completed);
+		});
+	}
+}
+
+std::string AnalyticsManager::CompressPayloads(const std::vector<const std::string*>& payloads, size_t contentSize)
+{
+	auto started = TimeSource::MonotonicNow();
+	std::string compressed;
+	GzipEncoder encoder(compressed);
+	// one stream for the whole body, so each hit is compressed against the ones before it
+	for (auto it = begin(payloads); it != end(payloads); ++it)
+	{
+		if (it != begin(payloads)) encoder.Write("\n", 1);
+		encoder.Write(**it);
+	}
+	encoder.Finish();
+	counters->CompressionLatency.Record(TimeSource::MonotonicNow() - started);
+
+	counters->BytesBeforeCompression += contentSize;
+	if (compressed.size() >= contentSize)
+	{
+		counters->BytesAfterCompression += contentSize;
+		return std::string();
+	}
+	counters->BytesAfterCompression += compressed.size();
+	return compressed;
+}
+
+std::string AnalyticsManager::EncodeHit(Hit^ hit, long long queueTime)
+{
+	static const wchar_t Key_QueueTime[] = L"qt";
+	static const wchar_t Key_CacheBuster[] = L"z";
+
+	auto started = TimeSource::MonotonicNow();
+	bool bustCache = BustCache;
+	int cacheBuster = bustCache ? GetCacheBuster() : -1;
+	auto isReplaced = [queueTime, bustCache](const wchar_t* key, size_t keyLength) {
+		return (queueTime >= 0 && keyLength == 2 && wmemcmp(key, Key_QueueTime, 2) == 0) || (bustCache && keyLength == 1 && key[0] == Key_CacheBuster[0]);
+	};
+
+	// the encoded size of the hit with every value cut to at most cap characters
+	size_t longestValue = 0;
+	auto getSize = [&](size_t cap) {
+		size_t size = 0;
+		hit->ForEachParameter([&](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+			if (!isReplaced(key, keyLength)) size += PayloadEncoder::EncodedLength(keyLength, value, PayloadEncoder::TruncatedLength(value, valueLength, cap));
+			longestValue = (std::max)(longestValue, valueLength);
+		});
+		if (queueTime >= 0) size += PayloadEncoder::EncodedLength(2, queueTime);
+		if (cacheBuster >= 0) size += PayloadEncoder::EncodedLength(1, cacheBuster);
+		return PayloadEncoder::PayloadLength(size);
+	};
+
+	size_t valueCap = SIZE_MAX;
+	size_t size = getSize(valueCap);
+	if (size > MaxPayloadSize)
+	{
+		if (payloadPolicy == OversizedPayloadPolicy::Reject || !PayloadEncoder::FitValueLength(getSize, longestValue, MaxPayloadSize, valueCap))
+		{
+			counters->EncodingLatency.Record(TimeSource::MonotonicNow() - started);
+			return std::string();
+		}
+		size = getSize(valueCap);
+		counters->HitsTruncated++;
+	}
+
+	std::string payload;
+	PayloadEncoder encoder(payload);
+	encoder.Reserve(size);
+	hit->ForEachParameter([&](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+		if (!isReplaced(key, keyLength)) encoder.Append(key, keyLength, value, PayloadEncoder::TruncatedLength(value, valueLength, valueCap));
+	});
+	if (queueTime >= 0) encoder.Append(Key_QueueTime, 2, queueTime);
+	if (cacheBuster >= 0) encoder.Append(Key_CacheBuster, 1, cacheBuster);
+
+#ifdef _DEBUG 
+	// 	::OutputDebugStringA(payload.c_str());
+#endif 
+
+	counters->EncodingLatency.Record(TimeSource::MonotonicNow() - started);
+	return payload;
+}
+
+void AnalyticsManager::OnHitFailed(Hit^ payload, String^ error)
+{
+	if (IsHitExpired(payload))
+	{
+		DropHit(payload, HitDropReason::Expired);
+	}
+	else
+	{
+		auto attempt = payload->GetAttempts();
+		auto due = std::chrono::steady_clock::now() + retryPolicy.GetBackoff(attempt);
+		payload->SetAttempts(attempt + 1);
+		payload->SetNotBefore(due);
+		counters->HitRetries++;
+		{
+			std::lock_guard<std::mutex> lg(hitLock);
+			PushHit(payload);
+		}
+		EnforceQueueLimits();
+		ScheduleRetryDispatch(due);
+	}
+	RecordCompletion(payload, HitStatus::Failed, 0, error, HitDropReason::None, nullptr);
+	HitFailed(this, ref new HitFailedEventArgs(payload, error));
+}
+
+void AnalyticsManager::RecordCompletion(Hit^ hit, HitStatus status, int httpStatusCode, String^ error, HitDropReason dropReason, std::shared_ptr<ResponseBody> responseBody)
+{
+	if (hitsCompletedListenerCount > 0)
+	{
+		auto result = ref new HitResult(hit, status, httpStatusCode, error, dropReason, responseBody);
+		std::lock_guard<std::mutex> lg(completedLock);
+		completedHits.push_back(result);
+	}
+}
+
+void AnalyticsManager::RaiseHitsCompleted()
+{
+	std::vector<HitResult^> results;
+	{
+		std::lock_guard<std::mutex> lg(completedLock);
+		results.swap(completedHits);
+	}
+	if (!results.empty())
+	{
+		auto list = ref new Vector<HitResult^>(std::move(results));
+		HitsCompleted(this, ref new HitsCompletedEventArgs(list->GetView()));
+	}
+}
+
+void AnalyticsManager::PostToUIThread(std::function<void()> action)
+{
+	{
+		std::lock_guard<std::mutex> lg(uiLock);
+		uiActions.push_back(std::move(action));
+		if (isUIActionPosted) return;
+		isUIActionPosted = true;
+	}
+	dispatcher->RunAsync(
+		Windows::UI::Core::CoreDispatcherPriority::Normal,
+		ref new Windows::UI::Core::DispatchedHandler([this]()
+	{
+		RunUIActions();
+	}));
+}
+
+void AnalyticsManager::RunUIActions()
+{
+	std::vector<std::function<void()>> actions;
+	{
+		std::lock_guard<std::mutex> lg(uiLock);
+		actions.swap(uiActions);
+		isUIActionPosted = false;
+	}
+	for (auto it = begin(actions); it != end(actions); ++it)
+	{
+		(*it)();
+	}
+}
+
+long long AnalyticsManager::GetHitAge(Hit^ hit)
 {
-	if (dispatchPeriod.Duration != value.Duration)
+	// hits created in this process are timed with the monotonic clock, so changes to the system clock do not skew qt;
+	// hits restored from the persistent queue only have their wall clock time stamp.
+	if (hit->GetMonotonicTimeStamp() != 0)
 	{
-		dispatchPeriod = value;
-		if (timer)
-		{
-			timer->Cancel();
-			timer = nullptr;
-		}
-		if (dispatchPeriod.Duration > 0)
-		{
-			timer = ThreadPoolTimer::CreatePeriodicTimer(ref new TimerElapsedHandler(this, &AnalyticsManager::timer_Tick), dispatchPeriod);
-		}
+		return (TimeSource::MonotonicNow() - hit->GetMonotonicTimeStamp()) / 100;
 	}
+	return TimeSource::UniversalNow() - hit->TimeStamp.UniversalTime;
 }
 
-bool AnalyticsManager::IsEnabled::get()
+bool AnalyticsManager::IsHitExpired(Hit^ hit)
 {
-	return isEnabled;
+	auto age = std::chrono::duration<long long, std::ratio<1, 10000000>>(GetHitAge(hit));
+	return retryPolicy.IsExpired(std::chrono::duration_cast<std::chrono::steady_clock::duration>(age));
 }
-void AnalyticsManager::IsEnabled::set(bool value)
+
+void AnalyticsManager::ScheduleRetryDispatch(std::chrono::steady_clock::time_point due)
 {
-	if (isEnabled != value)
+	// armed whatever the dispatch period: left to the flush timer, a backlog would drain one bucket burst per period instead of at BacklogDrainRate
+	std::lock_guard<std::mutex> lg(retryLock);
+	if (retryTimer && retryDue <= due) return;
+	if (retryTimer)
 	{
-		isEnabled = value;
-		if (isEnabled)
+		retryTimer->Cancel();
+	}
+	auto delay = (std::max)(due - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration(std::chrono::milliseconds(1)));
+	retryDue = due;
+	retryTimer = ThreadPoolTimer::CreateTimer(ref new TimerElapsedHandler([this](ThreadPoolTimer^ timer) {
 		{
-			if (dispatchPeriod.Duration >= 0)
+			std::lock_guard<std::mutex> lg(retryLock);
+			if (retryTimer == timer)
 			{
-				DispatchAsync();
+				retryTimer = nullptr;
 			}
 		}
+		DispatchAsync();
+	}), TimeSpanHelper::FromTicks(std::chrono::duration_cast<std::chrono::duration<long long, std::ratio<1, 10000000>>>(delay).count()));
+}
+
+void AnalyticsManager::OnHitSent(Hit^ payload, const HitResponse& response)
+{
+	AcknowledgeHit(payload);
+	auto responseBody = std::make_shared<ResponseBody>(response.ReadBody);
+	RecordCompletion(payload, HitStatus::Sent, response.StatusCode, nullptr, HitDropReason::None, responseBody);
+	// the body is only worth reading for someone who will get it
+	if (hitSentListenerCount > 0)
+	{
+		responseBody->ReadAsync().then([this, payload](task<Platform::String^> t) {
+			HitSent(this, ref new HitSentEventArgs(payload, t.get()));
+		});
 	}
 }
 
-bool AnalyticsManager::FireEventsOnUIThread::get()
+void AnalyticsManager::OnHitMalformed(GoogleAnalytics::Hit^ payload, const HitResponse& response)
 {
-	return fireEventsOnUIThread;
+	AcknowledgeHit(payload);
+	RecordCompletion(payload, HitStatus::Malformed, response.StatusCode, nullptr, HitDropReason::None, std::make_shared<ResponseBody>(response.ReadBody));
+	HitMalformed(this, ref new HitMalformedEventArgs(payload, response.StatusCode));
 }
 
-void AnalyticsManager::FireEventsOnUIThread::set(bool value)
+void AnalyticsManager::OnBatchFailed(const std::vector<Hit^>& hits, String^ error)
 {
-	if (fireEventsOnUIThread != value)
+	for (auto it = begin(hits); it != end(hits); ++it)
 	{
-		if (value)
-		{
-			if (dispatcher == nullptr)
-			{
-				auto window = CoreWindow::GetForCurrentThread();
-				if (window != nullptr)
-				{
-					dispatcher = window->Dispatcher;
-				}
+		OnHitFailed(*it, error);
+	}
+}
 
-				if (dispatcher == nullptr)
-				{
-					throw ref new WrongThreadException("FireEventsOnUIThread must be called from UI Thread");
-				}
+void AnalyticsManager::OnBatchSent(const std::vector<Hit^>& hits, const HitResponse& response)
+{
+	// the response is shared by every hit in the batch, so it is only read once
+	auto responseBody = std::make_shared<ResponseBody>(response.ReadBody);
+	for (auto it = begin(hits); it != end(hits); ++it)
+	{
+		AcknowledgeHit(*it);
+		RecordCompletion(*it, HitStatus::Sent, response.StatusCode, nullptr, HitDropReason::None, responseBody);
+	}
+	if (hitSentListenerCount > 0)
+	{
+		responseBody->ReadAsync().then([this, hits](task<Platform::String^> t) {
+			auto responseText = t.get();
+			for (auto it = begin(hits); it != end(hits); ++it)
+			{
+				HitSent(this, ref new HitSentEventArgs(*it, responseText));
 			}
-		}
-		fireEventsOnUIThread = value;
+		});
 	}
 }
 
-bool AnalyticsManager::AutoAppLifetimeMonitoring::get()
+void AnalyticsManager::OnBatchMalformed(const std::vector<Hit^>& hits, const HitResponse& response)
 {
-	return autoAppLifetimeMonitoring;
+	for (auto it = begin(hits); it != end(hits); ++it)
+	{
+		OnHitMalformed(*it, response);
+	}
 }
 
-void AnalyticsManager::AutoAppLifetimeMonitoring::set(bool value)
+std::shared_ptr<IHitTransport> AnalyticsManager::GetTransport()
 {
-	if (autoAppLifetimeMonitoring != value)
+	if (transportOverride)
 	{
-		autoAppLifetimeMonitoring = value;
-		if (autoAppLifetimeMonitoring)
-		{
-			coreAppSuspendingEventToken = CoreApplication::Suspending += ref new EventHandler<SuspendingEventArgs^>(this, &AnalyticsManager::CoreApplication_Suspending);
-			coreAppResumingEventToken = CoreApplication::Resuming += ref new EventHandler<Object^>(this, &AnalyticsManager::CoreApplication_Resuming);
-		}
-		else
-		{
-			CoreApplication::Suspending -= coreAppSuspendingEventToken;
-			CoreApplication::Resuming -= coreAppResumingEventToken;
-			coreAppResumingEventToken.Value = 0;
-			coreAppSuspendingEventToken.Value = 0;
-		}
+		return transportOverride;
 	}
+
+	std::lock_guard<std::mutex> lg(transportLock);
+	bool isSecure = IsSecure;
+	String^ userAgent = UserAgent;
+	if (!transport || transportIsSecure != isSecure || transportUserAgent != userAgent)
+	{
+		auto idleTimeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<long long, std::ratio<1, 10000000>>(connectionIdleTimeout.Duration));
+		transport = std::make_shared<HttpClientTransport>(userAgent, (unsigned int)maxConnections, useHttp2, idleTimeout, counters);
+		transportIsSecure = isSecure;
+		transportUserAgent = userAgent;
+		// IsSecure decides whether HTTP/2 can be negotiated
+		UpdateMaxInFlight();
+	}
+	return transport;
 }
 
-void AnalyticsManager::Clear()
+void AnalyticsManager::ResetTransport()
 {
-	std::lock_guard<std::mutex> lg(hitLock);
-	while (!hits.empty()) hits.pop();
+	std::lock_guard<std::mutex> lg(transportLock);
+	transport = nullptr;
 }
 
-IAsyncAction^ AnalyticsManager::DispatchAsync()
+void AnalyticsManager::SetTransport(std::shared_ptr<IHitTransport> transport)
 {
-	return create_async([this]() { return _DispatchAsync(); });
+	transportOverride = transport;
 }
 
-task<void> AnalyticsManager::_DispatchAsync()
+int AnalyticsManager::MaxConnections::get()
 {
-	if (!isEnabled) return task<void>([]() {});
+	return maxConnections;
+}
 
-	task<void> allDispatchingTasks;
+void AnalyticsManager::MaxConnections::set(int value)
+{
+	if (maxConnections != value)
 	{
-		std::lock_guard<std::mutex> lg(dispatcherLock);
-		allDispatchingTasks = when_all(begin(dispatchingTasks), end(dispatchingTasks));
+		maxConnections = value < 0 ? 0 : value;
+		ResetTransport();
 	}
+}
 
-	return allDispatchingTasks.then([this]() {
-		if (!isEnabled) return task<void>([]() {});
-
-		std::vector<Hit^> hitsToSend;
-		{
-			std::lock_guard<std::mutex> lg(hitLock);
-			while (!hits.empty())
-			{
-				hitsToSend.push_back(hits.front());
-				hits.pop();
-			}
-		}
-		if (!hitsToSend.empty())
-		{
-			return RunDispatchingTask(DispatchQueuedHits(hitsToSend));
-		}
-		else
-		{
-			return task<void>([]() {});
-		}
-	});
+TimeSpan AnalyticsManager::ConnectionIdleTimeout::get()
+{
+	return connectionIdleTimeout;
 }
 
-void AnalyticsManager::EnqueueHit(IMap<String^, String^>^ params)
+void AnalyticsManager::ConnectionIdleTimeout::set(TimeSpan value)
 {
-	if (!AppOptOut)
+	if (connectionIdleTimeout.Duration != value.Duration)
 	{
-		auto hit = ref new Hit(params);
-		if (DispatchPeriod.Duration == 0 && IsEnabled)
-		{
-			RunDispatchingTask(DispatchImmediateHit(hit));
-		}
-		else
-		{
-			std::lock_guard<std::mutex> lg(hitLock);
-			hits.push(hit);
-		}
+		connectionIdleTimeout = value;
+		ResetTransport();
 	}
 }
 
-IAsyncAction^ AnalyticsManager::SuspendAsync()
+double AnalyticsManager::ThrottlingCapacity::get()
 {
-	return create_async([this]() { return _SuspendAsync(); });
+	return hitTokenBucket.GetCapacity();
 }
 
-task<void> AnalyticsManager::_SuspendAsync()
+void AnalyticsManager::ThrottlingCapacity::set(double value)
 {
+	hitTokenBucket.SetCapacity(value);
+}
 
-	return _DispatchAsync().then([this] {
-		if (timer)
-		{
-			timer->Cancel();
-			timer = nullptr;
-		}
-	});
+double AnalyticsManager::ThrottlingFillRate::get()
+{
+	return hitTokenBucket.GetFillRate();
 }
 
-void AnalyticsManager::Resume()
+void AnalyticsManager::ThrottlingFillRate::set(double value)
 {
-	if (dispatchPeriod.Duration > 0)
-	{
-		//This would only happen if Suspend did not complete before due to a long Dispatch; very unlikely (I hope)
-		if (timer != nullptr)
-		{
-			timer->Cancel();
-			timer = nullptr;
-		}
-		timer = ThreadPoolTimer::CreatePeriodicTimer(ref new TimerElapsedHandler(this, &AnalyticsManager::timer_Tick), dispatchPeriod);
-	}
+	hitTokenBucket.SetFillRate(value);
 }
 
-void AnalyticsManager::timer_Tick(ThreadPoolTimer^ sender)
+int AnalyticsManager::MaxConcurrentRequests::get()
 {
-	DispatchAsync();
+	return maxConcurrentRequests;
 }
 
-task<void> AnalyticsManager::RunDispatchingTask(task<void> newDispatchingTask)
+void AnalyticsManager::MaxConcurrentRequests::set(int value)
 {
-	{
-		std::lock_guard<std::mutex> lg(dispatcherLock);
-		dispatchingTasks.push_back(newDispatchingTask);
-	}
-	return newDispatchingTask.then([this, newDispatchingTask](task<void> t) {
-		std::lock_guard<std::mutex> lg(dispatcherLock);
-		dispatchingTasks.erase(begin(dispatchingTasks), std::find(begin(dispatchingTasks), end(dispatchingTasks), newDispatchingTask));
-		t.get();
-	});
+	maxConcurrentRequests = value > 0 ? value : 1;
+	UpdateMaxInFlight();
 }
 
-task<void> AnalyticsManager::DispatchQueuedHits(std::vector<Hit^> hits)
+bool AnalyticsManager::UseHttp2::get()
 {
-	HttpClient^ httpClient = GetHttpClient();
-	auto now = DateTimeHelper::Now();
-	std::vector<task<void>> tasks;
-	for (auto it = begin(hits); it != end(hits); ++it)
+	return useHttp2;
+}
+
+void AnalyticsManager::UseHttp2::set(bool value)
+{
+	if (useHttp2 != value)
 	{
-		Hit^ hit = *it;
+		useHttp2 = value;
+		ResetTransport();
+		UpdateMaxInFlight();
+	}
+}
 
-		if (isEnabled && (!ThrottlingEnabled || hitTokenBucket->Consume()))
-		{
-			// clone the data
-			std::unordered_map<String^, String^> payloadData;
-			for each (auto kvp in hit->Data)
-			{
-				payloadData[kvp->Key] = kvp->Value;
-			}
-			int milliSeconds = (int)(TimeSpanHelper::GetTotalMilliseconds(TimeSpanHelper::FromTicks(now.UniversalTime - hit->TimeStamp.UniversalTime)));
-			payloadData["qt"] = milliSeconds.ToString();
+int AnalyticsManager::MaxConcurrentStreams::get()
+{
+	return maxConcurrentStreams;
+}
 
-			tasks.push_back(DispatchHitData(hit, httpClient, payloadData));
-		}
-		else
-		{
-			std::lock_guard<std::mutex> lg(hitLock);
-			this->hits.push(hit);
-		}
-	}
-	return when_all(begin(tasks), end(tasks));
+void AnalyticsManager::MaxConcurrentStreams::set(int value)
+{
+	maxConcurrentStreams = value > 0 ? value : 1;
+	UpdateMaxInFlight();
 }
 
-task<void> AnalyticsManager::DispatchImmediateHit(Hit^ payload)
+void AnalyticsManager::UpdateMaxInFlight()
 {
-	HttpClient^ httpClient = GetHttpClient();
-	// clone the data
-	std::unordered_map<String^, String^> hitData;
-	for each (auto kvp in payload->Data)
-	{
-		hitData[kvp->Key] = kvp->Value;
-	}
-	return DispatchHitData(payload, httpClient, hitData);
+	// streams are cheap, but only where HTTP/2 is actually negotiated; over HTTP/1.1 each request in flight needs a connection of its own
+	bool isMultiplexed = useHttp2 && IsSecure && HttpClientTransport::IsHttp2Supported();
+	scheduler->SetMaxInFlight((size_t)(isMultiplexed ? maxConcurrentStreams : maxConcurrentRequests));
 }
 
-task<void> AnalyticsManager::DispatchHitData(Hit^ hit, HttpClient^ httpClient, std::unordered_map<String^, String^> hitData)
+bool AnalyticsManager::PersistQueuedHits::get()
 {
-	if (BustCache) hitData["z"] = GetCacheBuster();
+	return std::atomic_load(&hitLog) != nullptr;
+}
 
-	return SendHitAsync(hit, httpClient, hitData).then([this, hit](task<HttpResponseMessage^> t) {
-		try
+void AnalyticsManager::PersistQueuedHits::set(bool value)
+{
+	if (value != PersistQueuedHits)
+	{
+		if (value)
 		{
-			HttpResponseMessage^ response(t.get());
-			try
-			{
-				response->EnsureSuccessStatusCode();
-				OnHitSent(hit, response);
-			}
-			catch (Exception^ ex)
-			{
-				OnHitMalformed(hit, response);
-			}
+			OpenHitLog();
 		}
-		catch (Exception^ ex)
+		else
 		{
-			OnHitFailed(hit, ex);
+			CloseHitLog();
 		}
-	}, task_continuation_context::use_current());
+	}
 }
 
-task<HttpResponseMessage^> AnalyticsManager::SendHitAsync(Hit^ payload, HttpClient^ httpClient, std::unordered_map<String^, String^> payloadData)
+void AnalyticsManager::OpenHitLog()
 {
-	auto endPoint = IsDebug ? (IsSecure ? endPointSecureDebug : endPointUnsecureDebug) : (IsSecure ? endPointSecure : endPointUnsecure);
+	std::wstring directory(ApplicationData::Current->LocalFolder->Path->Data());
+	directory += L"\\GoogleAnalytics.HitLog";
+	auto log = std::make_shared<HitLog>(std::unique_ptr<ISegmentStore>(new DirectorySegmentStore(directory)));
 
-	std::wstring content;
-	auto it = begin(payloadData);
-	while (true)
+	auto recovered = log->Recover();
 	{
-		content += std::wstring(it->first->Data()) + L"=" + std::wstring(Uri::EscapeComponent(it->second)->Data());
-		it++;
-		if (it == end(payloadData)) break;
-		content += '&';
+		std::lock_guard<std::mutex> lg(hitLock);
+		for (auto it = begin(recovered); it != end(recovered); ++it)
+		{
+			PushHit(ref new Hit(std::move(it->Record), DateTimeHelper::FromUniversalTime(it->TimeStamp), it->Sequence));
+		}
 	}
+	EnforceQueueLimits();
+	std::atomic_store(&hitLog, log);
 
-#ifdef _DEBUG 
-	// 	::OutputDebugString(content.c_str());
-#endif 
+	// the compactor also commits whatever acknowledgements are still buffered
+	hitLogCompactionTimer = ThreadPoolTimer::CreatePeriodicTimer(ref new TimerElapsedHandler([log](ThreadPoolTimer^ timer) {
+		log->Commit();
+		log->Compact();
+	}), TimeSpanHelper::FromMinutes(1));
 
-	if (PostData)
+	if (!recovered.empty())
 	{
-		auto httpContent = ref new Windows::Web::Http::HttpStringContent(ref new String(content.c_str()));
-		return create_task([httpClient, endPoint, httpContent]() { return httpClient->PostAsync(endPoint, httpContent); });
+		if (dispatchPeriod.Duration == 0)
+		{
+			DispatchAsync();
+		}
+		else
+		{
+			// recovered hits skip OnHitQueued, so they open a cycle of their own
+			HoldQueuedHits();
+		}
 	}
-	else
+}
+
+void AnalyticsManager::CloseHitLog()
+{
+	if (hitLogCompactionTimer)
 	{
-		auto url = endPoint->RawUri + L"?" + ref new String(content.c_str());
-		return create_task([httpClient, url]() { return httpClient->GetAsync(ref new Uri(url)); });
+		hitLogCompactionTimer->Cancel();
+		hitLogCompactionTimer = nullptr;
 	}
+	auto log = std::atomic_load(&hitLog);
+	std::atomic_store(&hitLog, std::shared_ptr<HitLog>());
+	log->Commit();
+	log->Compact();
 }
 
-void AnalyticsManager::OnHitFailed(Hit^ payload, Exception^ exception)
+void AnalyticsManager::LogHit(Hit^ hit)
 {
-	HitFailed(this, ref new HitFailedEventArgs(payload, exception->Message));
+	auto log = std::atomic_load(&hitLog);
+	if (log)
+	{
+		bool isFirstPending;
+		if (hit->GetBaseRecord())
+		{
+			// the shared tracker parameters are written out with each hit so it can be replayed on its own
+			hit->SetLogSequence(log->Append(hit->Flatten(), hit->TimeStamp.UniversalTime, isFirstPending));
+		}
+		else
+		{
+			hit->SetLogSequence(log->Append(hit->GetRecord(), hit->TimeStamp.UniversalTime, isFirstPending));
+		}
+		if (isFirstPending)
+		{
+			ScheduleHitLogCommit(log);
+		}
+	}
 }
 
-void AnalyticsManager::OnHitSent(Hit^ payload, HttpResponseMessage^ response)
+void AnalyticsManager::AcknowledgeHit(Hit^ hit)
 {
-	create_task([response]() { return response->Content->ReadAsStringAsync(); }).then([this, payload](task<Platform::String^> t) {
-		HitSent(this, ref new HitSentEventArgs(payload, t.get()));
-	});
+	auto log = std::atomic_load(&hitLog);
+	if (log && hit->GetLogSequence() != 0)
+	{
+		bool isFirstPending;
+		log->Acknowledge(hit->GetLogSequence(), isFirstPending);
+		if (isFirstPending)
+		{
+			ScheduleHitLogCommit(log);
+		}
+	}
 }
 
-void AnalyticsManager::OnHitMalformed(GoogleAnalytics::Hit^ payload, HttpResponseMessage^ response)
+void AnalyticsManager::ScheduleHitLogCommit(std::shared_ptr<HitLog> log)
 {
-	HitMalformed(this, ref new HitMalformedEventArgs(payload, (int)(response->StatusCode)));
+	// group commit: whatever is appended before the timer fires goes out in the same write
+	ThreadPoolTimer::CreateTimer(ref new TimerElapsedHandler([log](ThreadPoolTimer^ timer) {
+		log->Commit();
+	}), TimeSpanHelper::FromMilliseconds(50));
 }
 
-HttpClient^ AnalyticsManager::GetHttpClient()
+DispatchStatistics^ AnalyticsManager::Statistics::get()
 {
-	auto result = ref new HttpClient();
-	if (UserAgent)
-	{
-		result->DefaultRequestHeaders->UserAgent->ParseAdd(UserAgent);
-	}
-	return result;
+	return ref new DispatchStatistics(*counters);
 }
 
-String^ AnalyticsManager::GetCacheBuster()
+int AnalyticsManager::GetCacheBuster()
 {
-	return (rand() % 100000000).ToString();
+	return rand() % 100000000;
 }
 
 
@@ -522,42 +1974,96 @@ void AnalyticsManager::AutoTrackNetworkConnectivity::set(bool value)
 	if (autoTrackNetworkConnectivity != value)
 	{
 		autoTrackNetworkConnectivity = value;
+		auto provider = std::atomic_load(&connectivityProvider);
 		if (autoTrackNetworkConnectivity)
 		{
+			if (!provider)
+			{
+				provider = std::make_shared<NetworkConnectivityProvider>();
+				std::atomic_store(&connectivityProvider, provider);
+			}
+			provider->Start([this]() { UpdateConnectionStatus(); });
 			UpdateConnectionStatus();
-			networkStatusChangedEventToken = NetworkInformation::NetworkStatusChanged += ref new NetworkStatusChangedEventHandler(this, &AnalyticsManager::NetworkInformation_NetworkStatusChanged);
 		}
 		else
 		{
-			NetworkInformation::NetworkStatusChanged -= networkStatusChangedEventToken;
-			IsEnabled = true;
+			if (provider)
+			{
+				provider->Stop();
+			}
+			isDeferringLowPriority = false;
+			if (!isConnected.exchange(true) && isEnabled)
+			{
+				DispatchAsync();
+			}
 		}
 	}
 }
 
-void AnalyticsManager::NetworkInformation_NetworkStatusChanged(Object^ sender)
+void AnalyticsManager::SetConnectivityProvider(std::shared_ptr<IConnectivityProvider> provider)
 {
-	UpdateConnectionStatus();
+	auto previous = std::atomic_load(&connectivityProvider);
+	if (previous && autoTrackNetworkConnectivity)
+	{
+		previous->Stop();
+	}
+	if (!provider)
+	{
+		provider = std::make_shared<NetworkConnectivityProvider>();
+	}
+	std::atomic_store(&connectivityProvider, provider);
+	if (autoTrackNetworkConnectivity)
+	{
+		provider->Start([this]() { UpdateConnectionStatus(); });
+		UpdateConnectionStatus();
+	}
 }
 
 void AnalyticsManager::UpdateConnectionStatus()
 {
-	auto profile = NetworkInformation::GetInternetConnectionProfile();
-	if (profile)
+	auto provider = std::atomic_load(&connectivityProvider);
+	if (!provider) return;
+
+	auto state = provider->GetState();
+	bool isDeferring = state.IsMetered || state.IsSavingEnergy;
+	bool wasConnected = isConnected.exchange(state.IsConnected);
+	bool wasDeferring = isDeferringLowPriority.exchange(isDeferring);
+	if (state.IsConnected && (!wasConnected || (wasDeferring && !isDeferring)))
 	{
-		switch (profile->GetNetworkConnectivityLevel())
+		// whatever piled up meanwhile is sent at BacklogDrainRate rather than all at once
+		isDrainingBacklog = true;
+		if (isEnabled)
 		{
-		case NetworkConnectivityLevel::InternetAccess:
-		case NetworkConnectivityLevel::ConstrainedInternetAccess:
-			IsEnabled = true;
-			break;
-		default:
-			IsEnabled = false;
-			break;
+			DispatchAsync();
 		}
 	}
 }
 
+bool AnalyticsManager::CanDispatch()
+{
+	return isEnabled && isConnected;
+}
+
+double AnalyticsManager::BacklogDrainRate::get()
+{
+	return backlogBucket.GetFillRate();
+}
+
+void AnalyticsManager::BacklogDrainRate::set(double value)
+{
+	backlogBucket.SetFillRate(value);
+}
+
+int AnalyticsManager::OfflineQueueLimit::get()
+{
+	return offlineQueueLimit;
+}
+
+void AnalyticsManager::OfflineQueueLimit::set(int value)
+{
+	offlineQueueLimit = value < 0 ? 0 : value;
+}
+
 Windows::Foundation::EventRegistrationToken AnalyticsManager::HitFailed::add(Windows::Foundation::EventHandler<GoogleAnalytics::HitFailedEventArgs^>^ handler)
 {
 	hitFailedListenerCount++;
@@ -577,12 +2083,10 @@ void AnalyticsManager::HitFailed::raise(Platform::Object^ sender, HitFailedEvent
 	{
 		if (hitFailedListenerCount > 0)
 		{
-			dispatcher->RunAsync(
-				Windows::UI::Core::CoreDispatcherPriority::Normal,
-				ref new Windows::UI::Core::DispatchedHandler([this, sender, args]()
+			PostToUIThread([this, sender, args]()
 			{
 				internalHitFailedEventHandler(sender, args);
-			}));
+			});
 		}
 	}
 	else
@@ -609,12 +2113,10 @@ void AnalyticsManager::HitSent::raise(Platform::Object^ sender, HitSentEventArgs
 	{
 		if (hitSentListenerCount > 0)
 		{
-			dispatcher->RunAsync(
-				Windows::UI::Core::CoreDispatcherPriority::Normal,
-				ref new Windows::UI::Core::DispatchedHandler([this, sender, args]()
+			PostToUIThread([this, sender, args]()
 			{
 				internalHitSentEventHandler(sender, args);
-			}));
+			});
 		}
 	}
 	else
@@ -643,14 +2145,70 @@ void AnalyticsManager::HitMalformed::raise(Platform::Object^ sender, HitMalforme
 	{
 		if (hitMalformedListenerCount > 0)
 		{
-			dispatcher->RunAsync(
-				Windows::UI::Core::CoreDispatcherPriority::Normal,
-				ref new Windows::UI::Core::DispatchedHandler([this, sender, args]()
+			PostToUIThread([this, sender, args]()
 			{
 				internalHitMalformedEventHandler(sender, args);
-			}));
+			});
 		}
 	}
 	else
 		internalHitMalformedEventHandler(sender, args);
-}
\ No newline at end of file
+}
+
+Windows::Foundation::EventRegistrationToken AnalyticsManager::HitDropped::add(Windows::Foundation::EventHandler<GoogleAnalytics::HitDroppedEventArgs^>^ handler)
+{
+	hitDroppedListenerCount++;
+	return internalHitDroppedEventHandler += handler;
+}
+
+void AnalyticsManager::HitDropped::remove(Windows::Foundation::EventRegistrationToken token)
+{
+	//Note: Count can be off if caller (incorrectly) unregisters same event twice. 
+	hitDroppedListenerCount--;
+	internalHitDroppedEventHandler -= token;
+}
+
+void AnalyticsManager::HitDropped::raise(Platform::Object^ sender, HitDroppedEventArgs^ args)
+{
+	if (fireEventsOnUIThread)
+	{
+		if (hitDroppedListenerCount > 0)
+		{
+			PostToUIThread([this, sender, args]()
+			{
+				internalHitDroppedEventHandler(sender, args);
+			});
+		}
+	}
+	else
+		internalHitDroppedEventHandler(sender, args);
+}
+
+Windows::Foundation::EventRegistrationToken AnalyticsManager::HitsCompleted::add(Windows::Foundation::EventHandler<GoogleAnalytics::HitsCompletedEventArgs^>^ handler)
+{
+	hitsCompletedListenerCount++;
+	return internalHitsCompletedEventHandler += handler;
+}
+
+void AnalyticsManager::HitsCompleted::remove(Windows::Foundation::EventRegistrationToken token)
+{
+	//Note: Count can be off if caller (incorrectly) unregisters same event twice. 
+	hitsCompletedListenerCount--;
+	internalHitsCompletedEventHandler -= token;
+}
+
+void AnalyticsManager::HitsCompleted::raise(Platform::Object^ sender, HitsCompletedEventArgs^ args)
+{
+	if (fireEventsOnUIThread)
+	{
+		if (hitsCompletedListenerCount > 0)
+		{
+			PostToUIThread([this, sender, args]()
+			{
+				internalHitsCompletedEventHandler(sender, args);
+			});
+		}
+	}
+	else
+		internalHitsCompletedEventHandler(sender, args);
+}
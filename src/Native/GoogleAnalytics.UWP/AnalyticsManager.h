@@ -10,7 +10,21 @@
 #include <collection.h>
 #include <unordered_map>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
 #include "Hit.h"
+#include "HttpClientTransport.h"
+#include "HitsCompletedEventArgs.h"
+#include "HitValidationResult.h"
+#include "ConnectivityProvider.h"
+#include "DispatchStatistics.h"
+#include "DispatchScheduler.h"
+#include "FlushPolicy.h"
+#include "RetryPolicy.h"
+#include "HitLog.h"
+#include "HitAggregator.h"
+#include "IngestionRing.h"
 #include "TokenBucket.h"
 #include "Tracker.h"
 #include "IPlatformInfoProvider.h"
@@ -143,6 +157,128 @@ namespace GoogleAnalytics
 		}
 	};
 
+	/// <summary>
+	/// Supplies additional information when <see cref="Hit"/>s are discarded without being sent.
+	/// </summary>
+	public ref class HitDroppedEventArgs sealed
+	{
+	private:
+
+		HitDropReason reason;
+		GoogleAnalytics::Hit^ hit;
+
+	internal:
+
+		HitDroppedEventArgs(GoogleAnalytics::Hit^ hit, HitDropReason reason)
+			: reason(reason)
+			, hit(hit)
+		{ }
+
+	public:
+		/// <summary>
+		/// Gets why the hit was discarded.
+		/// </summary>
+		property HitDropReason Reason
+		{
+			HitDropReason get()
+			{
+				return reason;
+			}
+		}
+
+		/// <summary>
+		/// Gets the <see cref="Hit"/> associated with the event.
+		/// </summary>
+		property GoogleAnalytics::Hit^ Hit
+		{
+			GoogleAnalytics::Hit^ get()
+			{
+				return hit;
+			}
+		}
+	};
+
+	/// <summary>
+	/// Specifies which <see cref="Hit"/>s are discarded when the dispatch queue goes over <see cref="AnalyticsManager::QueueMemoryLimit"/>.
+	/// </summary>
+	public enum class QueueEvictionPolicy
+	{
+		/// <summary>
+		/// The oldest hits are discarded first, whatever their <see cref="HitPriority"/>.
+		/// </summary>
+		DropOldest,
+
+		/// <summary>
+		/// <see cref="HitPriority::Bulk"/> hits are discarded first, then <see cref="HitPriority::Normal"/> ones, oldest first within a class.
+		/// </summary>
+		DropLowestPriority,
+
+		/// <summary>
+		/// Every other hit of the lowest priority class is discarded, over and over, so the hits that are kept still cover the whole period they were queued in.
+		/// </summary>
+		SampleDown
+	};
+
+	/// <summary>
+	/// Specifies what happens to a <see cref="Hit"/> whose encoded parameters are over the 8192 byte payload limit of Google Analytics, which would reject it.
+	/// </summary>
+	public enum class OversizedPayloadPolicy
+	{
+		/// <summary>
+		/// The longest values are cut short, all to the same length, until the payload fits.
+		/// </summary>
+		Truncate,
+
+		/// <summary>
+		/// The hit is discarded before it is sent and reported through <see cref="AnalyticsManager::HitDropped"/>.
+		/// </summary>
+		Reject
+	};
+
+	/// <summary>
+	/// Specifies what happens to a new <see cref="Hit"/> when the ingestion queue is full.
+	/// </summary>
+	public enum class QueueOverflowPolicy
+	{
+		/// <summary>
+		/// The oldest hit waiting in the ingestion queue is discarded to make room.
+		/// </summary>
+		DropOldest,
+
+		/// <summary>
+		/// The new hit is discarded.
+		/// </summary>
+		DropNewest,
+
+		/// <summary>
+		/// The sending thread waits until the waiting hits have been moved to the dispatch queue, which happens on the thread pool, then
+		/// queues the new hit. No hit is lost, but the sending thread, possibly the UI thread, stalls for as long as that takes.
+		/// </summary>
+		Block
+	};
+
+	/// <summary>
+	/// A hit as captured on the thread that sent it, before it is turned into a <see cref="Hit"/>.
+	/// </summary>
+	struct CapturedHit
+	{
+		std::shared_ptr<const GoogleAnalytics::HitRecord> TrackerParameters;
+
+		/// <summary>
+		/// A copy of the parameters of the hit, taken on the sending thread so the caller remains free to reuse its map.
+		/// </summary>
+		std::shared_ptr<GoogleAnalytics::HitRecord> Parameters;
+
+		/// <summary>
+		/// The monotonic time, in nanoseconds, at which the hit was sent.
+		/// </summary>
+		long long MonotonicTimeStamp;
+
+		CapturedHit()
+			: MonotonicTimeStamp(0)
+		{ }
+	};
+
 	/// <summary>
 	/// Provides shared infrastrcuture for <see cref="Tracker" /> in a Windows 10 Universal Windows app 
 	/// </summary>
@@ -164,12 +300,22 @@ namespace GoogleAnalytics
  
 		bool autoTrackNetworkConnectivity;
 
-		Windows::Foundation::EventRegistrationToken networkStatusChangedEventToken;
+		std::shared_ptr<IConnectivityProvider> connectivityProvider;
+
+		std::atomic<bool> isConnected;
+
+		std::atomic<bool> isDeferringLowPriority;
+
+		std::atomic<bool> isDrainingBacklog;
 
-		void NetworkInformation_NetworkStatusChanged(Platform::Object^ sender);
+		GoogleAnalytics::TokenBucket backlogBucket;
+
+		int offlineQueueLimit;
 
 		void UpdateConnectionStatus();
 
+		bool CanDispatch();
+
 		void LoadAppOptOut();
 
 		bool isAppOptOutSet;
@@ -178,8 +324,6 @@ namespace GoogleAnalytics
 
 		static Platform::String^ Key_AppOptOut;
 
-		std::mutex dispatcherLock;
-
 		std::mutex hitLock;
 
 		static Windows::Foundation::Uri^ endPointUnsecureDebug;
@@ -190,45 +334,260 @@ namespace GoogleAnalytics
 
 		static Windows::Foundation::Uri^ endPointSecure;
 
-		std::queue<GoogleAnalytics::Hit^> hits;
+		static Windows::Foundation::Uri^ endPointUnsecureBatch;
+
+		static Windows::Foundation::Uri^ endPointSecureBatch;
+
+		// one queue per HitPriority, guarded by hitLock
+		std::queue<GoogleAnalytics::Hit^> hits[3];
+
+		// bytes held by the hits in the queues, in all and per HitPriority, guarded by hitLock
+		size_t queuedBytes;
 
-		std::vector<concurrency::task<void>> dispatchingTasks;
+		size_t queuedClassBytes[3];
 
-		GoogleAnalytics::TokenBucket^ hitTokenBucket;
+		long long queueMemoryLimit;
 
-		Windows::System::Threading::ThreadPoolTimer^ timer;
+		QueueEvictionPolicy evictionPolicy;
+
+		/// <summary>
+		/// Queues a hit behind the others of its class. hitLock must be held.
+		/// </summary>
+		void PushHit(GoogleAnalytics::Hit^ hit);
+
+		/// <summary>
+		/// Removes the hit at the front of a class queue. hitLock must be held.
+		/// </summary>
+		GoogleAnalytics::Hit^ PopHit(size_t priority);
+
+		/// <summary>
+		/// Discards hits until the queues are within <see cref="QueueMemoryLimit"/> and, while offline, <see cref="OfflineQueueLimit"/>.
+		/// </summary>
+		void EnforceQueueLimits();
+
+		/// <summary>
+		/// Takes hits out of the queues, according to the eviction policy, until they are within the memory limit. hitLock must be held.
+		/// </summary>
+		void EvictHits(std::vector<GoogleAnalytics::Hit^>& evicted);
+
+		/// <summary>
+		/// Discards a hit that will not be sent, and tells why through <see cref="HitDropped"/>. Must not be called with hitLock held.
+		/// </summary>
+		void DropHit(GoogleAnalytics::Hit^ hit, HitDropReason reason);
+
+		/// <summary>
+		/// Empties the queues into a single sequence that interleaves the classes by weight. hitLock must be held.
+		/// </summary>
+		std::vector<GoogleAnalytics::Hit^> TakeQueuedHits();
+
+		bool HasQueuedHits();
+
+		/// <summary>
+		/// Returns whether a hit about to be captured will be <see cref="HitPriority::Critical"/>.
+		/// </summary>
+		static bool IsCritical(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ params);
+
+		std::atomic<IngestionRing<GoogleAnalytics::Hit^>*> ingestion;
+
+		std::vector<std::unique_ptr<IngestionRing<GoogleAnalytics::Hit^>>> ingestionRings;
+
+		std::mutex ingestionLock;
+
+		/// <summary>
+		/// The number of threads using the current ingestion ring, see <see cref="IngestionCapacity"/>.
+		/// </summary>
+		std::atomic<int> ingestionUsers;
+
+		QueueOverflowPolicy overflowPolicy;
+
+		/// <summary>
+		/// Notified each time <see cref="DrainIngestion"/> has made room, for threads waiting under <see cref="QueueOverflowPolicy::Block"/>.
+		/// </summary>
+		std::condition_variable ingestionDrained;
+
+		std::mutex ingestionWaitLock;
+
+		std::atomic<bool> isDrainScheduled;
+
+		void ScheduleIngestionDrain();
+
+		void Ingest(GoogleAnalytics::Hit^ hit);
+
+		void Enqueue(GoogleAnalytics::Hit^ hit);
+
+		void Submit(GoogleAnalytics::Hit^ hit);
+
+		void DrainIngestion();
+
+		std::atomic<IngestionRing<CapturedHit>*> capture;
+
+		std::vector<std::unique_ptr<IngestionRing<CapturedHit>>> captureRings;
+
+		std::mutex captureLock;
+
+		std::atomic<int> captureUsers;
+
+		std::atomic<bool> isPreparing;
+
+		void SchedulePreparation();
+
+		void PrepareCapturedHits();
+
+		void PrepareHit(CapturedHit& captured);
+
+		HitAggregator aggregator;
+
+		std::mutex aggregationLock;
+
+		Windows::System::Threading::ThreadPoolTimer^ aggregationTimer;
+
+		long long aggregationDue;
+
+		bool Aggregate(GoogleAnalytics::Hit^ hit);
+
+		void FlushAggregatedHits(long long now);
+
+		void ScheduleAggregationFlush(long long due);
+
+		void SetAggregationRule(Platform::String^ category, bool isTiming, Windows::Foundation::TimeSpan window, int countMetricIndex, int minMetricIndex, int maxMetricIndex);
+
+		GoogleAnalytics::TokenBucket hitTokenBucket;
 
 		Windows::Foundation::TimeSpan dispatchPeriod;
 
+		GoogleAnalytics::FlushPolicy flushPolicy;
+
+		std::mutex flushLock;
+
+		// one shot, armed only while hits wait for the age trigger
+		Windows::System::Threading::ThreadPoolTimer^ flushTimer;
+
+		long long flushDue;
+
+		/// <summary>
+		/// Feeds a hit joining the queue to the flush policy, and arms the timer or flushes as it decides.
+		/// </summary>
+		void OnHitQueued(GoogleAnalytics::Hit^ hit);
+
+		/// <summary>
+		/// Starts a new flush cycle and disarms the timer, as queued hits are about to go out.
+		/// </summary>
+		void ResetFlushCycle();
+
+		/// <summary>
+		/// Keeps a flush cycle open for the hits a dispatch left in the queue.
+		/// </summary>
+		void HoldQueuedHits();
+
+		void ArmFlushTimer(long long due);
+
+		void DisarmFlushTimer();
+
 		bool isEnabled; 
 
 		bool autoAppLifetimeMonitoring; 
 
-		void timer_Tick(Windows::System::Threading::ThreadPoolTimer^ sender);
-
 		concurrency::task<void> _DispatchAsync();
 
-		concurrency::task<void> _SuspendAsync();
+		/// <summary>
+		/// Sends what is queued and may go out now, without first preparing the captured hits.
+		/// </summary>
+		concurrency::task<void> FlushQueue();
 
-		concurrency::task<void> RunDispatchingTask(concurrency::task<void> newDispatchingTask);
+		concurrency::task<void> _SuspendAsync();
 
 		concurrency::task<void> DispatchQueuedHits(std::vector<Hit^> hits);
 
 		concurrency::task<void> DispatchImmediateHit(GoogleAnalytics::Hit^ hit);
 
-		concurrency::task<void> DispatchHitData(GoogleAnalytics::Hit^ hit, Windows::Web::Http::HttpClient^ httpClient, std::unordered_map<Platform::String^, Platform::String^> hitData);
+		concurrency::task<void> DispatchHitData(GoogleAnalytics::Hit^ hit, std::shared_ptr<IHitTransport> transport, std::string payload);
+
+		concurrency::task<void> DispatchBatch(std::vector<GoogleAnalytics::Hit^> hits, std::shared_ptr<IHitTransport> transport, std::string content, std::string contentEncoding);
+
+		std::string CompressPayloads(const std::vector<const std::string*>& payloads, size_t contentSize);
+
+		concurrency::task<HitResponse> SendHitAsync(GoogleAnalytics::Hit^ hit, std::shared_ptr<IHitTransport> transport, const std::string& payload);
+
+		/// <summary>
+		/// Encodes the parameters of a hit, and its queue time unless queueTime is negative. Returns an empty string when the hit is over the payload limit and must be dropped.
+		/// </summary>
+		std::string EncodeHit(GoogleAnalytics::Hit^ hit, long long queueTime);
+
+		OversizedPayloadPolicy payloadPolicy;
+
+		int maxGetPayloadSize;
+
+		void OnHitFailed(GoogleAnalytics::Hit^ hit, Platform::String^ error);
+
+		void OnHitSent(GoogleAnalytics::Hit^ hit, const HitResponse& response);
+
+		void OnHitMalformed(GoogleAnalytics::Hit^ hit, const HitResponse& response);
+
+		void OnBatchFailed(const std::vector<GoogleAnalytics::Hit^>& hits, Platform::String^ error);
+
+		void OnBatchSent(const std::vector<GoogleAnalytics::Hit^>& hits, const HitResponse& response);
+
+		void OnBatchMalformed(const std::vector<GoogleAnalytics::Hit^>& hits, const HitResponse& response);
+
+		std::shared_ptr<IHitTransport> transportOverride;
+
+		std::shared_ptr<IHitTransport> transport;
+
+		Platform::String^ transportUserAgent;
+
+		bool transportIsSecure;
+
+		std::mutex transportLock;
+
+		int maxConnections;
+
+		bool useHttp2;
+
+		int maxConcurrentRequests;
+
+		int maxConcurrentStreams;
 
-		concurrency::task<Windows::Web::Http::HttpResponseMessage^> SendHitAsync(GoogleAnalytics::Hit^ hit, Windows::Web::Http::HttpClient^ httpClient, std::unordered_map<Platform::String^, Platform::String^> hitData);
+		void UpdateMaxInFlight();
 
-		void OnHitFailed(GoogleAnalytics::Hit^ hit, Platform::Exception^ exception);
+		Windows::Foundation::TimeSpan connectionIdleTimeout;
 
-		void OnHitSent(GoogleAnalytics::Hit^ hit, Windows::Web::Http::HttpResponseMessage^ response);
+		std::shared_ptr<DispatchCounters> counters;
 
-		void OnHitMalformed(GoogleAnalytics::Hit^ hit, Windows::Web::Http::HttpResponseMessage^ response);
+		std::shared_ptr<DispatchScheduler> scheduler;
 
-		Windows::Web::Http::HttpClient^ GetHttpClient();
+		RetryPolicy retryPolicy;
 
-		static Platform::String^ GetCacheBuster();
+		std::mutex retryLock;
+
+		Windows::System::Threading::ThreadPoolTimer^ retryTimer;
+
+		std::chrono::steady_clock::time_point retryDue;
+
+		long long GetHitAge(GoogleAnalytics::Hit^ hit);
+
+		bool IsHitExpired(GoogleAnalytics::Hit^ hit);
+
+		void ScheduleRetryDispatch(std::chrono::steady_clock::time_point due);
+
+		std::shared_ptr<IHitTransport> GetTransport();
+
+		void ResetTransport();
+
+		std::shared_ptr<HitLog> hitLog;
+
+		Windows::System::Threading::ThreadPoolTimer^ hitLogCompactionTimer;
+
+		void OpenHitLog();
+
+		void CloseHitLog();
+
+		void LogHit(GoogleAnalytics::Hit^ hit);
+
+		void AcknowledgeHit(GoogleAnalytics::Hit^ hit);
+
+		void ScheduleHitLogCommit(std::shared_ptr<HitLog> log);
+
+		static int GetCacheBuster();
 
 		GoogleAnalytics::IPlatformInfoProvider^ platformTrackingInfo;
 
@@ -237,11 +596,59 @@ namespace GoogleAnalytics
 		Windows::UI::Core::CoreDispatcher^ dispatcher; 
 		bool fireEventsOnUIThread; 
 		
-		int   hitSentListenerCount, hitFailedListenerCount, hitMalformedListenerCount; 
+		int   hitSentListenerCount, hitFailedListenerCount, hitMalformedListenerCount, hitDroppedListenerCount, hitsCompletedListenerCount; 
 
 		event Windows::Foundation::EventHandler<GoogleAnalytics::HitSentEventArgs^>^ internalHitSentEventHandler; 
 		event Windows::Foundation::EventHandler<GoogleAnalytics::HitFailedEventArgs^>^ internalHitFailedEventHandler;
 		event Windows::Foundation::EventHandler<GoogleAnalytics::HitMalformedEventArgs^>^ internalHitMalformedEventHandler;
+		event Windows::Foundation::EventHandler<GoogleAnalytics::HitDroppedEventArgs^>^ internalHitDroppedEventHandler;
+		event Windows::Foundation::EventHandler<GoogleAnalytics::HitsCompletedEventArgs^>^ internalHitsCompletedEventHandler;
+
+		std::mutex completedLock;
+
+		// results waiting for the end of the dispatch, guarded by completedLock
+		std::vector<GoogleAnalytics::HitResult^> completedHits;
+
+		/// <summary>
+		/// Adds the outcome of a hit to the next <see cref="HitsCompleted"/>, if anyone listens to it.
+		/// </summary>
+		void RecordCompletion(GoogleAnalytics::Hit^ hit, HitStatus status, int httpStatusCode, Platform::String^ error, HitDropReason dropReason, std::shared_ptr<ResponseBody> responseBody);
+
+		void RaiseHitsCompleted();
+
+		std::mutex uiLock;
+
+		// event invocations waiting for the dispatcher callback, guarded by uiLock
+		std::vector<std::function<void()>> uiActions;
+
+		bool isUIActionPosted;
+
+		/// <summary>
+		/// Runs an event invocation on the UI thread. Invocations queued while a dispatcher callback is pending share it, so a burst of events costs one callback.
+		/// </summary>
+		void PostToUIThread(std::function<void()> action);
+
+		void RunUIActions();
+
+	internal:
+
+		/// <summary>
+		/// Replaces the HTTP stack used to send hits, e.g. with a loopback stand-in for the collector. Pass nullptr to restore the default.
+		/// </summary>
+		void SetTransport(std::shared_ptr<IHitTransport> transport);
+
+		/// <summary>
+		/// Queues a hit made of the tracker level parameters of a <see cref="Tracker"/>, shared between its hits, and the parameters of this hit, which take precedence.
+		/// </summary>
+		/// <remarks>
+		/// Only copies the parameters and takes a time stamp; the hit is built, persisted and encoded later on the thread pool.
+		/// </remarks>
+		void EnqueueTrackerHit(std::shared_ptr<const GoogleAnalytics::HitRecord> trackerParameters, Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ params);
+
+		/// <summary>
+		/// Replaces the source of connectivity information used when <see cref="AutoTrackNetworkConnectivity"/> is set, e.g. with a scripted stand-in. Pass nullptr to restore the default.
+		/// </summary>
+		void SetConnectivityProvider(std::shared_ptr<IConnectivityProvider> provider);
 
 	public:
 		
@@ -273,12 +680,54 @@ namespace GoogleAnalytics
 		/// <summary>
 		/// Enables (when set to true) listening to network connectivity events to have trackers behave accordingly to their connectivity status.  
 		/// </summary>
+		/// <remarks>
+		/// While offline, hits are kept (up to <see cref="OfflineQueueLimit"/>) but not sent. Once the connection is back, they are sent at <see cref="BacklogDrainRate"/> rather than all at once.
+		/// On metered networks and in battery saver mode, non-interaction and timing hits are held back until neither applies, or until they expire.
+		/// </remarks>
 		property bool AutoTrackNetworkConnectivity
 		{
 			bool get();
 			void set(bool value);
 		}
 
+		/// <summary>
+		/// Gets or sets how many hits per second are sent from the backlog built up while the network was unavailable. Default is 5.
+		/// </summary>
+		property double BacklogDrainRate
+		{
+			double get();
+			void set(double value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many hits are kept while the network is unavailable. Default is 1000.
+		/// </summary>
+		/// <remarks>Non-interaction and timing hits are discarded first beyond that, then the oldest ones.</remarks>
+		property int OfflineQueueLimit
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many bytes of memory the hits waiting to be sent may take, e.g. while dispatching is disabled or throttled. Default is 2 MB.
+		/// </summary>
+		/// <remarks>See <see cref="EvictionPolicy"/> for which hits are discarded beyond that. Zero or less removes the limit.</remarks>
+		property long long QueueMemoryLimit
+		{
+			long long get();
+			void set(long long value);
+		}
+
+		/// <summary>
+		/// Gets or sets which hits are discarded when the queue goes over <see cref="QueueMemoryLimit"/>. Default is <see cref="QueueEvictionPolicy::DropLowestPriority"/>.
+		/// </summary>
+		property QueueEvictionPolicy EvictionPolicy
+		{
+			QueueEvictionPolicy get();
+			void set(QueueEvictionPolicy value);
+		}
+
 		property GoogleAnalytics::Tracker^ DefaultTracker;
 
 		/// <summary>
@@ -344,6 +793,30 @@ namespace GoogleAnalytics
 			void remove(Windows::Foundation::EventRegistrationToken token);
 			void raise(Platform::Object^ sender, HitMalformedEventArgs^ args);
 		}
+
+		/// <summary>
+		/// Provides the outcome of all the <see cref="Hit"/>s completed during a dispatch at once.
+		/// </summary>
+		/// <remarks>
+		/// Raised at the end of each dispatch, or after each hit when <see cref="DispatchPeriod"/> is zero, instead of once per hit like <see cref="HitSent"/>,
+		/// <see cref="HitFailed"/>, <see cref="HitMalformed"/> and <see cref="HitDropped"/>. Response bodies are not read unless <see cref="HitResult::ReadResponseAsync"/> is called.
+		/// </remarks>
+		event Windows::Foundation::EventHandler<HitsCompletedEventArgs^>^ HitsCompleted
+		{
+			Windows::Foundation::EventRegistrationToken add(Windows::Foundation::EventHandler<GoogleAnalytics::HitsCompletedEventArgs^>^ handler);
+			void remove(Windows::Foundation::EventRegistrationToken token);
+			void raise(Platform::Object^ sender, HitsCompletedEventArgs^ args);
+		}
+
+		/// <summary>
+		/// Provides notification that a <see cref="Hit"/> was discarded without being sent, e.g. to keep the queue within its limits.
+		/// </summary>
+		event Windows::Foundation::EventHandler<HitDroppedEventArgs^>^ HitDropped
+		{
+			Windows::Foundation::EventRegistrationToken add(Windows::Foundation::EventHandler<GoogleAnalytics::HitDroppedEventArgs^>^ handler);
+			void remove(Windows::Foundation::EventRegistrationToken token);
+			void raise(Platform::Object^ sender, HitDroppedEventArgs^ args);
+		}
 		/// <summary>
 		/// Gets or sets whether <see cref="Hit"/>s should be sent via SSL. Default is true.
 		/// </summary>
@@ -352,6 +825,7 @@ namespace GoogleAnalytics
 		/// <summary>
 		/// Gets or sets whether <see cref="Hit"/>s should be sent to the debug endpoint. Default is false.
 		/// </summary>
+		/// <remarks>Use <see cref="ValidateHit"/> to check hits without a round trip, and <see cref="HitValidationResult::ParseDebugResponse"/> to read the responses.</remarks>
 		property bool IsDebug;
 
 		/// <summary>
@@ -359,11 +833,167 @@ namespace GoogleAnalytics
 		/// </summary>
 		property bool ThrottlingEnabled;
 
+		/// <summary>
+		/// Gets or sets how many hits can be sent in a burst when throttling is enabled. Default is 60.
+		/// </summary>
+		property double ThrottlingCapacity
+		{
+			double get();
+			void set(double value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many hits per second are allowed once a burst is used up, when throttling is enabled. Default is 0.5.
+		/// </summary>
+		property double ThrottlingFillRate
+		{
+			double get();
+			void set(double value);
+		}
+
 		/// <summary>
 		/// Gets or sets whether data should be sent via POST or GET method. Default is POST.
 		/// </summary>
+		/// <remarks>With GET, hits whose payload is over <see cref="MaxGetPayloadSize"/> are still sent with POST.</remarks>
 		property bool PostData;
 
+		/// <summary>
+		/// Gets or sets the largest payload, in bytes, sent in the query string of a GET request when <see cref="PostData"/> is false. Default is 2000.
+		/// </summary>
+		/// <remarks>Longer URLs are cut short or refused by some proxies and servers, so larger hits go by POST.</remarks>
+		property int MaxGetPayloadSize
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets what happens to hits over the 8192 byte payload limit of Google Analytics. Default is <see cref="OversizedPayloadPolicy::Truncate"/>.
+		/// </summary>
+		/// <remarks>Such hits would otherwise only be found out through <see cref="HitMalformed"/>, after a round trip.</remarks>
+		property OversizedPayloadPolicy PayloadPolicy
+		{
+			OversizedPayloadPolicy get();
+			void set(OversizedPayloadPolicy value);
+		}
+
+		/// <summary>
+		/// Gets or sets whether POST bodies are gzip compressed. Default is false.
+		/// </summary>
+		/// <remarks>
+		/// Bodies are sent with Content-Encoding: gzip, so the collector has to accept it. Hits in a batch are compressed as one stream and share their common parameters.
+		/// A body is sent as is when compressing does not make it smaller. See <see cref="DispatchStatistics::CompressionRatio"/> for whether it pays off.
+		/// </remarks>
+		property bool CompressPostData;
+
+		/// <summary>
+		/// Gets or sets whether queued hits should be sent together through the batch endpoint. Default is false.
+		/// </summary>
+		/// <remarks>Up to 20 hits (and 16K of payload) are sent per request. Only applies to POST requests sent by a periodic or manual dispatch, and is ignored when <see cref="IsDebug"/> is set.</remarks>
+		property bool BatchDispatch;
+
+		/// <summary>
+		/// Gets or sets the maximum number of simultaneous connections opened to the service. Default is 2.
+		/// </summary>
+		/// <remarks>Connections are kept alive and reused across dispatches. Zero leaves the limit to the platform.</remarks>
+		property int MaxConnections
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets how long connections to the service may stay idle before they are released. Default is 60 seconds.
+		/// </summary>
+		property Windows::Foundation::TimeSpan ConnectionIdleTimeout
+		{
+			Windows::Foundation::TimeSpan get();
+			void set(Windows::Foundation::TimeSpan value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many requests may be on the wire at the same time. Default is 2.
+		/// </summary>
+		/// <remarks>
+		/// Further requests wait their turn in order, so a burst of hits is pipelined over the available slots instead of all being issued at once.
+		/// Replaced by <see cref="MaxConcurrentStreams"/> while <see cref="UseHttp2"/> is in effect.
+		/// </remarks>
+		property int MaxConcurrentRequests
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets whether hits are sent over HTTP/2 when the platform supports it. Default is false.
+		/// </summary>
+		/// <remarks>
+		/// All requests then share a single connection as concurrent streams, and the headers they repeat are compressed away, which saves most of
+		/// the connection setup and header bytes when a backlog is sent. HTTP/2 requires <see cref="IsSecure"/>; <see cref="MaxConnections"/> is ignored.
+		/// </remarks>
+		property bool UseHttp2
+		{
+			bool get();
+			void set(bool value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many requests may be on the wire at the same time over HTTP/2. Default is 16.
+		/// </summary>
+		/// <remarks>Servers also advertise a limit of their own, typically 100 streams, beyond which the platform queues requests anyway.</remarks>
+		property int MaxConcurrentStreams
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many sent hits can wait to be prepared on the thread pool. Default is 1024.
+		/// </summary>
+		/// <remarks>The value is rounded up to a power of two. Once it is reached, the sending thread prepares its hits itself until the thread pool catches up.</remarks>
+		property int CaptureCapacity
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets how many hits can wait in the lock-free ingestion queue between two dispatches. Default is 4096.
+		/// </summary>
+		/// <remarks>The value is rounded up to a power of two. See <see cref="OverflowPolicy"/> for what happens once it is reached.</remarks>
+		property int IngestionCapacity
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets what happens to new hits when the ingestion queue is full. Default is <see cref="QueueOverflowPolicy::DropOldest"/>.
+		/// </summary>
+		property QueueOverflowPolicy OverflowPolicy
+		{
+			QueueOverflowPolicy get();
+			void set(QueueOverflowPolicy value);
+		}
+
+		/// <summary>
+		/// Gets or sets whether queued hits are also written to disk so they survive the app being terminated. Default is false.
+		/// </summary>
+		/// <remarks>When turned on, hits that were still undelivered the last time the app ran are queued again with their original time stamp.</remarks>
+		property bool PersistQueuedHits
+		{
+			bool get();
+			void set(bool value);
+		}
+
+		/// <summary>
+		/// Gets a snapshot of the counters describing how hits have been dispatched so far.
+		/// </summary>
+		property GoogleAnalytics::DispatchStatistics^ Statistics
+		{
+			GoogleAnalytics::DispatchStatistics^ get();
+		}
+
 		/// <summary>
 		/// Gets or sets whether a cache buster should be applied to all requests. Default is false.
 		/// </summary>
@@ -375,15 +1005,37 @@ namespace GoogleAnalytics
 		property Platform::String^ UserAgent;
 
 		/// <summary>
-		/// Gets or sets the frequency at which hits should be sent to the service. Default is immediate.
+		/// Gets or sets the longest a hit waits in the queue before it is sent. Default is immediate.
 		/// </summary>
-		/// <remarks>Setting to TimeSpan.Zero will cause the hit to get sent immediately.</remarks>
+		/// <remarks>
+		/// Setting to TimeSpan.Zero will cause the hit to get sent immediately.
+		/// Otherwise hits are sent together once the first of them has waited this long, or earlier when <see cref="FlushHitThreshold"/> hits or
+		/// <see cref="FlushByteThreshold"/> bytes are queued. No timer runs while the queue is empty.
+		/// </remarks>
 		property Windows::Foundation::TimeSpan DispatchPeriod
 		{
 			Windows::Foundation::TimeSpan get();
 			void set(Windows::Foundation::TimeSpan value);
 		}
 
+		/// <summary>
+		/// Gets or sets the number of queued hits that triggers a dispatch before <see cref="DispatchPeriod"/> has elapsed. Default is 20, the most a batch request carries. Zero turns the trigger off.
+		/// </summary>
+		property int FlushHitThreshold
+		{
+			int get();
+			void set(int value);
+		}
+
+		/// <summary>
+		/// Gets or sets the size in bytes of queued hits, as counted against <see cref="QueueMemoryLimit"/>, that triggers a dispatch before <see cref="DispatchPeriod"/> has elapsed. Default is 64KB. Zero turns the trigger off.
+		/// </summary>
+		property int FlushByteThreshold
+		{
+			int get();
+			void set(int value);
+		}
+
 		/// <summary>
 		/// Gets or sets whether the dispatcher is enabled. If disabled, hits will be queued but not dispatched.
 		/// </summary>
@@ -408,10 +1060,11 @@ namespace GoogleAnalytics
 
 
 		/// <summary>		
-		/// When set to true, <see cref="AnalyticsManager::HitSent" />, <see cref="AnalyticsManager::HitMalformed" />, and <see cref="AnalyticsManager::HitFailed"/> will fire back into UI thread.          
+		/// When set to true, <see cref="AnalyticsManager::HitSent" />, <see cref="AnalyticsManager::HitMalformed" />, <see cref="AnalyticsManager::HitFailed"/>, <see cref="AnalyticsManager::HitDropped"/>, and <see cref="AnalyticsManager::HitsCompleted"/> will fire back into UI thread.          
 		/// </summary>
 		/// <remarks>
 		/// You must set this property to true to listen to these events from a Javascript app.
+		/// Events raised while the UI thread has yet to run the previous ones are delivered together, in a single dispatcher callback.
 		/// </remarks>
 		property bool FireEventsOnUIThread
 		{
@@ -423,12 +1076,47 @@ namespace GoogleAnalytics
 		/// <inheritdoc/>
 		virtual void EnqueueHit(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ params);
 
+		/// <summary>
+		/// Merges the event hits of a category that are sent within a time window and only differ by their value into a single hit.
+		/// </summary>
+		/// <param name="category">The event category (ec).</param>
+		/// <param name="window">How long after the first hit of a group the merged hit is queued. Zero stops merging the category.</param>
+		/// <param name="countMetricIndex">The index of the custom metric that receives the number of hits merged, so totals can still be reported.</param>
+		/// <remarks>The merged hit is the first one, with ev set to the sum of the values. Merged hits are held in memory until the window is over or the app is suspended.</remarks>
+		void AggregateEvents(Platform::String^ category, Windows::Foundation::TimeSpan window, int countMetricIndex);
+
+		/// <summary>
+		/// Merges the timing hits of a category that are sent within a time window and only differ by their time into a single hit.
+		/// </summary>
+		/// <param name="category">The user timing category (utc).</param>
+		/// <param name="window">How long after the first hit of a group the merged hit is queued. Zero stops merging the category.</param>
+		/// <param name="countMetricIndex">The index of the custom metric that receives the number of hits merged.</param>
+		/// <remarks>The merged hit is the first one, with utt set to the mean of the times rounded to the millisecond; no other statistic of the times is kept.</remarks>
+		void AggregateTimings(Platform::String^ category, Windows::Foundation::TimeSpan window, int countMetricIndex);
+
+		/// <summary>
+		/// Merges the timing hits of a category that are sent within a time window and only differ by their time into a single hit, keeping the shortest and longest times.
+		/// </summary>
+		/// <param name="category">The user timing category (utc).</param>
+		/// <param name="window">How long after the first hit of a group the merged hit is queued. Zero stops merging the category.</param>
+		/// <param name="countMetricIndex">The index of the custom metric that receives the number of hits merged.</param>
+		/// <param name="minMetricIndex">The index of the custom metric that receives the shortest time, in milliseconds, or 0 to leave it out.</param>
+		/// <param name="maxMetricIndex">The index of the custom metric that receives the longest time, in milliseconds, or 0 to leave it out.</param>
+		/// <remarks>The merged hit is the first one, with utt set to the mean of the times rounded to the millisecond.</remarks>
+		void AggregateTimings(Platform::String^ category, Windows::Foundation::TimeSpan window, int countMetricIndex, int minMetricIndex, int maxMetricIndex);
+
 		/// <summary>
 		/// Empties the queue of <see cref="Hit"/>s waiting to be dispatched.
 		/// </summary>
 		/// <remarks>If a <see cref="Hit"/> is actively beeing sent, this will not abort the request.</remarks>
 		void Clear();
 
+		/// <summary>
+		/// Checks a <see cref="Hit"/> against the Measurement Protocol rules, in process, the way the debug endpoint would.
+		/// </summary>
+		/// <remarks>Checks required parameters per hit type, value types and lengths, custom dimension and product indexes, and currency codes. The hit is not sent.</remarks>
+		HitValidationResult^ ValidateHit(Hit^ hit);
+
 		/// <summary>
 		/// Dispatches all hits in the queue.
 		/// </summary>
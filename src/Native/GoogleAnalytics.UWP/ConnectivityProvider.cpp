@@ -0,0 +1,73 @@
+//
+// ConnectivityProvider.cpp
+// Implementation of the NetworkConnectivityProvider class.
+//
+
+#include "pch.h"
+#include "ConnectivityProvider.h"
+
+using namespace GoogleAnalytics;
+using namespace Platform;
+using namespace Windows::Foundation;
+using namespace Windows::Networking::Connectivity;
+using namespace Windows::System::Power;
+
+NetworkConnectivityProvider::NetworkConnectivityProvider()
+	: isStarted(false)
+{ }
+
+NetworkConnectivityProvider::~NetworkConnectivityProvider()
+{
+	Stop();
+}
+
+ConnectivityState NetworkConnectivityProvider::GetState()
+{
+	ConnectivityState state;
+	state.IsConnected = false;
+	state.IsMetered = false;
+	state.IsSavingEnergy = PowerManager::EnergySaverStatus == EnergySaverStatus::On;
+
+	auto profile = NetworkInformation::GetInternetConnectionProfile();
+	if (profile)
+	{
+		switch (profile->GetNetworkConnectivityLevel())
+		{
+		case NetworkConnectivityLevel::InternetAccess:
+		case NetworkConnectivityLevel::ConstrainedInternetAccess:
+			state.IsConnected = true;
+			break;
+		default:
+			break;
+		}
+
+		auto cost = profile->GetConnectionCost();
+		if (cost)
+		{
+			state.IsMetered = cost->NetworkCostType == NetworkCostType::Fixed || cost->NetworkCostType == NetworkCostType::Variable || cost->Roaming || cost->OverDataLimit;
+		}
+	}
+	return state;
+}
+
+void NetworkConnectivityProvider::Start(std::function<void()> changed)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	if (isStarted) return;
+	networkStatusChangedEventToken = NetworkInformation::NetworkStatusChanged += ref new NetworkStatusChangedEventHandler([changed](Object^ sender) {
+		changed();
+	});
+	energySaverStatusChangedEventToken = PowerManager::EnergySaverStatusChanged += ref new EventHandler<Object^>([changed](Object^ sender, Object^ args) {
+		changed();
+	});
+	isStarted = true;
+}
+
+void NetworkConnectivityProvider::Stop()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	if (!isStarted) return;
+	NetworkInformation::NetworkStatusChanged -= networkStatusChangedEventToken;
+	PowerManager::EnergySaverStatusChanged -= energySaverStatusChangedEventToken;
+	isStarted = false;
+}
@@ -0,0 +1,81 @@
+//
+// ConnectivityProvider.h
+// Declaration of the IConnectivityProvider interface and the NetworkConnectivityProvider class.
+//
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// What the dispatcher needs to know about the network and power conditions of the device.
+	/// </summary>
+	struct ConnectivityState
+	{
+		/// <summary>
+		/// Whether the internet can be reached.
+		/// </summary>
+		bool IsConnected;
+
+		/// <summary>
+		/// Whether data is paid for by use, the network is roaming, or the data plan is over its limit.
+		/// </summary>
+		bool IsMetered;
+
+		/// <summary>
+		/// Whether the device is running on battery saver.
+		/// </summary>
+		bool IsSavingEnergy;
+	};
+
+	/// <summary>
+	/// Tells <see cref="AnalyticsManager"/> about connectivity, and when it changes.
+	/// </summary>
+	/// <remarks><see cref="AnalyticsManager"/> only learns about the network through this interface, so a scripted stand-in can replace the platform.</remarks>
+	class IConnectivityProvider
+	{
+	public:
+
+		virtual ~IConnectivityProvider() { }
+
+		virtual ConnectivityState GetState() = 0;
+
+		/// <summary>
+		/// Starts calling changed, from any thread, whenever the state may have changed.
+		/// </summary>
+		virtual void Start(std::function<void()> changed) = 0;
+
+		virtual void Stop() = 0;
+	};
+
+	/// <summary>
+	/// <see cref="IConnectivityProvider"/> implemented on top of NetworkInformation and PowerManager.
+	/// </summary>
+	class NetworkConnectivityProvider : public IConnectivityProvider
+	{
+	private:
+
+		std::mutex lock;
+
+		bool isStarted;
+
+		Windows::Foundation::EventRegistrationToken networkStatusChangedEventToken;
+
+		Windows::Foundation::EventRegistrationToken energySaverStatusChangedEventToken;
+
+	public:
+
+		NetworkConnectivityProvider();
+
+		virtual ~NetworkConnectivityProvider();
+
+		virtual ConnectivityState GetState() override;
+
+		virtual void Start(std::function<void()> changed) override;
+
+		virtual void Stop() override;
+	};
+}
@@ -0,0 +1,43 @@
+//
+// Crc32.cpp
+// Implementation of the Crc32 helper.
+//
+
+#include "pch.h"
+#include "Crc32.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	struct Crc32Table
+	{
+		uint32_t Entries[256];
+
+		Crc32Table()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				Entries[i] = c;
+			}
+		}
+	};
+
+	const Crc32Table Table;
+}
+
+uint32_t Crc32::Update(uint32_t crc, const void* data, size_t length)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = Table.Entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
@@ -0,0 +1,30 @@
+//
+// Crc32.h
+// Declaration of the Crc32 helper.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// CRC-32 (IEEE 802.3, as used by zip and gzip).
+	/// </summary>
+	class Crc32
+	{
+	public:
+
+		/// <summary>
+		/// Continues a checksum over more data. Start with a crc of 0.
+		/// </summary>
+		static uint32_t Update(uint32_t crc, const void* data, size_t length);
+
+		static uint32_t Compute(const void* data, size_t length)
+		{
+			return Update(0, data, length);
+		}
+	};
+}
@@ -5,16 +5,15 @@
 
 #include "pch.h"
 #include "DateTimeHelper.h"
+#include "TimeSource.h"
 
 using namespace GoogleAnalytics;
 using namespace Platform;
 using namespace Windows::Foundation;
-using namespace Windows::Globalization;
 
 DateTime DateTimeHelper::Now()
 {
-	auto calendar = ref new Calendar();
-	return calendar->GetDateTime();
+	return FromUniversalTime(TimeSource::UniversalNow());
 }
 
 DateTime DateTimeHelper::FromUniversalTime(long long universalTime)
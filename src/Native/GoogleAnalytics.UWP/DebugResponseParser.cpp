@@ -0,0 +1,217 @@
+//
+// DebugResponseParser.cpp
+// Implementation of the DebugResponseParser class.
+//
+
+#include "pch.h"
+#include <cwchar>
+#include "DebugResponseParser.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	bool IsName(const std::wstring& name, const wchar_t* text)
+	{
+		return name.compare(text) == 0;
+	}
+
+	int HexValue(wchar_t c)
+	{
+		if (c >= L'0' && c <= L'9') return c - L'0';
+		if (c >= L'a' && c <= L'f') return c - L'a' + 10;
+		if (c >= L'A' && c <= L'F') return c - L'A' + 10;
+		return -1;
+	}
+}
+
+DebugResponseParser::DebugResponseParser(const wchar_t* text, size_t length)
+	: position(text)
+	, end(text + length)
+{ }
+
+void DebugResponseParser::SkipWhitespace()
+{
+	while (position != end && (*position == L' ' || *position == L'\t' || *position == L'\n' || *position == L'\r'))
+	{
+		++position;
+	}
+}
+
+bool DebugResponseParser::Consume(wchar_t c)
+{
+	SkipWhitespace();
+	if (position == end || *position != c) return false;
+	++position;
+	return true;
+}
+
+bool DebugResponseParser::ReadString(std::wstring& text)
+{
+	if (!Consume(L'"')) return false;
+	text.clear();
+	while (position != end)
+	{
+		wchar_t c = *position++;
+		if (c == L'"') return true;
+		if (c != L'\\')
+		{
+			text += c;
+			continue;
+		}
+		if (position == end) return false;
+		c = *position++;
+		switch (c)
+		{
+		case L'b': text += L'\b'; break;
+		case L'f': text += L'\f'; break;
+		case L'n': text += L'\n'; break;
+		case L'r': text += L'\r'; break;
+		case L't': text += L'\t'; break;
+		case L'u':
+		{
+			// UTF-16 code units map one to one, surrogate pairs included
+			if (end - position < 4) return false;
+			int value = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				int digit = HexValue(*position++);
+				if (digit < 0) return false;
+				value = value * 16 + digit;
+			}
+			text += (wchar_t)value;
+			break;
+		}
+		default:
+			text += c;
+			break;
+		}
+	}
+	return false;
+}
+
+bool DebugResponseParser::ReadBoolean(bool& value)
+{
+	SkipWhitespace();
+	if (end - position >= 4 && wmemcmp(position, L"true", 4) == 0)
+	{
+		position += 4;
+		value = true;
+		return true;
+	}
+	if (end - position >= 5 && wmemcmp(position, L"false", 5) == 0)
+	{
+		position += 5;
+		value = false;
+		return true;
+	}
+	return false;
+}
+
+bool DebugResponseParser::SkipValue()
+{
+	SkipWhitespace();
+	if (position == end) return false;
+	switch (*position)
+	{
+	case L'{':
+		return ReadObject([this](const std::wstring&) { return SkipValue(); });
+	case L'[':
+		return ReadArray([this]() { return SkipValue(); });
+	case L'"':
+	{
+		std::wstring text;
+		return ReadString(text);
+	}
+	default:
+	{
+		// numbers, true, false and null
+		auto start = position;
+		while (position != end && ((*position >= L'0' && *position <= L'9') || (*position >= L'a' && *position <= L'z') || *position == L'-' || *position == L'+' || *position == L'.' || *position == L'E'))
+		{
+			++position;
+		}
+		return position != start;
+	}
+	}
+}
+
+template <typename Member>
+bool DebugResponseParser::ReadObject(Member member)
+{
+	if (!Consume(L'{')) return false;
+	if (Consume(L'}')) return true;
+	std::wstring name;
+	do
+	{
+		if (!ReadString(name) || !Consume(L':') || !member(name)) return false;
+	} while (Consume(L','));
+	return Consume(L'}');
+}
+
+template <typename Element>
+bool DebugResponseParser::ReadArray(Element element)
+{
+	if (!Consume(L'[')) return false;
+	if (Consume(L']')) return true;
+	do
+	{
+		if (!element()) return false;
+	} while (Consume(L','));
+	return Consume(L']');
+}
+
+bool DebugResponseParser::ReadMessage(ValidationMessage& message)
+{
+	message.Type = ValidationMessageType::Info;
+	return ReadObject([this, &message](const std::wstring& name) {
+		if (IsName(name, L"messageType"))
+		{
+			std::wstring type;
+			if (!ReadString(type)) return false;
+			message.Type = IsName(type, L"ERROR") ? ValidationMessageType::Error : IsName(type, L"WARN") ? ValidationMessageType::Warning : ValidationMessageType::Info;
+			return true;
+		}
+		if (IsName(name, L"messageCode")) return ReadString(message.Code);
+		if (IsName(name, L"parameter")) return ReadString(message.Parameter);
+		if (IsName(name, L"description")) return ReadString(message.Description);
+		return SkipValue();
+	});
+}
+
+bool DebugResponseParser::ReadResult(ValidationResult& result)
+{
+	result.IsValid = false;
+	return ReadObject([this, &result](const std::wstring& name) {
+		if (IsName(name, L"valid")) return ReadBoolean(result.IsValid);
+		if (IsName(name, L"parserMessage"))
+		{
+			return ReadArray([this, &result]() {
+				ValidationMessage message;
+				if (!ReadMessage(message)) return false;
+				result.Messages.push_back(std::move(message));
+				return true;
+			});
+		}
+		return SkipValue();
+	});
+}
+
+bool DebugResponseParser::Parse(const wchar_t* text, size_t length, std::vector<ValidationResult>& results)
+{
+	DebugResponseParser parser(text, length);
+	bool isParsed = parser.ReadObject([&parser, &results](const std::wstring& name) {
+		if (IsName(name, L"hitParsingResult"))
+		{
+			return parser.ReadArray([&parser, &results]() {
+				ValidationResult result;
+				if (!parser.ReadResult(result)) return false;
+				results.push_back(std::move(result));
+				return true;
+			});
+		}
+		return parser.SkipValue();
+	});
+	parser.SkipWhitespace();
+	return isParsed && parser.position == parser.end;
+}
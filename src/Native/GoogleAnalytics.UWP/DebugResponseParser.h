@@ -0,0 +1,61 @@
+//
+// DebugResponseParser.h
+// Declaration of the DebugResponseParser class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "HitValidator.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Reads the JSON returned by the /debug/collect end point into the same results as <see cref="HitValidator"/>.
+	/// </summary>
+	/// <remarks>
+	/// The text is read in a single pass, without building a document: only the hitParsingResult entries, their valid flag and parser messages
+	/// are kept, and every other value is skipped as it is read.
+	/// </remarks>
+	class DebugResponseParser
+	{
+	private:
+
+		const wchar_t* position;
+
+		const wchar_t* end;
+
+		void SkipWhitespace();
+
+		bool Consume(wchar_t c);
+
+		bool ReadString(std::wstring& text);
+
+		bool ReadBoolean(bool& value);
+
+		bool SkipValue();
+
+		// calls member(name) for each member of an object; member reads or skips the value
+		template <typename Member>
+		bool ReadObject(Member member);
+
+		// calls element() for each element of an array; element reads or skips the value
+		template <typename Element>
+		bool ReadArray(Element element);
+
+		bool ReadMessage(ValidationMessage& message);
+
+		bool ReadResult(ValidationResult& result);
+
+		DebugResponseParser(const wchar_t* text, size_t length);
+
+	public:
+
+		/// <summary>
+		/// Parses a response, one result per hit in the request. Returns false if the text is not well-formed JSON.
+		/// </summary>
+		static bool Parse(const wchar_t* text, size_t length, std::vector<ValidationResult>& results);
+	};
+}
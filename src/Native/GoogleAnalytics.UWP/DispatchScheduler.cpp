@@ -0,0 +1,194 @@
+//
+// DispatchScheduler.cpp
+// Implementation of the DispatchScheduler class.
+//
+
+#include "pch.h"
+#include "DispatchScheduler.h"
+
+using namespace GoogleAnalytics;
+using namespace concurrency;
+
+DispatchScheduler::DispatchScheduler(size_t maxInFlight, std::shared_ptr<DispatchCounters> counters) :
+	first(nullptr),
+	last(nullptr),
+	firstWaiting(nullptr),
+	lastUrgent(nullptr),
+	inFlight(0),
+	maxInFlight(maxInFlight > 0 ? maxInFlight : 1),
+	counters(counters)
+{ }
+
+DispatchScheduler::~DispatchScheduler()
+{
+	// running operations hold a reference to the scheduler, so only operations that never started can be left here.
+	while (first)
+	{
+		auto next = first->Next;
+		delete first;
+		first = next;
+	}
+}
+
+size_t DispatchScheduler::GetMaxInFlight()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return maxInFlight;
+}
+
+void DispatchScheduler::SetMaxInFlight(size_t value)
+{
+	{
+		std::lock_guard<std::mutex> lg(lock);
+		maxInFlight = value > 0 ? value : 1;
+	}
+	Pump();
+}
+
+task<void> DispatchScheduler::Schedule(std::function<task<void>()> start, bool isUrgent)
+{
+	auto operation = new Operation();
+	operation->Start = std::move(start);
+	task<void> completed(operation->Completed);
+	{
+		std::lock_guard<std::mutex> lg(lock);
+		// waiting operations follow the running ones, so an urgent operation goes right before the first one that waits,
+		// or after the urgent ones already waiting so they start in the order they were scheduled
+		if (isUrgent && lastUrgent)
+		{
+			operation->Previous = lastUrgent;
+			operation->Next = lastUrgent->Next;
+		}
+		else
+		{
+			operation->Next = isUrgent ? firstWaiting : nullptr;
+			operation->Previous = operation->Next ? operation->Next->Previous : last;
+		}
+		auto next = operation->Next;
+		if (operation->Previous)
+		{
+			operation->Previous->Next = operation;
+		}
+		else
+		{
+			first = operation;
+		}
+		if (next)
+		{
+			next->Previous = operation;
+		}
+		else
+		{
+			last = operation;
+		}
+		if (!firstWaiting || (isUrgent && !lastUrgent))
+		{
+			firstWaiting = operation;
+		}
+		if (isUrgent)
+		{
+			lastUrgent = operation;
+		}
+		counters->RequestsWaiting++;
+	}
+	Pump();
+	return completed;
+}
+
+task<void> DispatchScheduler::Flush()
+{
+	std::vector<task<void>> pending;
+	{
+		std::lock_guard<std::mutex> lg(lock);
+		for (auto operation = first; operation; operation = operation->Next)
+		{
+			pending.push_back(task<void>(operation->Completed));
+		}
+	}
+	return when_all(begin(pending), end(pending));
+}
+
+void DispatchScheduler::Pump()
+{
+	while (true)
+	{
+		Operation* operation;
+		{
+			std::lock_guard<std::mutex> lg(lock);
+			if (!firstWaiting || inFlight >= maxInFlight) return;
+			operation = firstWaiting;
+			firstWaiting = operation->Next;
+			if (operation == lastUrgent)
+			{
+				lastUrgent = nullptr;
+			}
+			inFlight++;
+			counters->RequestsWaiting--;
+			counters->RequestsInFlight = (long long)inFlight;
+			if (counters->PeakRequestsInFlight < (long long)inFlight)
+			{
+				counters->PeakRequestsInFlight = (long long)inFlight;
+			}
+		}
+
+		auto self = shared_from_this();
+		try
+		{
+			operation->Start().then([self, operation](task<void> t) {
+				try
+				{
+					t.get();
+					self->Complete(operation, nullptr);
+				}
+				catch (...)
+				{
+					self->Complete(operation, std::current_exception());
+				}
+			});
+		}
+		catch (...)
+		{
+			Complete(operation, std::current_exception());
+		}
+	}
+}
+
+void DispatchScheduler::Complete(Operation* operation, std::exception_ptr error)
+{
+	{
+		std::lock_guard<std::mutex> lg(lock);
+		if (operation->Previous)
+		{
+			operation->Previous->Next = operation->Next;
+		}
+		else
+		{
+			first = operation->Next;
+		}
+		if (operation->Next)
+		{
+			operation->Next->Previous = operation->Previous;
+		}
+		else
+		{
+			last = operation->Previous;
+		}
+		inFlight--;
+		counters->RequestsInFlight = (long long)inFlight;
+	}
+
+	auto completed = operation->Completed;
+	delete operation;
+
+	// start whatever was waiting for this slot before waking up anyone flushing
+	Pump();
+
+	if (error)
+	{
+		completed.set_exception(error);
+	}
+	else
+	{
+		completed.set();
+	}
+}
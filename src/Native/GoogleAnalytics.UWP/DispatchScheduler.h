@@ -0,0 +1,76 @@
+//
+// DispatchScheduler.h
+// Declaration of the DispatchScheduler class.
+//
+
+#pragma once
+
+#include <ppltasks.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "DispatchStatistics.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Runs send operations in the order they are scheduled, with at most a fixed number of them in flight at once.
+	/// </summary>
+	/// <remarks>Operations are kept in an intrusive list: the started ones form its head and the waiting ones its tail, so finishing an operation unlinks it in constant time without touching the others.</remarks>
+	class DispatchScheduler : public std::enable_shared_from_this<DispatchScheduler>
+	{
+	private:
+
+		struct Operation
+		{
+			Operation* Previous;
+			Operation* Next;
+			std::function<concurrency::task<void>()> Start;
+			concurrency::task_completion_event<void> Completed;
+		};
+
+		std::mutex lock;
+
+		Operation* first;
+
+		Operation* last;
+
+		Operation* firstWaiting;
+
+		// the last urgent operation still waiting, or nullptr; urgent operations wait ahead of the others
+		Operation* lastUrgent;
+
+		size_t inFlight;
+
+		size_t maxInFlight;
+
+		std::shared_ptr<DispatchCounters> counters;
+
+		void Pump();
+
+		void Complete(Operation* operation, std::exception_ptr error);
+
+	public:
+
+		DispatchScheduler(size_t maxInFlight, std::shared_ptr<DispatchCounters> counters);
+
+		~DispatchScheduler();
+
+		/// <summary>
+		/// Gets or sets how many operations may be in flight at once.
+		/// </summary>
+		size_t GetMaxInFlight();
+		void SetMaxInFlight(size_t value);
+
+		/// <summary>
+		/// Schedules an operation. start is called once a slot is free; the returned task completes when the task it returns does.
+		/// An urgent operation gets the next free slot, ahead of the other operations already waiting but after the urgent ones.
+		/// </summary>
+		concurrency::task<void> Schedule(std::function<concurrency::task<void>()> start, bool isUrgent = false);
+
+		/// <summary>
+		/// Returns a task that completes once every operation scheduled before the call has finished. Operations scheduled afterwards are not waited for.
+		/// </summary>
+		concurrency::task<void> Flush();
+	};
+}
@@ -0,0 +1,641 @@
+//
+// DispatchStatistics.h
+// Declaration of the DispatchCounters structure and the DispatchStatistics class.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "LatencyHistogram.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Live counters updated by <see cref="AnalyticsManager"/> and its transport while hits are dispatched.
+	/// </summary>
+	struct DispatchCounters
+	{
+		std::atomic<long long> ConnectionsOpened;
+
+		std::atomic<long long> ConnectionsReused;
+
+		std::atomic<long long> RequestsSent;
+
+		std::atomic<long long> HitsDroppedOnOverflow;
+
+		std::atomic<long long> OverflowDrains;
+
+		std::atomic<long long> RequestsInFlight;
+
+		std::atomic<long long> PeakRequestsInFlight;
+
+		std::atomic<long long> RequestsWaiting;
+
+		std::atomic<long long> HitsExpired;
+
+		std::atomic<long long> CircuitBreaks;
+
+		std::atomic<long long> HitRetries;
+
+		std::atomic<long long> HitsProcessedOnCapture;
+
+		std::atomic<long long> HitsAggregated;
+
+		std::atomic<long long> BytesBeforeCompression;
+
+		std::atomic<long long> BytesAfterCompression;
+
+		std::atomic<long long> HitsDroppedOffline;
+
+		std::atomic<long long> HitsDroppedOnMemoryLimit;
+
+		std::atomic<long long> QueuedBytes;
+
+		std::atomic<long long> PeakQueuedBytes;
+
+		std::atomic<long long> ResponsesOverHttp2;
+
+		std::atomic<long long> HitsSentByGet;
+
+		std::atomic<long long> HitsSentByPost;
+
+		std::atomic<long long> HitsTruncated;
+
+		std::atomic<long long> HitsDroppedOversized;
+
+		std::atomic<long long> FlushesOnHitThreshold;
+
+		std::atomic<long long> FlushesOnByteThreshold;
+
+		std::atomic<long long> FlushesOnAge;
+
+		LatencyHistogram CaptureLatency;
+
+		LatencyHistogram PreparationLatency;
+
+		LatencyHistogram EncodingLatency;
+
+		LatencyHistogram RequestLatency;
+
+		LatencyHistogram CompressionLatency;
+
+		DispatchCounters()
+			: ConnectionsOpened(0)
+			, ConnectionsReused(0)
+			, RequestsSent(0)
+			, HitsDroppedOnOverflow(0)
+			, OverflowDrains(0)
+			, RequestsInFlight(0)
+			, PeakRequestsInFlight(0)
+			, RequestsWaiting(0)
+			, HitsExpired(0)
+			, CircuitBreaks(0)
+			, HitRetries(0)
+			, HitsProcessedOnCapture(0)
+			, HitsAggregated(0)
+			, BytesBeforeCompression(0)
+			, BytesAfterCompression(0)
+			, HitsDroppedOffline(0)
+			, HitsDroppedOnMemoryLimit(0)
+			, QueuedBytes(0)
+			, PeakQueuedBytes(0)
+			, ResponsesOverHttp2(0)
+			, HitsSentByGet(0)
+			, HitsSentByPost(0)
+			, HitsTruncated(0)
+			, HitsDroppedOversized(0)
+			, FlushesOnHitThreshold(0)
+			, FlushesOnByteThreshold(0)
+			, FlushesOnAge(0)
+		{ }
+	};
+
+	/// <summary>
+	/// Point in time snapshot of how long one stage of the hit pipeline took, as counts in power of two buckets.
+	/// </summary>
+	/// <remarks>Bucket 0 counts durations under 1 microsecond and bucket i durations under 2^i microseconds; the last bucket also counts everything longer.</remarks>
+	public ref class LatencyDistribution sealed
+	{
+	private:
+
+		std::array<long long, LatencyHistogram::BucketCount> counts;
+		long long count;
+
+	internal:
+
+		LatencyDistribution(const LatencyHistogram& histogram)
+			: count(0)
+		{
+			for (size_t i = 0; i < counts.size(); i++)
+			{
+				counts[i] = histogram.GetCount(i);
+				count += counts[i];
+			}
+		}
+
+	public:
+
+		/// <summary>
+		/// Gets the number of durations recorded.
+		/// </summary>
+		property long long Count
+		{
+			long long get()
+			{
+				return count;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of buckets.
+		/// </summary>
+		property int BucketCount
+		{
+			int get()
+			{
+				return (int)counts.size();
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of durations recorded in a bucket.
+		/// </summary>
+		long long GetBucketCount(int bucket)
+		{
+			return bucket >= 0 && (size_t)bucket < counts.size() ? counts[bucket] : 0;
+		}
+
+		/// <summary>
+		/// Gets the exclusive upper bound of a bucket.
+		/// </summary>
+		Windows::Foundation::TimeSpan GetBucketUpperBound(int bucket)
+		{
+			Windows::Foundation::TimeSpan result;
+			result.Duration = LatencyHistogram::GetUpperBound(bucket < 0 ? 0 : (size_t)bucket) * 10;
+			return result;
+		}
+
+		/// <summary>
+		/// Gets the duration under which the given fraction (between 0 and 1) of the recorded durations fall, rounded up to a bucket bound.
+		/// </summary>
+		Windows::Foundation::TimeSpan GetPercentile(double fraction)
+		{
+			long long target = (long long)(fraction * count + .5);
+			long long cumulative = 0;
+			int bucket = 0;
+			for (; (size_t)bucket < counts.size() - 1; bucket++)
+			{
+				cumulative += counts[bucket];
+				if (cumulative >= target && cumulative > 0)
+				{
+					break;
+				}
+			}
+			return GetBucketUpperBound(bucket);
+		}
+	};
+
+	/// <summary>
+	/// Point in time snapshot of the counters kept by an <see cref="AnalyticsManager"/>.
+	/// </summary>
+	public ref class DispatchStatistics sealed
+	{
+	private:
+
+		long long connectionsOpened;
+		long long connectionsReused;
+		long long requestsSent;
+		long long hitsDroppedOnOverflow;
+		long long overflowDrains;
+		long long requestsInFlight;
+		long long peakRequestsInFlight;
+		long long requestsWaiting;
+		long long hitsExpired;
+		long long circuitBreaks;
+		long long hitRetries;
+		long long hitsProcessedOnCapture;
+		long long hitsAggregated;
+		long long bytesBeforeCompression;
+		long long bytesAfterCompression;
+		long long hitsDroppedOffline;
+		long long hitsDroppedOnMemoryLimit;
+		long long queuedBytes;
+		long long peakQueuedBytes;
+		long long responsesOverHttp2;
+		long long hitsSentByGet;
+		long long hitsSentByPost;
+		long long hitsTruncated;
+		long long hitsDroppedOversized;
+		long long flushesOnHitThreshold;
+		long long flushesOnByteThreshold;
+		long long flushesOnAge;
+		LatencyDistribution^ captureLatency;
+		LatencyDistribution^ preparationLatency;
+		LatencyDistribution^ encodingLatency;
+		LatencyDistribution^ requestLatency;
+		LatencyDistribution^ compressionLatency;
+
+	internal:
+
+		DispatchStatistics(const DispatchCounters& counters)
+			: connectionsOpened(counters.ConnectionsOpened.load())
+			, connectionsReused(counters.ConnectionsReused.load())
+			, requestsSent(counters.RequestsSent.load())
+			, hitsDroppedOnOverflow(counters.HitsDroppedOnOverflow.load())
+			, overflowDrains(counters.OverflowDrains.load())
+			, requestsInFlight(counters.RequestsInFlight.load())
+			, peakRequestsInFlight(counters.PeakRequestsInFlight.load())
+			, requestsWaiting(counters.RequestsWaiting.load())
+			, hitsExpired(counters.HitsExpired.load())
+			, circuitBreaks(counters.CircuitBreaks.load())
+			, hitRetries(counters.HitRetries.load())
+			, hitsProcessedOnCapture(counters.HitsProcessedOnCapture.load())
+			, hitsAggregated(counters.HitsAggregated.load())
+			, bytesBeforeCompression(counters.BytesBeforeCompression.load())
+			, bytesAfterCompression(counters.BytesAfterCompression.load())
+			, hitsDroppedOffline(counters.HitsDroppedOffline.load())
+			, hitsDroppedOnMemoryLimit(counters.HitsDroppedOnMemoryLimit.load())
+			, queuedBytes(counters.QueuedBytes.load())
+			, peakQueuedBytes(counters.PeakQueuedBytes.load())
+			, responsesOverHttp2(counters.ResponsesOverHttp2.load())
+			, hitsSentByGet(counters.HitsSentByGet.load())
+			, hitsSentByPost(counters.HitsSentByPost.load())
+			, hitsTruncated(counters.HitsTruncated.load())
+			, hitsDroppedOversized(counters.HitsDroppedOversized.load())
+			, flushesOnHitThreshold(counters.FlushesOnHitThreshold.load())
+			, flushesOnByteThreshold(counters.FlushesOnByteThreshold.load())
+			, flushesOnAge(counters.FlushesOnAge.load())
+			, captureLatency(ref new LatencyDistribution(counters.CaptureLatency))
+			, preparationLatency(ref new LatencyDistribution(counters.PreparationLatency))
+			, encodingLatency(ref new LatencyDistribution(counters.EncodingLatency))
+			, requestLatency(ref new LatencyDistribution(counters.RequestLatency))
+			, compressionLatency(ref new LatencyDistribution(counters.CompressionLatency))
+		{ }
+
+	public:
+
+		/// <summary>
+		/// Gets the number of times the HTTP stack had to be set up, either for the first request or after it was rebuilt or idle.
+		/// </summary>
+		property long long ConnectionsOpened
+		{
+			long long get()
+			{
+				return connectionsOpened;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of requests that were issued on an HTTP stack that was already warm.
+		/// </summary>
+		property long long ConnectionsReused
+		{
+			long long get()
+			{
+				return connectionsReused;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of HTTP requests issued.
+		/// </summary>
+		property long long RequestsSent
+		{
+			long long get()
+			{
+				return requestsSent;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits discarded because the ingestion queue was full.
+		/// </summary>
+		property long long HitsDroppedOnOverflow
+		{
+			long long get()
+			{
+				return hitsDroppedOnOverflow;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of times a thread sending a hit found the ingestion queue full and had to wait for it to be drained.
+		/// </summary>
+		property long long OverflowDrains
+		{
+			long long get()
+			{
+				return overflowDrains;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of requests that were on the wire when the snapshot was taken.
+		/// </summary>
+		property long long RequestsInFlight
+		{
+			long long get()
+			{
+				return requestsInFlight;
+			}
+		}
+
+		/// <summary>
+		/// Gets the highest number of requests that have been on the wire at the same time.
+		/// </summary>
+		property long long PeakRequestsInFlight
+		{
+			long long get()
+			{
+				return peakRequestsInFlight;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of requests that were ready but waiting for a free slot when the snapshot was taken.
+		/// </summary>
+		property long long RequestsWaiting
+		{
+			long long get()
+			{
+				return requestsWaiting;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits discarded because they were older than the Measurement Protocol accepts.
+		/// </summary>
+		property long long HitsExpired
+		{
+			long long get()
+			{
+				return hitsExpired;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of times dispatching was paused after repeated failures to reach the service.
+		/// </summary>
+		property long long CircuitBreaks
+		{
+			long long get()
+			{
+				return circuitBreaks;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of times a hit that failed to send was put back in the queue to be tried again.
+		/// </summary>
+		property long long HitRetries
+		{
+			long long get()
+			{
+				return hitRetries;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits that the sending thread had to prepare itself because the capture queue was full.
+		/// </summary>
+		property long long HitsProcessedOnCapture
+		{
+			long long get()
+			{
+				return hitsProcessedOnCapture;
+			}
+		}
+
+		/// <summary>
+		/// Gets how long sending a hit took on the calling thread, which only hands the hit over to the pipeline.
+		/// </summary>
+		property LatencyDistribution^ CaptureLatency
+		{
+			LatencyDistribution^ get()
+			{
+				return captureLatency;
+			}
+		}
+
+		/// <summary>
+		/// Gets how long hits took from being sent to being queued for dispatch, including the time spent waiting for a worker thread.
+		/// </summary>
+		property LatencyDistribution^ PreparationLatency
+		{
+			LatencyDistribution^ get()
+			{
+				return preparationLatency;
+			}
+		}
+
+		/// <summary>
+		/// Gets how long encoding a hit to its wire format took.
+		/// </summary>
+		property LatencyDistribution^ EncodingLatency
+		{
+			LatencyDistribution^ get()
+			{
+				return encodingLatency;
+			}
+		}
+
+		/// <summary>
+		/// Gets how long requests took from being issued to the response, or failure, coming back.
+		/// </summary>
+		property LatencyDistribution^ RequestLatency
+		{
+			LatencyDistribution^ get()
+			{
+				return requestLatency;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits that were merged into an earlier, identical hit instead of being sent on their own.
+		/// </summary>
+		property long long HitsAggregated
+		{
+			long long get()
+			{
+				return hitsAggregated;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of request body bytes that were offered for compression.
+		/// </summary>
+		property long long BytesBeforeCompression
+		{
+			long long get()
+			{
+				return bytesBeforeCompression;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of bytes those bodies were actually sent as, compressed or not when compressing did not make them smaller.
+		/// </summary>
+		property long long BytesAfterCompression
+		{
+			long long get()
+			{
+				return bytesAfterCompression;
+			}
+		}
+
+		/// <summary>
+		/// Gets how long compressing each request body took on the dispatching thread.
+		/// </summary>
+		property LatencyDistribution^ CompressionLatency
+		{
+			LatencyDistribution^ get()
+			{
+				return compressionLatency;
+			}
+		}
+
+		/// <summary>
+		/// Gets the size of the bodies as sent relative to their uncompressed size, or 1 when nothing has been compressed.
+		/// </summary>
+		property double CompressionRatio
+		{
+			double get()
+			{
+				return bytesBeforeCompression > 0 ? (double)bytesAfterCompression / bytesBeforeCompression : 1.0;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits discarded because the queue reached OfflineQueueLimit while the network was unavailable.
+		/// </summary>
+		property long long HitsDroppedOffline
+		{
+			long long get()
+			{
+				return hitsDroppedOffline;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits discarded to keep the dispatch queue within AnalyticsManager::QueueMemoryLimit.
+		/// </summary>
+		property long long HitsDroppedOnMemoryLimit
+		{
+			long long get()
+			{
+				return hitsDroppedOnMemoryLimit;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of bytes held by the hits in the dispatch queue.
+		/// </summary>
+		property long long QueuedBytes
+		{
+			long long get()
+			{
+				return queuedBytes;
+			}
+		}
+
+		/// <summary>
+		/// Gets the largest number of bytes the hits in the dispatch queue have held at once.
+		/// </summary>
+		property long long PeakQueuedBytes
+		{
+			long long get()
+			{
+				return peakQueuedBytes;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of responses received over HTTP/2, i.e. on a connection shared by concurrent requests.
+		/// </summary>
+		property long long ResponsesOverHttp2
+		{
+			long long get()
+			{
+				return responsesOverHttp2;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits sent on their own with a GET request.
+		/// </summary>
+		property long long HitsSentByGet
+		{
+			long long get()
+			{
+				return hitsSentByGet;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits sent with a POST request, on their own or in a batch.
+		/// </summary>
+		property long long HitsSentByPost
+		{
+			long long get()
+			{
+				return hitsSentByPost;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits whose longest values were cut short to fit the 8192 byte payload limit.
+		/// </summary>
+		property long long HitsTruncated
+		{
+			long long get()
+			{
+				return hitsTruncated;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of hits discarded because their payload was over the 8192 byte limit.
+		/// </summary>
+		property long long HitsDroppedOversized
+		{
+			long long get()
+			{
+				return hitsDroppedOversized;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of dispatches started because FlushHitThreshold hits were queued.
+		/// </summary>
+		property long long FlushesOnHitThreshold
+		{
+			long long get()
+			{
+				return flushesOnHitThreshold;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of dispatches started because FlushByteThreshold bytes were queued.
+		/// </summary>
+		property long long FlushesOnByteThreshold
+		{
+			long long get()
+			{
+				return flushesOnByteThreshold;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of dispatches started because a hit had waited for DispatchPeriod.
+		/// </summary>
+		property long long FlushesOnAge
+		{
+			long long get()
+			{
+				return flushesOnAge;
+			}
+		}
+	};
+}
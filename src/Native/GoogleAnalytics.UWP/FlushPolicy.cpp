@@ -0,0 +1,132 @@
+//
+// FlushPolicy.cpp
+// Implementation of the FlushPolicy class.
+//
+
+#include "pch.h"
+#include "FlushPolicy.h"
+#include <algorithm>
+
+using namespace GoogleAnalytics;
+
+FlushPolicy::FlushPolicy(size_t maxHits, size_t maxBytes, long long maxAge) :
+	maxHits(maxHits),
+	maxBytes(maxBytes),
+	maxAge(maxAge),
+	queuedHits(0),
+	queuedBytes(0),
+	openedAt(-1),
+	heldUntil(-1),
+	isFlushRequested(false)
+{ }
+
+size_t FlushPolicy::GetMaxHits()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return maxHits;
+}
+
+void FlushPolicy::SetMaxHits(size_t value)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	maxHits = value;
+}
+
+size_t FlushPolicy::GetMaxBytes()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return maxBytes;
+}
+
+void FlushPolicy::SetMaxBytes(size_t value)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	maxBytes = value;
+}
+
+long long FlushPolicy::GetMaxAge()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return maxAge;
+}
+
+void FlushPolicy::SetMaxAge(long long value)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	maxAge = value > 0 ? value : 0;
+}
+
+FlushPolicy::Action FlushPolicy::Add(size_t bytes, long long now, long long& due, Trigger& trigger)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	bool isOpening = openedAt < 0;
+	if (isOpening)
+	{
+		openedAt = now;
+	}
+	queuedHits++;
+	queuedBytes += bytes;
+	if (!isFlushRequested)
+	{
+		if (maxHits > 0 && queuedHits >= maxHits)
+		{
+			isFlushRequested = true;
+			trigger = Trigger::HitCount;
+			return Action::FlushNow;
+		}
+		if (maxBytes > 0 && queuedBytes >= maxBytes)
+		{
+			isFlushRequested = true;
+			trigger = Trigger::ByteCount;
+			return Action::FlushNow;
+		}
+	}
+	if (isOpening && maxAge > 0)
+	{
+		due = openedAt + maxAge;
+		trigger = Trigger::Age;
+		return Action::ArmTimer;
+	}
+	return Action::None;
+}
+
+FlushPolicy::Action FlushPolicy::Hold(size_t hits, size_t bytes, long long oldest, long long now, long long& due)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	if (hits == 0)
+	{
+		return Action::None;
+	}
+	// hits queued since the flush were counted by Add and are among these
+	queuedHits = hits;
+	queuedBytes = bytes;
+	if ((maxHits > 0 && queuedHits >= maxHits) || (maxBytes > 0 && queuedBytes >= maxBytes))
+	{
+		// they were just tried; flushing again right away would not get them out
+		isFlushRequested = true;
+	}
+	openedAt = openedAt < 0 ? oldest : (std::min)(openedAt, oldest);
+	if (maxAge <= 0)
+	{
+		return Action::None;
+	}
+	heldUntil = now + (std::min)(maxAge, MinHoldDelay);
+	due = (std::max)(openedAt + maxAge, heldUntil);
+	return Action::ArmTimer;
+}
+
+void FlushPolicy::Reset()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	queuedHits = 0;
+	queuedBytes = 0;
+	openedAt = -1;
+	heldUntil = -1;
+	isFlushRequested = false;
+}
+
+long long FlushPolicy::GetDue()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return openedAt < 0 || maxAge <= 0 ? -1 : (std::max)(openedAt + maxAge, heldUntil);
+}
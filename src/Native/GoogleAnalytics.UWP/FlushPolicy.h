@@ -0,0 +1,105 @@
+//
+// FlushPolicy.h
+// Declaration of the FlushPolicy class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Decides when queued hits are flushed: once MaxHits hits or MaxBytes bytes have been queued, or once the first of them has waited MaxAge, whichever comes first.
+	/// </summary>
+	/// <remarks>
+	/// A cycle opens with the first hit queued after a flush and closes with the next flush. Each cycle asks for at most one timer, due when its first hit reaches MaxAge,
+	/// and at most one early flush, so a burst of hits costs a single wake-up. While nothing is queued no timer is needed at all.
+	/// Hits a flush leaves in the queue, e.g. throttled ones, are held in the next cycle: they count toward its thresholds and its age runs from the oldest of them.
+	/// Times are monotonic nanoseconds; a limit of zero turns that trigger off.
+	/// </remarks>
+	class FlushPolicy
+	{
+	public:
+
+		/// <summary>
+		/// How long at least hits left in the queue by a flush wait before the next one, so hits that cannot go out yet are not tried again in a loop.
+		/// </summary>
+		static const long long MinHoldDelay = 1000000000LL;
+
+		enum class Action
+		{
+			/// <summary>Nothing to do; a timer or flush already covers the hits of this cycle.</summary>
+			None,
+			/// <summary>Arm a timer for the returned due time.</summary>
+			ArmTimer,
+			/// <summary>The hit or byte threshold was reached: flush now.</summary>
+			FlushNow
+		};
+
+		enum class Trigger
+		{
+			HitCount,
+			ByteCount,
+			Age
+		};
+
+	private:
+
+		std::mutex lock;
+
+		size_t maxHits;
+
+		size_t maxBytes;
+
+		long long maxAge;
+
+		size_t queuedHits;
+
+		size_t queuedBytes;
+
+		// when the first hit of the open cycle was queued, or -1 when no cycle is open
+		long long openedAt;
+
+		// the earliest the open cycle may be due, or -1; set when it holds hits left by a flush
+		long long heldUntil;
+
+		bool isFlushRequested;
+
+	public:
+
+		FlushPolicy(size_t maxHits, size_t maxBytes, long long maxAge);
+
+		size_t GetMaxHits();
+		void SetMaxHits(size_t value);
+
+		size_t GetMaxBytes();
+		void SetMaxBytes(size_t value);
+
+		long long GetMaxAge();
+		void SetMaxAge(long long value);
+
+		/// <summary>
+		/// Records a hit of the given size joining the queue at now. Sets due when a timer should be armed, and trigger when the hit calls for a flush.
+		/// </summary>
+		Action Add(size_t bytes, long long now, long long& due, Trigger& trigger);
+
+		/// <summary>
+		/// Keeps a cycle open for the hits that stay queued after a flush: hits of them, holding bytes, the oldest queued at oldest. They are counted toward the
+		/// thresholds in place of what the cycle had counted so far, and tried again once the oldest has waited MaxAge, but no sooner than MinHoldDelay
+		/// (or MaxAge, if shorter) after now. Hits that already reach a threshold do not ask for another early flush. Sets due when a timer should be armed.
+		/// </summary>
+		Action Hold(size_t hits, size_t bytes, long long oldest, long long now, long long& due);
+
+		/// <summary>
+		/// Closes the open cycle as its hits are being flushed.
+		/// </summary>
+		void Reset();
+
+		/// <summary>
+		/// Returns when the open cycle reaches MaxAge, or is next held until if later, or -1 when no cycle is open or age is not a trigger.
+		/// </summary>
+		long long GetDue();
+	};
+}
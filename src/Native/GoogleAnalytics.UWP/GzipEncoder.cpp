@@ -0,0 +1,181 @@
+//
+// GzipEncoder.cpp
+// Implementation of the GzipEncoder class.
+//
+
+#include "pch.h"
+#include "GzipEncoder.h"
+#include "Crc32.h"
+#include <algorithm>
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const size_t WindowSize = 32768;
+	const size_t WindowMask = WindowSize - 1;
+	const size_t HashSize = 1 << 15;
+	const size_t MinMatch = 3;
+	const size_t MaxMatch = 258;
+	const int MaxChain = 64;
+
+	const unsigned short LengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DistanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DistanceExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	size_t Hash(const std::string& data, size_t position)
+	{
+		uint32_t value = ((uint32_t)(unsigned char)data[position] << 16) | ((uint32_t)(unsigned char)data[position + 1] << 8) | (unsigned char)data[position + 2];
+		return (value * 2654435761u) >> 17 & (HashSize - 1);
+	}
+
+	void AppendUInt32(std::string& output, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			output += (char)((value >> (i * 8)) & 0xFF);
+		}
+	}
+}
+
+GzipEncoder::GzipEncoder(std::string& output)
+	: output(output)
+	, head(HashSize, -1)
+	, previous(WindowSize, -1)
+	, hashed(0)
+	, crc(0)
+	, bitBuffer(0)
+	, bitCount(0)
+	, isFinished(false)
+{
+	// magic, deflate, no flags, no modification time, no extra flags, unknown OS
+	static const unsigned char Header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+	output.append((const char*)Header, sizeof(Header));
+	// a single final block with the fixed codes
+	WriteBits(1, 1);
+	WriteBits(1, 2);
+}
+
+void GzipEncoder::WriteBits(uint32_t value, int count)
+{
+	bitBuffer |= value << bitCount;
+	bitCount += count;
+	while (bitCount >= 8)
+	{
+		output += (char)(bitBuffer & 0xFF);
+		bitBuffer >>= 8;
+		bitCount -= 8;
+	}
+}
+
+void GzipEncoder::WriteHuffman(uint32_t code, int length)
+{
+	// Huffman codes are packed starting from their most significant bit
+	uint32_t reversed = 0;
+	for (int i = 0; i < length; i++)
+	{
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+	WriteBits(reversed, length);
+}
+
+void GzipEncoder::WriteLiteral(unsigned int literal)
+{
+	if (literal < 144) WriteHuffman(0x30 + literal, 8);
+	else if (literal < 256) WriteHuffman(0x190 + literal - 144, 9);
+	else if (literal < 280) WriteHuffman(literal - 256, 7);
+	else WriteHuffman(0xc0 + literal - 280, 8);
+}
+
+void GzipEncoder::WriteMatch(size_t length, size_t distance)
+{
+	unsigned int lengthCode = 28;
+	while (LengthBase[lengthCode] > length)
+	{
+		lengthCode--;
+	}
+	WriteLiteral(257 + lengthCode);
+	WriteBits((uint32_t)(length - LengthBase[lengthCode]), LengthExtraBits[lengthCode]);
+
+	unsigned int distanceCode = 29;
+	while (DistanceBase[distanceCode] > distance)
+	{
+		distanceCode--;
+	}
+	WriteHuffman(distanceCode, 5);
+	WriteBits((uint32_t)(distance - DistanceBase[distanceCode]), DistanceExtraBits[distanceCode]);
+}
+
+void GzipEncoder::InsertUpTo(size_t position)
+{
+	for (; hashed < position && hashed + MinMatch <= history.size(); hashed++)
+	{
+		size_t hash = Hash(history, hashed);
+		previous[hashed & WindowMask] = head[hash];
+		head[hash] = (int)hashed;
+	}
+}
+
+void GzipEncoder::Write(const char* data, size_t length)
+{
+	if (isFinished || length == 0) return;
+
+	size_t position = history.size();
+	history.append(data, length);
+	crc = Crc32::Update(crc, data, length);
+
+	while (position < history.size())
+	{
+		size_t bestLength = 0;
+		size_t bestDistance = 0;
+		if (position + MinMatch <= history.size())
+		{
+			InsertUpTo(position);
+			size_t maxLength = (std::min)(MaxMatch, history.size() - position);
+			int candidate = head[Hash(history, position)];
+			for (int chain = 0; candidate >= 0 && position - (size_t)candidate <= WindowSize && chain < MaxChain; chain++)
+			{
+				size_t matchLength = 0;
+				while (matchLength < maxLength && history[candidate + matchLength] == history[position + matchLength])
+				{
+					matchLength++;
+				}
+				if (matchLength > bestLength)
+				{
+					bestLength = matchLength;
+					bestDistance = position - (size_t)candidate;
+					if (matchLength == maxLength) break;
+				}
+				int next = previous[candidate & WindowMask];
+				if (next >= candidate) break;
+				candidate = next;
+			}
+		}
+
+		if (bestLength >= MinMatch)
+		{
+			WriteMatch(bestLength, bestDistance);
+			position += bestLength;
+		}
+		else
+		{
+			WriteLiteral((unsigned char)history[position]);
+			position++;
+		}
+	}
+}
+
+void GzipEncoder::Finish()
+{
+	if (isFinished) return;
+	isFinished = true;
+
+	WriteLiteral(256);
+	if (bitCount > 0)
+	{
+		WriteBits(0, 8 - bitCount);
+	}
+	AppendUInt32(output, crc);
+	AppendUInt32(output, (uint32_t)history.size());
+}
@@ -0,0 +1,87 @@
+//
+// GzipEncoder.h
+// Declaration of the GzipEncoder class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Compresses a request body to the gzip format (RFC 1952) as it is written.
+	/// </summary>
+	/// <remarks>
+	/// A small deflate (RFC 1951) encoder: greedy LZ77 matching over hash chains and a single block with the fixed Huffman codes. Payloads are
+	/// short and repeat the same parameters from hit to hit, so back references carry almost all of the gain; dynamic Huffman tables would not pay
+	/// for their header. Each write can refer back to everything written before it, so writing the hits of a batch one by one through the same
+	/// encoder compresses each hit against the previous ones.
+	/// </remarks>
+	class GzipEncoder
+	{
+	private:
+
+		std::string& output;
+
+		std::string history;
+
+		std::vector<int> head;
+
+		std::vector<int> previous;
+
+		// positions below this one are in the hash chains
+		size_t hashed;
+
+		uint32_t crc;
+
+		uint32_t bitBuffer;
+
+		int bitCount;
+
+		bool isFinished;
+
+		void WriteBits(uint32_t value, int count);
+
+		void WriteHuffman(uint32_t code, int length);
+
+		void WriteLiteral(unsigned int literal);
+
+		void WriteMatch(size_t length, size_t distance);
+
+		void InsertUpTo(size_t position);
+
+	public:
+
+		/// <summary>
+		/// Starts a gzip stream at the end of output.
+		/// </summary>
+		GzipEncoder(std::string& output);
+
+		/// <summary>
+		/// Compresses more data into the stream.
+		/// </summary>
+		void Write(const char* data, size_t length);
+
+		void Write(const std::string& data)
+		{
+			Write(data.data(), data.size());
+		}
+
+		/// <summary>
+		/// Ends the stream. Nothing can be written afterwards.
+		/// </summary>
+		void Finish();
+
+		/// <summary>
+		/// Gets the number of uncompressed bytes written so far.
+		/// </summary>
+		size_t GetInputSize() const
+		{
+			return history.size();
+		}
+	};
+}
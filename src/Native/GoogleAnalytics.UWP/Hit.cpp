@@ -0,0 +1,120 @@
+//
+// Hit.cpp
+// Implementation of the Hit class.
+//
+
+#include "pch.h"
+#include <collection.h>
+#include <cwchar>
+#include "Hit.h"
+#include "TimeSource.h"
+
+using namespace GoogleAnalytics;
+using namespace Platform;
+using namespace Platform::Collections;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+
+HitRecord Hit::ToRecord(IMap<String^, String^>^ data)
+{
+	HitRecord record;
+	size_t characterCount = 0;
+	for each (auto kvp in data)
+	{
+		characterCount += kvp->Key->Length() + kvp->Value->Length();
+	}
+	record.Reserve(data->Size, characterCount);
+	for each (auto kvp in data)
+	{
+		record.Set(kvp->Key->Data(), kvp->Key->Length(), kvp->Value->Data(), kvp->Value->Length());
+	}
+	return record;
+}
+
+Hit::Hit(IMap<String^, String^>^ data)
+	: timeStamp(DateTimeHelper::Now())
+	, record(ToRecord(data))
+	, data(nullptr)
+	, logSequence(0)
+	, monotonicTimeStamp(TimeSource::MonotonicNow())
+	, attempts(0)
+{
+	priority = GetDefaultPriority();
+}
+
+Hit::Hit(std::shared_ptr<const HitRecord> baseRecord, HitRecord&& record, DateTime timeStamp, long long monotonicTimeStamp)
+	: timeStamp(timeStamp)
+	, baseRecord(baseRecord)
+	, record(std::move(record))
+	, data(nullptr)
+	, logSequence(0)
+	, monotonicTimeStamp(monotonicTimeStamp)
+	, attempts(0)
+{
+	priority = GetDefaultPriority();
+}
+
+Hit::Hit(HitRecord&& record, DateTime timeStamp, unsigned long long logSequence)
+	: timeStamp(timeStamp)
+	, record(std::move(record))
+	, data(nullptr)
+	, logSequence(logSequence)
+	, monotonicTimeStamp(0)
+	, attempts(0)
+{
+	priority = GetDefaultPriority();
+}
+
+HitPriority Hit::GetDefaultPriority()
+{
+	const wchar_t* value;
+	size_t valueLength;
+	if (TryGetParameter(MeasurementProtocol::Parameter::HitType, value, valueLength))
+	{
+		if (valueLength == 9 && wmemcmp(value, L"exception", 9) == 0)
+		{
+			// exf defaults to fatal when it is left out
+			if (!TryGetParameter(MeasurementProtocol::Parameter::ExceptionFatal, value, valueLength) || (valueLength == 1 && value[0] == L'1'))
+			{
+				return HitPriority::Critical;
+			}
+		}
+		else if (valueLength == 6 && wmemcmp(value, L"timing", 6) == 0)
+		{
+			return HitPriority::Bulk;
+		}
+	}
+	if (TryGetParameter(MeasurementProtocol::Parameter::NonInteraction, value, valueLength) && valueLength == 1 && value[0] == L'1')
+	{
+		return HitPriority::Bulk;
+	}
+	return HitPriority::Normal;
+}
+
+size_t Hit::GetByteSize()
+{
+	// the object itself: its header, time stamps, retry state and the reference to the shared parameters
+	const size_t objectSize = 128;
+	return objectSize + record.ByteSize();
+}
+
+IMap<String^, String^>^ Hit::Data::get()
+{
+	std::call_once(dataProjected, [this]() {
+		auto result = ref new Map<String^, String^>();
+		ForEachParameter([result](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+			result->Insert(ref new String(key, (unsigned int)keyLength), ref new String(value, (unsigned int)valueLength));
+		});
+		data = result;
+	});
+	return data;
+}
+
+HitRecord Hit::Flatten()
+{
+	HitRecord result;
+	ForEachParameter([&result](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+		result.Set(key, keyLength, value, valueLength);
+	});
+	return result;
+}
@@ -1,14 +1,38 @@
 //
-// Payload.h
-// Declaration of the Payload class.
+// Hit.h
+// Declaration of the Hit class.
 //
 
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include "DateTimeHelper.h"
+#include "HitRecord.h"
 
 namespace GoogleAnalytics
 {
+	/// <summary>
+	/// Specifies how urgently a <see cref="Hit"/> is sent. Each class waits in its own queue.
+	/// </summary>
+	public enum class HitPriority
+	{
+		/// <summary>
+		/// Sent right away, ahead of everything else and regardless of the dispatch period and throttling, e.g. fatal exceptions.
+		/// </summary>
+		Critical,
+
+		/// <summary>
+		/// Interaction hits, sent in the order of the dispatch period.
+		/// </summary>
+		Normal,
+
+		/// <summary>
+		/// Non interaction and timing hits, sent after the others and held back on metered networks.
+		/// </summary>
+		Bulk
+	};
 
 	/// <summary>
 	/// Represents a single event to track.
@@ -18,26 +42,161 @@ namespace GoogleAnalytics
 	private:
 		Windows::Foundation::DateTime timeStamp;
 
+		GoogleAnalytics::HitRecord record;
+
+		std::shared_ptr<const GoogleAnalytics::HitRecord> baseRecord;
+
 		Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data;
 
+		std::once_flag dataProjected;
+
+		unsigned long long logSequence;
+
+		long long monotonicTimeStamp;
+
+		unsigned int attempts;
+
+		std::chrono::steady_clock::time_point notBefore;
+
+		HitPriority priority;
+
+		HitPriority GetDefaultPriority();
+
 	internal:
 
-		Hit(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data)
-			: data(data)
-			, timeStamp(DateTimeHelper::Now())
-		{ }
+		Hit(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data);
+
+		/// <summary>
+		/// Creates a hit that shares the tracker level parameters in baseRecord, if any, and stores its own parameters, which take precedence.
+		/// The time stamps are those of the moment the hit was sent, which may be earlier than its creation.
+		/// </summary>
+		Hit(std::shared_ptr<const GoogleAnalytics::HitRecord> baseRecord, GoogleAnalytics::HitRecord&& record, Windows::Foundation::DateTime timeStamp, long long monotonicTimeStamp);
+
+		/// <summary>
+		/// Restores a hit read back from the persistent queue, keeping its original time stamp.
+		/// </summary>
+		Hit(GoogleAnalytics::HitRecord&& record, Windows::Foundation::DateTime timeStamp, unsigned long long logSequence);
+
+		/// <summary>
+		/// Copies a map of parameters into a record, allocating once.
+		/// </summary>
+		static GoogleAnalytics::HitRecord ToRecord(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data);
+
+		/// <summary>
+		/// Gets the sequence number of the hit in the persistent queue, or zero when it has not been persisted.
+		/// </summary>
+		unsigned long long GetLogSequence()
+		{
+			return logSequence;
+		}
+
+		void SetLogSequence(unsigned long long sequence)
+		{
+			logSequence = sequence;
+		}
+
+		/// <summary>
+		/// Gets the <see cref="TimeSource::MonotonicNow"/> reading taken when the hit was created, or zero for a hit restored from the persistent queue.
+		/// </summary>
+		long long GetMonotonicTimeStamp()
+		{
+			return monotonicTimeStamp;
+		}
+
+		/// <summary>
+		/// Gets the number of times sending the hit has failed so far.
+		/// </summary>
+		unsigned int GetAttempts()
+		{
+			return attempts;
+		}
+
+		void SetAttempts(unsigned int value)
+		{
+			attempts = value;
+		}
+
+		/// <summary>
+		/// Gets the earliest time at which the hit may be sent again after a failure.
+		/// </summary>
+		std::chrono::steady_clock::time_point GetNotBefore()
+		{
+			return notBefore;
+		}
+
+		void SetNotBefore(std::chrono::steady_clock::time_point value)
+		{
+			notBefore = value;
+		}
+
+		void SetPriority(HitPriority value)
+		{
+			priority = value;
+		}
 
+		/// <summary>
+		/// Gets the parameters stored by the hit itself, which excludes the shared tracker level ones.
+		/// </summary>
+		const GoogleAnalytics::HitRecord& GetRecord()
+		{
+			return record;
+		}
+
+		/// <summary>
+		/// Gets the number of bytes of memory held by the hit. The shared tracker level parameters are not counted, since they outlive it.
+		/// </summary>
+		size_t GetByteSize();
+
+		/// <summary>
+		/// Gets the shared tracker level parameters, or nullptr when the hit holds all of its parameters.
+		/// </summary>
+		std::shared_ptr<const GoogleAnalytics::HitRecord> GetBaseRecord()
+		{
+			return baseRecord;
+		}
+
+		/// <summary>
+		/// Looks up a parameter of the hit, whether it is its own or a shared one.
+		/// </summary>
+		bool TryGetParameter(GoogleAnalytics::MeasurementProtocol::Parameter key, const wchar_t*& value, size_t& valueLength)
+		{
+			return record.TryGet(key, value, valueLength) || (baseRecord && baseRecord->TryGet(key, value, valueLength));
+		}
+
+		/// <summary>
+		/// Returns a single record holding all the parameters of the hit.
+		/// </summary>
+		GoogleAnalytics::HitRecord Flatten();
+
+		/// <summary>
+		/// Calls action(key, keyLength, value, valueLength) for each parameter of the hit: the shared ones it does not override, then its own.
+		/// </summary>
+		template <typename Action>
+		void ForEachParameter(Action action)
+		{
+			if (baseRecord)
+			{
+				const GoogleAnalytics::HitRecord& own = record;
+				baseRecord->ForEach([&own, &action](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+					const wchar_t* ownValue;
+					size_t ownValueLength;
+					if (!own.TryGet(key, keyLength, ownValue, ownValueLength))
+					{
+						action(key, keyLength, value, valueLength);
+					}
+				});
+			}
+			record.ForEach(action);
+		}
 
 	public: 
 		/// <summary>
 		/// Gets the key value pairs to send to Google Analytics.
 		/// </summary>
+		/// <remarks>The map is created from the hit on first access; changing it does not change what is sent.</remarks>
 		property Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ Data
 		{
-			Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ get()
-			{
-				return data;
-			}
+			Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ get();
 		}
 
 		/// <summary>
@@ -51,5 +210,16 @@ namespace GoogleAnalytics
 			}
 		}
 
+		/// <summary>
+		/// Gets the class of the hit. It follows from the hit type: fatal exceptions are <see cref="HitPriority::Critical"/>, non interaction and timing hits <see cref="HitPriority::Bulk"/>.
+		/// </summary>
+		property HitPriority Priority
+		{
+			HitPriority get()
+			{
+				return priority;
+			}
+		}
+
 	};
 }
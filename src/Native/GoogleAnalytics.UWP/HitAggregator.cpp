@@ -0,0 +1,212 @@
+//
+// HitAggregator.cpp
+// Implementation of the HitAggregator class.
+//
+
+#include "pch.h"
+#include "HitAggregator.h"
+#include <algorithm>
+#include <cwchar>
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	bool IsKey(const wchar_t* key, size_t keyLength, const wchar_t* name, size_t nameLength)
+	{
+		return keyLength == nameLength && wmemcmp(key, name, nameLength) == 0;
+	}
+
+	bool ParseInteger(const wchar_t* value, size_t length, long long& result)
+	{
+		size_t i = 0;
+		bool isNegative = length > 0 && value[0] == L'-';
+		if (isNegative) i++;
+		if (i == length) return false;
+		result = 0;
+		for (; i < length; i++)
+		{
+			if (value[i] < L'0' || value[i] > L'9') return false;
+			result = result * 10 + (value[i] - L'0');
+		}
+		if (isNegative) result = -result;
+		return true;
+	}
+
+	std::wstring ToString(long long value)
+	{
+		wchar_t buffer[24];
+		swprintf(buffer, 24, L"%lld", value);
+		return buffer;
+	}
+
+	// writes the name of a custom metric and returns its length, 0 for index 0, which stands for no metric
+	size_t FormatMetric(unsigned int index, wchar_t* name)
+	{
+		return index == 0 ? 0 : FormatKey(MakeKey(IndexedParameter::CustomMetric, index), name);
+	}
+
+	void SetMetric(HitRecord& record, unsigned int index, long long value)
+	{
+		if (index == 0) return;
+		wchar_t metric[MaxKeyLength];
+		size_t metricLength = FormatMetric(index, metric);
+		auto text = ToString(value);
+		record.Set(metric, metricLength, text.c_str(), text.size());
+	}
+}
+
+void HitAggregator::SetRule(const std::wstring& category, bool isTiming, Rule rule)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	auto& rules = isTiming ? timingRules : eventRules;
+	if (rule.Window > 0)
+	{
+		rules[category] = rule;
+	}
+	else
+	{
+		rules.erase(category);
+	}
+}
+
+bool HitAggregator::HasRules()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return !eventRules.empty() || !timingRules.empty();
+}
+
+bool HitAggregator::TryAdd(const HitRecord& record, long long universalTimeStamp, long long monotonicTimeStamp, long long now, bool& isNewGroup, long long& due)
+{
+	const wchar_t* hitType;
+	size_t hitTypeLength;
+	if (!record.TryGet(Parameter::HitType, hitType, hitTypeLength)) return false;
+	bool isTiming = IsKey(hitType, hitTypeLength, L"timing", 6);
+	if (!isTiming && !IsKey(hitType, hitTypeLength, L"event", 5)) return false;
+
+	const wchar_t* category;
+	size_t categoryLength;
+	if (!record.TryGet(isTiming ? Parameter::TimingCategory : Parameter::EventCategory, category, categoryLength)) return false;
+
+	std::lock_guard<std::mutex> lg(lock);
+	auto& rules = isTiming ? timingRules : eventRules;
+	auto rule = rules.find(std::wstring(category, categoryLength));
+	if (rule == end(rules)) return false;
+
+	wchar_t countMetric[MaxKeyLength];
+	wchar_t minMetric[MaxKeyLength];
+	wchar_t maxMetric[MaxKeyLength];
+	size_t countMetricLength = FormatMetric(rule->second.CountMetricIndex, countMetric);
+	size_t minMetricLength = FormatMetric(rule->second.MinMetricIndex, minMetric);
+	size_t maxMetricLength = FormatMetric(rule->second.MaxMetricIndex, maxMetric);
+
+	// everything but the value and the parameters the dispatcher or this class set identifies the group
+	std::wstring key;
+	bool hasValue = false;
+	long long value = 0;
+	record.ForEach([&](const wchar_t* name, size_t nameLength, const wchar_t* parameterValue, size_t valueLength) {
+		if (IsKey(name, nameLength, isTiming ? L"utt" : L"ev", isTiming ? 3 : 2))
+		{
+			hasValue = ParseInteger(parameterValue, valueLength, value);
+		}
+		else if (!IsKey(name, nameLength, L"qt", 2) && !IsKey(name, nameLength, L"z", 1) && !IsKey(name, nameLength, countMetric, countMetricLength)
+			&& !IsKey(name, nameLength, minMetric, minMetricLength) && !IsKey(name, nameLength, maxMetric, maxMetricLength))
+		{
+			key.append(name, nameLength);
+			key += L'\0';
+			key.append(parameterValue, valueLength);
+			key += L'\0';
+		}
+	});
+
+	auto group = groups.find(key);
+	isNewGroup = group == end(groups);
+	if (isNewGroup)
+	{
+		Group created;
+		created.Record = record;
+		created.UniversalTimeStamp = universalTimeStamp;
+		created.MonotonicTimeStamp = monotonicTimeStamp;
+		created.Due = now + rule->second.Window;
+		created.CountMetricIndex = rule->second.CountMetricIndex;
+		created.MinMetricIndex = rule->second.MinMetricIndex;
+		created.MaxMetricIndex = rule->second.MaxMetricIndex;
+		created.IsTiming = isTiming;
+		created.Count = 0;
+		created.ValueCount = 0;
+		created.ValueSum = 0;
+		created.ValueMin = 0;
+		created.ValueMax = 0;
+		group = groups.emplace(std::move(key), std::move(created)).first;
+	}
+	group->second.Count++;
+	if (hasValue)
+	{
+		auto& merged = group->second;
+		merged.ValueMin = merged.ValueCount == 0 ? value : (std::min)(merged.ValueMin, value);
+		merged.ValueMax = merged.ValueCount == 0 ? value : (std::max)(merged.ValueMax, value);
+		merged.ValueCount++;
+		merged.ValueSum += value;
+	}
+	due = group->second.Due;
+	return true;
+}
+
+HitAggregator::AggregatedHit HitAggregator::Complete(Group& group)
+{
+	AggregatedHit result;
+	result.Record = std::move(group.Record);
+	result.UniversalTimeStamp = group.UniversalTimeStamp;
+	result.MonotonicTimeStamp = group.MonotonicTimeStamp;
+
+	if (group.ValueCount > 0)
+	{
+		// timings report the mean; event values add up
+		auto value = ToString(group.IsTiming ? (group.ValueSum + group.ValueCount / 2) / group.ValueCount : group.ValueSum);
+		result.Record.Set(group.IsTiming ? L"utt" : L"ev", group.IsTiming ? 3 : 2, value.c_str(), value.size());
+		SetMetric(result.Record, group.MinMetricIndex, group.ValueMin);
+		SetMetric(result.Record, group.MaxMetricIndex, group.ValueMax);
+	}
+	SetMetric(result.Record, group.CountMetricIndex, group.Count);
+	return result;
+}
+
+std::vector<HitAggregator::AggregatedHit> HitAggregator::TakeDue(long long now)
+{
+	std::vector<AggregatedHit> result;
+	std::lock_guard<std::mutex> lg(lock);
+	for (auto group = begin(groups); group != end(groups);)
+	{
+		if (now < 0 || group->second.Due <= now)
+		{
+			result.push_back(Complete(group->second));
+			group = groups.erase(group);
+		}
+		else
+		{
+			++group;
+		}
+	}
+	return result;
+}
+
+long long HitAggregator::GetNextDue()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	long long result = -1;
+	for (auto group = begin(groups); group != end(groups); ++group)
+	{
+		if (result < 0 || group->second.Due < result)
+		{
+			result = group->second.Due;
+		}
+	}
+	return result;
+}
+
+void HitAggregator::Clear()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	groups.clear();
+}
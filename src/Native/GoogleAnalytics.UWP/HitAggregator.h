@@ -0,0 +1,119 @@
+//
+// HitAggregator.h
+// Declaration of the HitAggregator class.
+//
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HitRecord.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Merges repeated event and timing hits of selected categories into one hit per time window.
+	/// </summary>
+	/// <remarks>
+	/// Hits are merged when all their parameters but the value (ev, or utt for timings), qt, z and the metrics set here are identical.
+	/// The merged hit keeps the parameters and time stamp of the first hit, sums ev, and carries the number of hits it stands for in a custom metric,
+	/// so totals can still be computed in reports. Timings keep their mean in utt, rounded to the millisecond, and optionally their shortest and
+	/// longest times in custom metrics of their own; no other statistic of the merged times is kept.
+	/// All times are monotonic nanoseconds.
+	/// </remarks>
+	class HitAggregator
+	{
+	public:
+
+		struct Rule
+		{
+			/// <summary>
+			/// How long after the first hit of a group the merged hit is sent.
+			/// </summary>
+			long long Window;
+
+			/// <summary>
+			/// The index of the custom metric (cm&lt;index&gt;) that receives the number of merged hits.
+			/// </summary>
+			unsigned int CountMetricIndex;
+
+			/// <summary>
+			/// The indexes of the custom metrics that receive the smallest and the largest merged value, or 0 to leave them out.
+			/// </summary>
+			unsigned int MinMetricIndex;
+			unsigned int MaxMetricIndex;
+		};
+
+		struct AggregatedHit
+		{
+			GoogleAnalytics::HitRecord Record;
+
+			long long UniversalTimeStamp;
+
+			long long MonotonicTimeStamp;
+		};
+
+	private:
+
+		struct Group
+		{
+			GoogleAnalytics::HitRecord Record;
+			long long UniversalTimeStamp;
+			long long MonotonicTimeStamp;
+			long long Due;
+			unsigned int CountMetricIndex;
+			unsigned int MinMetricIndex;
+			unsigned int MaxMetricIndex;
+			bool IsTiming;
+			long long Count;
+			long long ValueCount;
+			long long ValueSum;
+			long long ValueMin;
+			long long ValueMax;
+		};
+
+		std::mutex lock;
+
+		std::unordered_map<std::wstring, Rule> eventRules;
+
+		std::unordered_map<std::wstring, Rule> timingRules;
+
+		std::unordered_map<std::wstring, Group> groups;
+
+		static AggregatedHit Complete(Group& group);
+
+	public:
+
+		/// <summary>
+		/// Sets how event hits (or timing hits, when isTiming is true) of a category are merged. A window of zero or less stops merging them.
+		/// </summary>
+		void SetRule(const std::wstring& category, bool isTiming, Rule rule);
+
+		/// <summary>
+		/// Returns whether any category is being merged.
+		/// </summary>
+		bool HasRules();
+
+		/// <summary>
+		/// Offers a hit, received at the given time, for merging. Returns true if the hit was absorbed, in which case isNewGroup tells whether it started a group that will be due at due.
+		/// </summary>
+		bool TryAdd(const GoogleAnalytics::HitRecord& record, long long universalTimeStamp, long long monotonicTimeStamp, long long now, bool& isNewGroup, long long& due);
+
+		/// <summary>
+		/// Completes the groups whose window is over at the given time, or all of them if now is negative.
+		/// </summary>
+		std::vector<AggregatedHit> TakeDue(long long now);
+
+		/// <summary>
+		/// Returns the time the next group is due, or -1 when there is none.
+		/// </summary>
+		long long GetNextDue();
+
+		/// <summary>
+		/// Discards every open group.
+		/// </summary>
+		void Clear();
+	};
+}
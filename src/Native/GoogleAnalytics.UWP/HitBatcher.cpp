@@ -0,0 +1,46 @@
+//
+// HitBatcher.cpp
+// Implementation of the HitBatcher class.
+//
+
+#include "pch.h"
+#include "HitBatcher.h"
+
+using namespace GoogleAnalytics;
+
+HitBatcher::HitBatcher(size_t maxHits, size_t maxBytes) :
+	maxHits(maxHits > 0 ? maxHits : 1),
+	maxBytes(maxBytes)
+{ }
+
+std::vector<std::vector<size_t>> HitBatcher::Pack(const std::vector<size_t>& payloadSizes) const
+{
+	std::vector<std::vector<size_t>> result;
+	std::vector<size_t> current;
+	size_t currentBytes = 0;
+
+	for (size_t i = 0; i < payloadSizes.size(); i++)
+	{
+		size_t size = payloadSizes[i];
+		if (size > MaxHitBytes)
+		{
+			result.push_back(std::vector<size_t>(1, i));
+			continue;
+		}
+
+		size_t needed = current.empty() ? size : currentBytes + 1 + size;
+		if (!current.empty() && (current.size() >= maxHits || needed > maxBytes))
+		{
+			result.push_back(current);
+			current.clear();
+			needed = size;
+		}
+		current.push_back(i);
+		currentBytes = needed;
+	}
+	if (!current.empty())
+	{
+		result.push_back(current);
+	}
+	return result;
+}
@@ -0,0 +1,42 @@
+//
+// HitBatcher.h
+// Declaration of the HitBatcher class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Groups encoded hit payloads into batches that honor the limits of the Measurement Protocol batch endpoint.
+	/// </summary>
+	/// <remarks>Works on payload sizes only so it has no dependency on the Windows Runtime.</remarks>
+	class HitBatcher
+	{
+	private:
+
+		size_t maxHits;
+
+		size_t maxBytes;
+
+	public:
+
+		static const size_t MaxHitsPerBatch = 20;
+
+		static const size_t MaxBatchBytes = 16 * 1024;
+
+		static const size_t MaxHitBytes = 8 * 1024;
+
+		HitBatcher(size_t maxHits = MaxHitsPerBatch, size_t maxBytes = MaxBatchBytes);
+
+		/// <summary>
+		/// Splits payloads into consecutive batches of payload indices. Payloads are joined with a single newline, which is accounted for.
+		/// </summary>
+		/// <param name="payloadSizes">The size in bytes of each encoded payload, in dispatch order.</param>
+		/// <remarks>A payload larger than <see cref="MaxHitBytes"/> is placed in a batch of its own.</remarks>
+		std::vector<std::vector<size_t>> Pack(const std::vector<size_t>& payloadSizes) const;
+	};
+}
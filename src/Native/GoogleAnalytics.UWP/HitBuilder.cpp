@@ -7,6 +7,7 @@
 #include "HitBuilder.h"
 #include <collection.h>
 #include "TimeSpanHelper.h"
+#include <unordered_set>
 
 
 
@@ -15,6 +16,7 @@
 
 using namespace GoogleAnalytics;
 using namespace GoogleAnalytics::Ecommerce;
+using namespace GoogleAnalytics::MeasurementProtocol;
 using namespace Platform;
 using namespace Platform::Collections;
 using namespace Windows::Foundation;
@@ -26,175 +28,234 @@ String^ HitBuilder::HitType_Exception = "exception";
 String^ HitBuilder::HitType_SocialNetworkInteraction = "social";
 String^ HitBuilder::HitType_UserTiming = "timing";
 
-HitBuilder::HitBuilder()
+namespace
 {
-	lineage = ref new Vector<HitBuilder^>();
-	lineage->Append(this);
+	void Add(HitBuilderBuffer::Parameters& parameters, KeyId key, String^ value)
+	{
+		// the service ignores indexes outside of its range; don't bother sending them
+		if (IsValid(key))
+		{
+			HitBuilderBuffer::Parameter parameter = { key, nullptr, value };
+			parameters.push_back(parameter);
+		}
+	}
+
+	void Add(HitBuilderBuffer::Parameters& parameters, String^ name, String^ value)
+	{
+		KeyId key = ParseKey(name->Data(), name->Length());
+		HitBuilderBuffer::Parameter parameter = { key, nullptr, value };
+		if (key == UnknownKey || !IsValid(key))
+		{
+			// anything set by name that is not a valid parameter is passed through as is
+			parameter.Key = UnknownKey;
+			parameter.Name = name;
+		}
+		parameters.push_back(parameter);
+	}
 
-	data = ref new Map<String^, String^>();
+	String^ GetName(const HitBuilderBuffer::Parameter& parameter)
+	{
+		if (parameter.Name)
+		{
+			return parameter.Name;
+		}
+		wchar_t name[MaxKeyLength];
+		size_t length = FormatKey(parameter.Key, name);
+		return ref new String(name, (unsigned int)length);
+	}
 
-	Product^ p; 
+	bool IsSameKey(const HitBuilderBuffer::Parameter& parameter, KeyId key, String^ name)
+	{
+		return key == UnknownKey ? parameter.Key == UnknownKey && parameter.Name == name : parameter.Key == key;
+	}
 }
 
-HitBuilder::HitBuilder(IMap<String^, String^>^ data)
+HitBuilder::HitBuilder(const HitBuilderBuffer::Parameters& parameters)
+	: buffer(std::make_shared<HitBuilderBuffer>()),
+	start(0),
+	length(parameters.size())
 {
-	lineage = ref new Vector<HitBuilder^>();
-	lineage->Append(this);
+	buffer->Extend(0, parameters);
+}
 
-	this->data = ref new Map<String^, String^>();
-	for each (auto kvp in data)
-	{
-		this->data->Insert(kvp->Key, kvp->Value);
-	}
+HitBuilder::HitBuilder(std::shared_ptr<HitBuilderBuffer> buffer, size_t start, size_t length, int productCount, int promotionCount)
+	: buffer(buffer),
+	start(start),
+	length(length)
+{
+	ProductCount = productCount;
+	PromotionCount = promotionCount;
 }
 
-HitBuilder::HitBuilder(IVector<HitBuilder^>^ lineage, IMap<String^, String^>^ data)
+HitBuilder^ HitBuilder::Derive(const HitBuilderBuffer::Parameters& parameters)
 {
-	this->lineage = ref new Vector<HitBuilder^>();
-	for each (auto hitBuilder in lineage)
-	{
-		this->lineage->Append(hitBuilder);
-	}
-	this->lineage->Append(this);
+	return Derive(parameters, ProductCount, PromotionCount);
+}
 
-	this->data = ref new Map<String^, String^>();
-	for each (auto kvp in data)
-	{
-		this->data->Insert(kvp->Key, kvp->Value);
-	}
+HitBuilder^ HitBuilder::Derive(const HitBuilderBuffer::Parameters& parameters, int productCount, int promotionCount)
+{
+	return ref new HitBuilder(buffer->Extend(length, parameters), length, length + parameters.size(), productCount, promotionCount);
 }
 
 HitBuilder^ HitBuilder::CreateScreenView()
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_Screenview);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_Screenview);
 	return ref new HitBuilder(data);
 }
 
 HitBuilder^ HitBuilder::CreateScreenView(String^ screenName)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_Screenview);
-	if (screenName) data->Insert("cd", screenName);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_Screenview);
+	if (screenName) Add(data, MakeKey(Parameter::ScreenName), screenName);
 	return ref new HitBuilder(data);
 }
 
 HitBuilder^ HitBuilder::CreateCustomEvent(String^ category, String^ action, String^ label, long long value)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_Event);
-	data->Insert("ec", category);
-	data->Insert("ea", action);
-	if (label) data->Insert("el", label);
-	if (value) data->Insert("ev", value.ToString());
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_Event);
+	Add(data, MakeKey(Parameter::EventCategory), category);
+	Add(data, MakeKey(Parameter::EventAction), action);
+	if (label) Add(data, MakeKey(Parameter::EventLabel), label);
+	if (value) Add(data, MakeKey(Parameter::EventValue), value.ToString());
 	return ref new HitBuilder(data);
 }
 
 HitBuilder^ HitBuilder::CreateException(String^ description, bool isFatal)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_Exception);
-	if (description) data->Insert("exd", description);
-	if (!isFatal) data->Insert("exf", "0");
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_Exception);
+	if (description) Add(data, MakeKey(Parameter::ExceptionDescription), description);
+	if (!isFatal) Add(data, MakeKey(Parameter::ExceptionFatal), "0");
 	return ref new HitBuilder(data);
 }
 
 HitBuilder^ HitBuilder::CreateSocialInteraction(String^ network, String^ action, String^ target)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_SocialNetworkInteraction);
-	data->Insert("sn", network);
-	data->Insert("sa", action);
-	data->Insert("st", target);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_SocialNetworkInteraction);
+	Add(data, MakeKey(Parameter::SocialNetwork), network);
+	Add(data, MakeKey(Parameter::SocialAction), action);
+	Add(data, MakeKey(Parameter::SocialTarget), target);
 	return ref new HitBuilder(data);
 }
 
 HitBuilder^ HitBuilder::CreateTiming(String^ category, String^ variable, IBox<TimeSpan>^ time, String^ label)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("t", HitBuilder::HitType_UserTiming);
-	if (category) data->Insert("utc", category);
-	if (variable) data->Insert("utv", variable);
-	if (time != nullptr) data->Insert("utt", std::floor(0.5 + TimeSpanHelper::GetTotalMilliseconds(time->Value)).ToString());
-	if (label) data->Insert("utl", label);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::HitType), HitBuilder::HitType_UserTiming);
+	if (category) Add(data, MakeKey(Parameter::TimingCategory), category);
+	if (variable) Add(data, MakeKey(Parameter::TimingVariable), variable);
+	if (time != nullptr) Add(data, MakeKey(Parameter::TimingTime), std::floor(0.5 + TimeSpanHelper::GetTotalMilliseconds(time->Value)).ToString());
+	if (label) Add(data, MakeKey(Parameter::TimingLabel), label);
 	return ref new HitBuilder(data);
 }
 
-String^ HitBuilder::Get(String^ paramName)
+IMap<String^, String^>^ HitBuilder::Data::get()
 {
-	return data->Lookup(paramName);
+	auto data = ref new Map<String^, String^>();
+	buffer->ForEach(start, length, [data](const HitBuilderBuffer::Parameter& parameter) {
+		data->Insert(GetName(parameter), parameter.Value);
+	});
+	return data;
 }
 
-HitBuilder^ HitBuilder::Set(String^ paramName, String^ paramValue)
+String^ HitBuilder::Get(String^ paramName)
 {
-	if (data->HasKey(paramName))
+	KeyId key = ParseKey(paramName->Data(), paramName->Length());
+	if (key != UnknownKey && !IsValid(key))
+	{
+		key = UnknownKey;
+	}
+	String^ result;
+	bool found = false;
+	buffer->ForEachReversed(start, length, [&](const HitBuilderBuffer::Parameter& parameter) {
+		if (!found && IsSameKey(parameter, key, paramName))
+		{
+			result = parameter.Value;
+			found = true;
+		}
+	});
+	if (!found)
 	{
-		data->Remove(paramName);
+		throw ref new OutOfBoundsException();
 	}
-	data->Insert(paramName, paramValue);
-	return ref new HitBuilder(lineage, data);
+	return result;
+}
+
+HitBuilder^ HitBuilder::Set(String^ paramName, String^ paramValue)
+{
+	HitBuilderBuffer::Parameters data;
+	Add(data, paramName, paramValue);
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetAll(IMap<String^, String^>^ params)
 {
-	return ref new HitBuilder(lineage, params);
+	HitBuilderBuffer::Parameters data;
+	data.reserve(params->Size);
+	for each (auto kvp in params)
+	{
+		Add(data, kvp->Key, kvp->Value);
+	}
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetCustomDimension(int index, Platform::String^ dimension)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("cd" + index, dimension);
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(IndexedParameter::CustomDimension, index), dimension);
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetCustomMetric(int index, long long metric)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("cd" + index, metric.ToString());
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(IndexedParameter::CustomMetric, index), metric.ToString());
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetNewSession()
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("sc", "start");
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::SessionControl), "start");
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetNonInteraction()
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("ni", "1");
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::NonInteraction), "1");
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::AddProduct(Product^ product)
 {
 	int index(ProductCount + 1);
 
-	auto data = ref new Map<String^, String^>();
-	if (product->Id) data->Insert("pr" + index + "id", product->Id);
-	if (product->Name) data->Insert("pr" + index + "nm", product->Name);
-	if (product->Brand) data->Insert("pr" + index + "br", product->Brand);
-	if (product->Category) data->Insert("pr" + index + "ca", product->Category);
-	if (product->Variant) data->Insert("pr" + index + "va", product->Variant);
-	if (product->Price) data->Insert("pr" + index + "pr", product->Price->Value.ToString());
-	if (product->Quantity) data->Insert("pr" + index + "at", product->Quantity->Value.ToString());
-	if (product->CouponCode) data->Insert("pr" + index + "cc", product->CouponCode);
-	if (product->Position) data->Insert("pr" + index + "ps", product->Position->Value.ToString());
+	HitBuilderBuffer::Parameters data;
+	if (product->Id) Add(data, MakeKey(IndexedParameter::ProductSku, index), product->Id);
+	if (product->Name) Add(data, MakeKey(IndexedParameter::ProductName, index), product->Name);
+	if (product->Brand) Add(data, MakeKey(IndexedParameter::ProductBrand, index), product->Brand);
+	if (product->Category) Add(data, MakeKey(IndexedParameter::ProductCategory, index), product->Category);
+	if (product->Variant) Add(data, MakeKey(IndexedParameter::ProductVariant, index), product->Variant);
+	if (product->Price) Add(data, MakeKey(IndexedParameter::ProductPrice, index), product->Price->Value.ToString());
+	if (product->Quantity) Add(data, MakeKey(IndexedParameter::ProductQuantity, index), product->Quantity->Value.ToString());
+	if (product->CouponCode) Add(data, MakeKey(IndexedParameter::ProductCouponCode, index), product->CouponCode);
+	if (product->Position) Add(data, MakeKey(IndexedParameter::ProductPosition, index), product->Position->Value.ToString());
 
 	for each (auto kvp in product->CustomDimensions)
 	{
-		data->Insert("pr" + index + "cd" + kvp->Key, kvp->Value);
+		Add(data, MakeKey(IndexedParameter::ProductCustomDimension, index, kvp->Key), kvp->Value);
 	}
-	for each (auto kvp in product->CustomDimensions)
+	for each (auto kvp in product->CustomMetrics)
 	{
-		data->Insert("pr" + index + "cm" + kvp->Key, kvp->Value);
+		Add(data, MakeKey(IndexedParameter::ProductCustomMetric, index, kvp->Key), kvp->Value.ToString());
 	}
 	
-	auto result = ref new HitBuilder(lineage, data);
-	result->ProductCount = index;
-	return result;
+	return Derive(data, index, PromotionCount);
 }
 
 
@@ -202,53 +263,55 @@ HitBuilder^ HitBuilder::AddPromotion(Promotion^ promotion)
 {
 	int index(PromotionCount + 1);
 
-	auto data = ref new Map<String^, String^>();
-	if (promotion->Id) data->Insert("promo" + index + "id", promotion->Id);
-	if (promotion->Name) data->Insert("promo" + index + "nm", promotion->Name);
-	if (promotion->Creative) data->Insert("promo" + index + "cr", promotion->Creative);
-	if (promotion->Position) data->Insert("promo" + index + "ps", promotion->Position);
+	HitBuilderBuffer::Parameters data;
+	if (promotion->Id) Add(data, MakeKey(IndexedParameter::PromotionId, index), promotion->Id);
+	if (promotion->Name) Add(data, MakeKey(IndexedParameter::PromotionName, index), promotion->Name);
+	if (promotion->Creative) Add(data, MakeKey(IndexedParameter::PromotionCreative, index), promotion->Creative);
+	if (promotion->Position) Add(data, MakeKey(IndexedParameter::PromotionPosition, index), promotion->Position);
 
-	auto result = ref new HitBuilder(lineage, data);
-	result->PromotionCount = index;
-	return result;
+	return Derive(data, ProductCount, index);
 }
 
 HitBuilder^ HitBuilder::SetProductAction(ProductAction^ action)
 {
-	auto data = ref new Map<String^, String^>();
-	if (action->Action) data->Insert("pa", action->Action);
-	if (action->TransactionId) data->Insert("ti", action->TransactionId);
-	if (action->TransactionAffiliation) data->Insert("ta", action->TransactionAffiliation);
-	if (action->TransactionRevenue) data->Insert("tr", action->TransactionRevenue->Value.ToString());
-	if (action->TransactionTax) data->Insert("tt", action->TransactionTax->Value.ToString());
-	if (action->TransactionShipping) data->Insert("ts", action->TransactionShipping->Value.ToString());
-	if (action->TransactionCouponCode) data->Insert("tcc", action->TransactionCouponCode);
-	if (action->ProductActionList) data->Insert("pal", action->ProductActionList);
-	if (action->CheckoutStep) data->Insert("cos", action->CheckoutStep->Value.ToString());
-	if (action->CheckoutOptions) data->Insert("col", action->CheckoutOptions);
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	if (action->Action) Add(data, MakeKey(Parameter::ProductAction), action->Action);
+	if (action->TransactionId) Add(data, MakeKey(Parameter::TransactionId), action->TransactionId);
+	if (action->TransactionAffiliation) Add(data, MakeKey(Parameter::TransactionAffiliation), action->TransactionAffiliation);
+	if (action->TransactionRevenue) Add(data, MakeKey(Parameter::TransactionRevenue), action->TransactionRevenue->Value.ToString());
+	if (action->TransactionTax) Add(data, MakeKey(Parameter::TransactionTax), action->TransactionTax->Value.ToString());
+	if (action->TransactionShipping) Add(data, MakeKey(Parameter::TransactionShipping), action->TransactionShipping->Value.ToString());
+	if (action->TransactionCouponCode) Add(data, MakeKey(Parameter::TransactionCoupon), action->TransactionCouponCode);
+	if (action->ProductActionList) Add(data, MakeKey(Parameter::ProductActionList), action->ProductActionList);
+	if (action->CheckoutStep) Add(data, MakeKey(Parameter::CheckoutStep), action->CheckoutStep->Value.ToString());
+	if (action->CheckoutOptions) Add(data, MakeKey(Parameter::CheckoutStepOption), action->CheckoutOptions);
+	return Derive(data);
 }
 
 HitBuilder^ HitBuilder::SetPromotionAction(PromotionAction action)
 {
-	auto data = ref new Map<String^, String^>();
-	data->Insert("pa", Promotion::GetAction(action));
-	return ref new HitBuilder(lineage, data);
+	HitBuilderBuffer::Parameters data;
+	Add(data, MakeKey(Parameter::ProductAction), Promotion::GetAction(action));
+	return Derive(data);
 }
 
 IMap<String^, String^>^ HitBuilder::Build()
 {
+	// walk the chain backwards so the first value seen for a key is the one that wins; each key is spelled out once
 	auto data = ref new Map<String^, String^>();
-	for each (auto hitBuilder in lineage)
-	{
-		for each (auto kvp in hitBuilder->Data)
+	std::unordered_set<KeyId> seen;
+	buffer->ForEachReversed(0, length, [&](const HitBuilderBuffer::Parameter& parameter) {
+		if (parameter.Key != UnknownKey)
 		{
-			if (data->HasKey(kvp->Key)) 
+			if (seen.insert(parameter.Key).second)
 			{
-				data->Remove(kvp->Key);
+				data->Insert(GetName(parameter), parameter.Value);
 			}
-			data->Insert(kvp->Key, kvp->Value);
 		}
-	}
+		else if (!data->HasKey(parameter.Name))
+		{
+			data->Insert(parameter.Name, parameter.Value);
+		}
+	});
 	return data;
-}
\ No newline at end of file
+}
@@ -9,7 +9,10 @@
 #include "Ecommerce/Promotion.h"
 
 #include "Tracker.h" 
- 
+#include "HitBuilderBuffer.h"
+#include "MeasurementProtocol.h"
+#include <memory>
+#include <vector>
 
 namespace GoogleAnalytics
 {
@@ -17,6 +20,8 @@ namespace GoogleAnalytics
 	ref class GoogleAnalytics::Ecommerce::Product;
 	ref class GoogleAnalytics::Ecommerce::ProductAction;
 
+	typedef BasicHitBuilderBuffer<Platform::String^> HitBuilderBuffer;
+
 	/// <summary>
 	/// Class to build hits. You can add any of the other fields to the builder using common set and get methods.
 	/// </summary>
@@ -34,21 +39,28 @@ namespace GoogleAnalytics
 		
 		static Platform::String^ HitType_UserTiming;
 		
-		Windows::Foundation::Collections::IVector<HitBuilder^>^ lineage;
+		std::shared_ptr<HitBuilderBuffer> buffer;
+
+		size_t start;
+
+		size_t length;
 
-		Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data;
+		HitBuilder(const HitBuilderBuffer::Parameters& parameters);
 
-		HitBuilder();
+		HitBuilder(std::shared_ptr<HitBuilderBuffer> buffer, size_t start, size_t length, int productCount, int promotionCount);
 
-		HitBuilder(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data);
+		HitBuilder^ Derive(const HitBuilderBuffer::Parameters& parameters);
 
-		HitBuilder(Windows::Foundation::Collections::IVector<HitBuilder^>^ lineage, Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data);
+		HitBuilder^ Derive(const HitBuilderBuffer::Parameters& parameters, int productCount, int promotionCount);
 		
 	public:
 
+		/// <summary>
+		/// Gets the parameters added by the call that created this builder.
+		/// </summary>
 		property Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ Data
 		{
-			Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ get() { return data; }
+			Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ get();
 		}
 
 		property int ProductCount;
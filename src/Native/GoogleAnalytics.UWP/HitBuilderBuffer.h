@@ -0,0 +1,104 @@
+//
+// HitBuilderBuffer.h
+// Declaration of the BasicHitBuilderBuffer class.
+//
+
+#pragma once
+
+#include "MeasurementProtocol.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Append-only list of the parameters set through a chain of <see cref="HitBuilder"/> calls.
+	/// </summary>
+	/// <remarks>
+	/// Each builder sees a prefix of the buffer. A builder whose prefix is the whole buffer appends in place, so a fluent chain shares one buffer;
+	/// deriving twice from the same builder copies its prefix into a new buffer for the second branch, leaving the first untouched.
+	/// Templated on the string type only so it builds without the Windows Runtime; the library uses it as <see cref="HitBuilderBuffer"/>.
+	/// </remarks>
+	template <typename String>
+	class BasicHitBuilderBuffer : public std::enable_shared_from_this<BasicHitBuilderBuffer<String>>
+	{
+	public:
+
+		/// <summary>
+		/// A parameter of the vocabulary is kept as its key alone; Name is only set for keys outside of it.
+		/// </summary>
+		struct Parameter
+		{
+			MeasurementProtocol::KeyId Key;
+			String Name;
+			String Value;
+		};
+
+		typedef std::vector<Parameter> Parameters;
+
+	private:
+
+		std::mutex lock;
+
+		Parameters entries;
+
+	public:
+
+		BasicHitBuilderBuffer()
+		{
+			// enough for a typical hit and a few fluent calls without growing
+			entries.reserve(32);
+		}
+
+		/// <summary>
+		/// Returns a buffer holding the first length entries of this one followed by parameters: this buffer if nothing was appended past length yet, a copy otherwise.
+		/// </summary>
+		std::shared_ptr<BasicHitBuilderBuffer> Extend(size_t length, const Parameters& parameters)
+		{
+			{
+				std::lock_guard<std::mutex> lg(lock);
+				if (entries.size() == length)
+				{
+					entries.insert(end(entries), begin(parameters), end(parameters));
+					return this->shared_from_this();
+				}
+			}
+
+			// another builder already extended this prefix; branch off with a copy of it
+			auto result = std::make_shared<BasicHitBuilderBuffer>();
+			result->entries.reserve(length + parameters.size() + 16);
+			ForEach(0, length, [&result](const Parameter& parameter) {
+				result->entries.push_back(parameter);
+			});
+			result->entries.insert(end(result->entries), begin(parameters), end(parameters));
+			return result;
+		}
+
+		/// <summary>
+		/// Calls action(parameter) for entries [first, last) under the buffer lock.
+		/// </summary>
+		template <typename Action>
+		void ForEach(size_t first, size_t last, Action action)
+		{
+			std::lock_guard<std::mutex> lg(lock);
+			for (size_t i = first; i < last; i++)
+			{
+				action(entries[i]);
+			}
+		}
+
+		/// <summary>
+		/// Same as ForEach, from the last entry to the first.
+		/// </summary>
+		template <typename Action>
+		void ForEachReversed(size_t first, size_t last, Action action)
+		{
+			std::lock_guard<std::mutex> lg(lock);
+			for (size_t i = last; i > first; i--)
+			{
+				action(entries[i - 1]);
+			}
+		}
+	};
+}
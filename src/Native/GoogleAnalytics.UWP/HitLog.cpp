@@ -0,0 +1,389 @@
+//
+// HitLog.cpp
+// Implementation of the HitLog class.
+//
+
+#include "pch.h"
+#include <algorithm>
+#include <unordered_set>
+#include "HitLog.h"
+#include "Crc32.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	// record layout: body length (u32), crc of type and body (u32), type (u8), body
+	const size_t RecordHeaderSize = 9;
+
+	const unsigned char RecordType_Hit = 1;
+	const unsigned char RecordType_Acknowledgement = 2;
+
+	void WriteUInt32(std::string& buffer, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++) buffer.push_back((char)(value >> (8 * i)));
+	}
+
+	void WriteUInt64(std::string& buffer, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++) buffer.push_back((char)(value >> (8 * i)));
+	}
+
+	// strings are stored as UTF-16 code units whatever the width of wchar_t
+	void WriteString(std::string& buffer, const wchar_t* text, size_t length)
+	{
+		std::string units;
+		units.reserve(length * 2);
+		for (size_t i = 0; i < length; i++)
+		{
+			unsigned long c = (unsigned long)text[i];
+			if (c > 0xFFFF)
+			{
+				c -= 0x10000;
+				unsigned long high = 0xD800 + (c >> 10);
+				unsigned long low = 0xDC00 + (c & 0x3FF);
+				units.push_back((char)high);
+				units.push_back((char)(high >> 8));
+				units.push_back((char)low);
+				units.push_back((char)(low >> 8));
+			}
+			else
+			{
+				units.push_back((char)c);
+				units.push_back((char)(c >> 8));
+			}
+		}
+		WriteUInt32(buffer, (uint32_t)(units.size() / 2));
+		buffer += units;
+	}
+
+	class Reader
+	{
+	private:
+
+		const std::string& data;
+
+		size_t position;
+
+		size_t end;
+
+	public:
+
+		bool Failed;
+
+		Reader(const std::string& data, size_t position, size_t end)
+			: data(data), position(position), end(end), Failed(false)
+		{ }
+
+		uint64_t ReadUInt(int size)
+		{
+			if (end - position < (size_t)size)
+			{
+				Failed = true;
+				return 0;
+			}
+			uint64_t value = 0;
+			for (int i = 0; i < size; i++)
+			{
+				value |= (uint64_t)(unsigned char)data[position + i] << (8 * i);
+			}
+			position += size;
+			return value;
+		}
+
+		std::wstring ReadString()
+		{
+			size_t units = (size_t)ReadUInt(4);
+			std::wstring result;
+			if (Failed || (end - position) / 2 < units)
+			{
+				Failed = true;
+				return result;
+			}
+			result.reserve(units);
+			for (size_t i = 0; i < units; i++)
+			{
+				unsigned long c = (unsigned char)data[position] | ((unsigned long)(unsigned char)data[position + 1] << 8);
+				position += 2;
+				if (sizeof(wchar_t) > 2 && c >= 0xD800 && c <= 0xDBFF && i + 1 < units)
+				{
+					unsigned long low = (unsigned char)data[position] | ((unsigned long)(unsigned char)data[position + 1] << 8);
+					if (low >= 0xDC00 && low <= 0xDFFF)
+					{
+						position += 2;
+						i++;
+						c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					}
+				}
+				result.push_back((wchar_t)c);
+			}
+			return result;
+		}
+	};
+
+	struct ParsedRecord
+	{
+		unsigned char Type;
+		size_t Offset;
+		size_t Size;
+		size_t BodyOffset;
+		size_t BodySize;
+	};
+
+	// walks the records of a segment, stopping at the first one that is torn or corrupt
+	template <typename Action>
+	void ForEachRecord(const std::string& contents, Action action)
+	{
+		size_t offset = 0;
+		while (contents.size() - offset >= RecordHeaderSize)
+		{
+			Reader header(contents, offset, contents.size());
+			size_t bodySize = (size_t)header.ReadUInt(4);
+			uint32_t crc = (uint32_t)header.ReadUInt(4);
+			if (contents.size() - offset - RecordHeaderSize < bodySize)
+			{
+				break;
+			}
+			if (Crc32::Compute(contents.data() + offset + 8, bodySize + 1) != crc)
+			{
+				break;
+			}
+			ParsedRecord record;
+			record.Type = (unsigned char)contents[offset + 8];
+			record.Offset = offset;
+			record.Size = RecordHeaderSize + bodySize;
+			record.BodyOffset = offset + RecordHeaderSize;
+			record.BodySize = bodySize;
+			action(record);
+			offset += record.Size;
+		}
+	}
+}
+
+HitLog::HitLog(std::unique_ptr<ISegmentStore> store, size_t maxSegmentBytes) :
+	store(std::move(store)),
+	maxSegmentBytes(maxSegmentBytes),
+	nextSequence(1),
+	firstSegment(0),
+	currentSegment(0)
+{ }
+
+void HitLog::AppendRecord(std::string& buffer, unsigned char type, const std::string& body)
+{
+	std::string typeAndBody;
+	typeAndBody.reserve(body.size() + 1);
+	typeAndBody.push_back((char)type);
+	typeAndBody += body;
+	WriteUInt32(buffer, (uint32_t)body.size());
+	WriteUInt32(buffer, Crc32::Compute(typeAndBody.data(), typeAndBody.size()));
+	buffer += typeAndBody;
+}
+
+std::vector<LoggedHit> HitLog::Recover()
+{
+	std::lock_guard<std::mutex> lg(logLock);
+
+	firstSegment = store->GetFirstSegment();
+	// segments left behind by a compaction that was interrupted after moving the head
+	for (uint32_t orphan = firstSegment; orphan > 0 && store->Exists(orphan - 1); orphan--)
+	{
+		store->Remove(orphan - 1);
+	}
+
+	std::unordered_map<uint64_t, LoggedHit> hits;
+	std::unordered_set<uint64_t> acknowledged;
+	uint64_t lastSequence = 0;
+	segments.clear();
+	liveHits.clear();
+
+	std::string contents;
+	for (uint32_t segment = firstSegment; store->Exists(segment); segment++)
+	{
+		Segment info = { 0, 0, 0 };
+		if (store->Read(segment, contents))
+		{
+			info.Bytes = contents.size();
+			ForEachRecord(contents, [&](const ParsedRecord& record) {
+				Reader reader(contents, record.BodyOffset, record.BodyOffset + record.BodySize);
+				if (record.Type == RecordType_Hit)
+				{
+					LoggedHit hit;
+					hit.Sequence = reader.ReadUInt(8);
+					hit.TimeStamp = (long long)reader.ReadUInt(8);
+					size_t count = (size_t)reader.ReadUInt(4);
+					for (size_t i = 0; i < count && !reader.Failed; i++)
+					{
+						std::wstring key = reader.ReadString();
+						std::wstring value = reader.ReadString();
+						if (!reader.Failed) hit.Record.Set(key.data(), key.size(), value.data(), value.size());
+					}
+					if (!reader.Failed)
+					{
+						info.Hits++;
+						lastSequence = (std::max)(lastSequence, hit.Sequence);
+						// a hit moved forward by the compactor appears twice; the later copy wins
+						liveHits[hit.Sequence] = segment;
+						hits[hit.Sequence] = std::move(hit);
+					}
+				}
+				else if (record.Type == RecordType_Acknowledgement)
+				{
+					uint64_t sequence = reader.ReadUInt(8);
+					if (!reader.Failed) acknowledged.insert(sequence);
+				}
+			});
+		}
+		segments.push_back(info);
+	}
+
+	std::vector<LoggedHit> result;
+	for (auto it = hits.begin(); it != hits.end(); ++it)
+	{
+		if (acknowledged.find(it->first) == acknowledged.end())
+		{
+			segments[liveHits[it->first] - firstSegment].LiveHits++;
+			result.push_back(std::move(it->second));
+		}
+		else
+		{
+			liveHits.erase(it->first);
+		}
+	}
+	std::sort(result.begin(), result.end(), [](const LoggedHit& a, const LoggedHit& b) { return a.Sequence < b.Sequence; });
+
+	// never append after a torn tail; new records always go to a fresh segment
+	currentSegment = firstSegment + (uint32_t)segments.size();
+	Segment current = { 0, 0, 0 };
+	segments.push_back(current);
+
+	std::lock_guard<std::mutex> pl(pendingLock);
+	nextSequence = lastSequence + 1;
+	return result;
+}
+
+uint64_t HitLog::Append(const HitRecord& record, long long timeStamp, bool& isFirstPending)
+{
+	std::string body;
+	body.reserve(20 + record.ByteSize());
+	std::lock_guard<std::mutex> lg(pendingLock);
+	uint64_t sequence = nextSequence++;
+	WriteUInt64(body, sequence);
+	WriteUInt64(body, (uint64_t)timeStamp);
+	WriteUInt32(body, (uint32_t)record.Count());
+	record.ForEach([&body](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+		WriteString(body, key, keyLength);
+		WriteString(body, value, valueLength);
+	});
+	isFirstPending = pending.empty();
+	AppendRecord(pending, RecordType_Hit, body);
+	pendingHits.push_back(sequence);
+	return sequence;
+}
+
+void HitLog::Acknowledge(uint64_t sequence, bool& isFirstPending)
+{
+	std::string body;
+	WriteUInt64(body, sequence);
+	std::lock_guard<std::mutex> lg(pendingLock);
+	isFirstPending = pending.empty();
+	AppendRecord(pending, RecordType_Acknowledgement, body);
+	pendingAcknowledgements.push_back(sequence);
+}
+
+void HitLog::Commit()
+{
+	std::string data;
+	std::vector<uint64_t> hits;
+	std::vector<uint64_t> acknowledgements;
+	{
+		std::lock_guard<std::mutex> lg(pendingLock);
+		data.swap(pending);
+		hits.swap(pendingHits);
+		acknowledgements.swap(pendingAcknowledgements);
+	}
+	if (data.empty())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lg(logLock);
+	WriteLocked(data, hits);
+	ApplyAcknowledgementsLocked(acknowledgements);
+}
+
+void HitLog::WriteLocked(const std::string& data, const std::vector<uint64_t>& hits)
+{
+	if (segments.back().Bytes > 0 && segments.back().Bytes + data.size() > maxSegmentBytes)
+	{
+		currentSegment++;
+		Segment next = { 0, 0, 0 };
+		segments.push_back(next);
+	}
+	// a failed write only costs durability; the hits are still queued in memory
+	store->Append(currentSegment, data.data(), data.size());
+
+	Segment& segment = segments.back();
+	segment.Bytes += data.size();
+	segment.Hits += hits.size();
+	segment.LiveHits += hits.size();
+	for (auto it = hits.begin(); it != hits.end(); ++it)
+	{
+		liveHits[*it] = currentSegment;
+	}
+}
+
+void HitLog::ApplyAcknowledgementsLocked(const std::vector<uint64_t>& sequences)
+{
+	for (auto it = sequences.begin(); it != sequences.end(); ++it)
+	{
+		auto live = liveHits.find(*it);
+		if (live != liveHits.end())
+		{
+			segments[live->second - firstSegment].LiveHits--;
+			liveHits.erase(live);
+		}
+	}
+}
+
+void HitLog::Compact()
+{
+	std::lock_guard<std::mutex> lg(logLock);
+	while (firstSegment < currentSegment)
+	{
+		if (segments.front().LiveHits > 0)
+		{
+			if (segments.front().LiveHits * 4 > segments.front().Hits)
+			{
+				break;
+			}
+
+			// mostly acknowledged: carry the remaining hits forward so the segment can go
+			std::string contents;
+			if (!store->Read(firstSegment, contents))
+			{
+				break;
+			}
+			std::string moved;
+			std::vector<uint64_t> movedHits;
+			ForEachRecord(contents, [&](const ParsedRecord& record) {
+				if (record.Type != RecordType_Hit) return;
+				Reader reader(contents, record.BodyOffset, record.BodyOffset + record.BodySize);
+				uint64_t sequence = reader.ReadUInt(8);
+				auto live = liveHits.find(sequence);
+				if (!reader.Failed && live != liveHits.end() && live->second == firstSegment)
+				{
+					moved.append(contents, record.Offset, record.Size);
+					movedHits.push_back(sequence);
+				}
+			});
+			WriteLocked(moved, movedHits);
+			segments.front().LiveHits = 0;
+		}
+
+		// move the head first, so a crash never leaves it pointing at a removed segment
+		store->SetFirstSegment(firstSegment + 1);
+		store->Remove(firstSegment);
+		segments.erase(segments.begin());
+		firstSegment++;
+	}
+}
@@ -0,0 +1,117 @@
+//
+// HitLog.h
+// Declaration of the HitLog class.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HitRecord.h"
+#include "SegmentStore.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// A hit read back from a <see cref="HitLog"/> that had not been acknowledged.
+	/// </summary>
+	struct LoggedHit
+	{
+		uint64_t Sequence;
+
+		/// <summary>
+		/// The original time stamp of the hit, in 100ns ticks since 1601 (the Windows::Foundation::DateTime epoch).
+		/// </summary>
+		long long TimeStamp;
+
+		HitRecord Record;
+	};
+
+	/// <summary>
+	/// Append-only, segmented write-ahead log of queued hits.
+	/// </summary>
+	/// <remarks>
+	/// Every record carries a CRC so a torn write at the end of a segment is detected and ignored on recovery. Hits are acknowledged once
+	/// they no longer need to be sent; <see cref="Compact"/> then drops the oldest segments whose hits have all been acknowledged, moving
+	/// the few hits still alive in a mostly acknowledged segment forward first. Appends are buffered and written together by
+	/// <see cref="Commit"/> (group commit).
+	/// </remarks>
+	class HitLog
+	{
+	private:
+
+		struct Segment
+		{
+			size_t Bytes;
+			size_t Hits;
+			size_t LiveHits;
+		};
+
+		std::unique_ptr<ISegmentStore> store;
+
+		size_t maxSegmentBytes;
+
+		std::mutex pendingLock;
+
+		std::string pending;
+
+		std::mutex logLock;
+
+		uint64_t nextSequence;
+
+		uint32_t firstSegment;
+
+		uint32_t currentSegment;
+
+		std::vector<Segment> segments;
+
+		std::unordered_map<uint64_t, uint32_t> liveHits;
+
+		std::vector<uint64_t> pendingHits;
+
+		std::vector<uint64_t> pendingAcknowledgements;
+
+		static void AppendRecord(std::string& buffer, unsigned char type, const std::string& body);
+
+		void WriteLocked(const std::string& data, const std::vector<uint64_t>& hits);
+
+		void ApplyAcknowledgementsLocked(const std::vector<uint64_t>& sequences);
+
+	public:
+
+		static const size_t DefaultSegmentBytes = 256 * 1024;
+
+		HitLog(std::unique_ptr<ISegmentStore> store, size_t maxSegmentBytes = DefaultSegmentBytes);
+
+		/// <summary>
+		/// Reads the log back and returns the hits that were never acknowledged, oldest first. Call once, before any other method.
+		/// </summary>
+		std::vector<LoggedHit> Recover();
+
+		/// <summary>
+		/// Buffers a hit for the next <see cref="Commit"/> and returns its sequence number.
+		/// </summary>
+		/// <param name="isFirstPending">Set to true when nothing else was waiting to be committed, meaning a commit should be scheduled.</param>
+		uint64_t Append(const HitRecord& record, long long timeStamp, bool& isFirstPending);
+
+		/// <summary>
+		/// Buffers the acknowledgement of a hit that no longer needs to be sent.
+		/// </summary>
+		/// <param name="isFirstPending">Set to true when nothing else was waiting to be committed, meaning a commit should be scheduled.</param>
+		void Acknowledge(uint64_t sequence, bool& isFirstPending);
+
+		/// <summary>
+		/// Writes everything buffered so far to disk with a single write.
+		/// </summary>
+		void Commit();
+
+		/// <summary>
+		/// Removes the oldest segments once their hits are acknowledged.
+		/// </summary>
+		void Compact();
+	};
+}
@@ -0,0 +1,162 @@
+//
+// HitRecord.cpp
+// Implementation of the HitRecord class.
+//
+
+#include "pch.h"
+#include <algorithm>
+#include <cwchar>
+#include "HitRecord.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	bool IsBefore(const std::pair<KeyId, uint32_t>& entry, KeyId id)
+	{
+		return entry.first < id;
+	}
+}
+
+HitRecord::HitRecord() :
+	garbage(0)
+{
+	knownFields.fill((uint16_t)NoField);
+}
+
+void HitRecord::Reserve(size_t fieldCount, size_t characterCount)
+{
+	fields.reserve(fieldCount);
+	arena.reserve(characterCount);
+}
+
+uint32_t HitRecord::Store(const wchar_t* text, size_t length)
+{
+	uint32_t offset = (uint32_t)arena.size();
+	arena.append(text, length);
+	return offset;
+}
+
+void HitRecord::Compact()
+{
+	std::wstring compacted;
+	compacted.reserve(arena.size() - garbage);
+	for (auto it = fields.begin(); it != fields.end(); ++it)
+	{
+		if (it->Key == Parameter::Unknown)
+		{
+			uint32_t keyOffset = (uint32_t)compacted.size();
+			compacted.append(arena, it->KeyOffset, it->KeyLength);
+			it->KeyOffset = keyOffset;
+		}
+		uint32_t valueOffset = (uint32_t)compacted.size();
+		compacted.append(arena, it->ValueOffset, it->ValueLength);
+		it->ValueOffset = valueOffset;
+	}
+	arena.swap(compacted);
+	garbage = 0;
+}
+
+const HitRecord::Field* HitRecord::FindField(KeyId id, const wchar_t* key, size_t keyLength) const
+{
+	if (IsIndexed(id))
+	{
+		auto entry = std::lower_bound(indexedFields.begin(), indexedFields.end(), id, IsBefore);
+		return entry != indexedFields.end() && entry->first == id ? &fields[entry->second] : nullptr;
+	}
+	if (id != UnknownKey)
+	{
+		uint16_t index = knownFields[id];
+		return index == NoField ? nullptr : &fields[index];
+	}
+	for (auto it = fields.begin(); it != fields.end(); ++it)
+	{
+		if (it->Key == Parameter::Unknown && it->KeyLength == keyLength && wmemcmp(arena.data() + it->KeyOffset, key, keyLength) == 0)
+		{
+			return &*it;
+		}
+	}
+	return nullptr;
+}
+
+void HitRecord::Set(const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength)
+{
+	KeyId id = ParseKey(key, keyLength);
+	Field* existing = const_cast<Field*>(FindField(id, key, keyLength));
+	if (existing)
+	{
+		if (valueLength <= existing->ValueLength)
+		{
+			wmemcpy(&arena[existing->ValueOffset], value, valueLength);
+			garbage += existing->ValueLength - valueLength;
+		}
+		else
+		{
+			garbage += existing->ValueLength;
+			existing->ValueOffset = Store(value, valueLength);
+		}
+		existing->ValueLength = (uint32_t)valueLength;
+		if (garbage > arena.size() - garbage)
+		{
+			Compact();
+		}
+		return;
+	}
+
+	Field field;
+	field.Key = id != UnknownKey && !IsIndexed(id) ? (Parameter)id : Parameter::Unknown;
+	field.KeyOffset = 0;
+	field.KeyLength = 0;
+	if (field.Key == Parameter::Unknown || fields.size() >= NoField)
+	{
+		field.Key = Parameter::Unknown;
+		field.KeyOffset = Store(key, keyLength);
+		field.KeyLength = (uint32_t)keyLength;
+		if (IsIndexed(id))
+		{
+			indexedFields.insert(std::lower_bound(indexedFields.begin(), indexedFields.end(), id, IsBefore), std::make_pair(id, (uint32_t)fields.size()));
+		}
+	}
+	else
+	{
+		knownFields[(size_t)field.Key] = (uint16_t)fields.size();
+	}
+	field.ValueOffset = Store(value, valueLength);
+	field.ValueLength = (uint32_t)valueLength;
+	fields.push_back(field);
+}
+
+bool HitRecord::TryGet(Parameter key, const wchar_t*& value, size_t& valueLength) const
+{
+	uint16_t index = knownFields[(size_t)key];
+	if (index == NoField)
+	{
+		return false;
+	}
+	value = arena.data() + fields[index].ValueOffset;
+	valueLength = fields[index].ValueLength;
+	return true;
+}
+
+bool HitRecord::TryGet(const wchar_t* key, size_t keyLength, const wchar_t*& value, size_t& valueLength) const
+{
+	const Field* field = FindField(ParseKey(key, keyLength), key, keyLength);
+	if (!field)
+	{
+		return false;
+	}
+	value = arena.data() + field->ValueOffset;
+	valueLength = field->ValueLength;
+	return true;
+}
+
+size_t HitRecord::Count() const
+{
+	return fields.size();
+}
+
+size_t HitRecord::ByteSize() const
+{
+	return sizeof(HitRecord) + arena.capacity() * sizeof(wchar_t) + fields.capacity() * sizeof(Field) + indexedFields.capacity() * sizeof(indexedFields[0]);
+}
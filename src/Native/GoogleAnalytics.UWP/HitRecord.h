@@ -0,0 +1,107 @@
+//
+// HitRecord.h
+// Declaration of the HitRecord class.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MeasurementProtocol.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Compact storage for the parameters of a <see cref="Hit"/>.
+	/// </summary>
+	/// <remarks>
+	/// All keys and values live in a single character arena. Parameters from the fixed Measurement Protocol vocabulary are found through
+	/// a small array indexed by <see cref="MeasurementProtocol::Parameter"/> and do not store their key; any other key is spilled into the
+	/// arena next to its value. Spilled keys of indexed families (cd&lt;i&gt;, pr&lt;i&gt;id, ...) are also found through a sorted index of their
+	/// <see cref="MeasurementProtocol::KeyId"/>, so that only keys outside of the vocabulary are looked up by a scan.
+	/// Parameters keep the order in which they were first set.
+	/// A replaced value is overwritten in place when the new one fits; otherwise the old one is left behind, and the arena is compacted once
+	/// such leftovers outweigh the live keys and values, so a record that is set over and over stays bounded.
+	/// </remarks>
+	class HitRecord
+	{
+	private:
+
+		static const uint16_t NoField = 0xFFFF;
+
+		struct Field
+		{
+			MeasurementProtocol::Parameter Key;
+			uint32_t KeyOffset;
+			uint32_t KeyLength;
+			uint32_t ValueOffset;
+			uint32_t ValueLength;
+		};
+
+		std::wstring arena;
+
+		// characters of the arena no field refers to any more
+		size_t garbage;
+
+		std::vector<Field> fields;
+
+		std::array<uint16_t, MeasurementProtocol::ParameterCount> knownFields;
+
+		// the fields of indexed parameters, sorted by key
+		std::vector<std::pair<MeasurementProtocol::KeyId, uint32_t>> indexedFields;
+
+		uint32_t Store(const wchar_t* text, size_t length);
+
+		void Compact();
+
+		const Field* FindField(MeasurementProtocol::KeyId id, const wchar_t* key, size_t keyLength) const;
+
+	public:
+
+		HitRecord();
+
+		/// <summary>
+		/// Reserves room for the given number of parameters and characters (keys and values combined) so building the record allocates once.
+		/// </summary>
+		void Reserve(size_t fieldCount, size_t characterCount);
+
+		/// <summary>
+		/// Sets a parameter. Setting a key that is already present replaces its value.
+		/// </summary>
+		void Set(const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength);
+
+		/// <summary>
+		/// Looks up a parameter from the fixed vocabulary.
+		/// </summary>
+		bool TryGet(MeasurementProtocol::Parameter key, const wchar_t*& value, size_t& valueLength) const;
+
+		/// <summary>
+		/// Looks up a parameter by wire name.
+		/// </summary>
+		bool TryGet(const wchar_t* key, size_t keyLength, const wchar_t*& value, size_t& valueLength) const;
+
+		size_t Count() const;
+
+		/// <summary>
+		/// Gets the number of bytes held by the record, including its own footprint.
+		/// </summary>
+		size_t ByteSize() const;
+
+		/// <summary>
+		/// Calls action(key, keyLength, value, valueLength) for each parameter, in the order they were first set.
+		/// </summary>
+		template <typename Action>
+		void ForEach(Action action) const
+		{
+			for (auto it = fields.begin(); it != fields.end(); ++it)
+			{
+				const wchar_t* key = it->Key == MeasurementProtocol::Parameter::Unknown ? arena.data() + it->KeyOffset : MeasurementProtocol::GetName(it->Key);
+				size_t keyLength = it->Key == MeasurementProtocol::Parameter::Unknown ? it->KeyLength : MeasurementProtocol::GetNameLength(it->Key);
+				action(key, keyLength, arena.data() + it->ValueOffset, (size_t)it->ValueLength);
+			}
+		}
+	};
+}
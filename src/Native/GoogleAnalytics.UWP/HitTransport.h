@@ -0,0 +1,72 @@
+//
+// HitTransport.h
+// Declaration of the IHitTransport interface.
+//
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// What came back for a request sent through <see cref="IHitTransport"/>.
+	/// </summary>
+	struct HitResponse
+	{
+		typedef std::function<void(const std::wstring& body)> BodyHandler;
+
+		/// <summary>
+		/// The HTTP status code, or 0 when no response came back; Error then says why.
+		/// </summary>
+		int StatusCode;
+
+		std::wstring Error;
+
+		/// <summary>
+		/// Reads the body and passes it to the handler, on any thread. Empty when there is no body to read.
+		/// </summary>
+		/// <remarks>Reading is left to the caller so bodies nobody asks for are never read.</remarks>
+		std::function<void(BodyHandler handler)> ReadBody;
+
+		HitResponse() : StatusCode(0) { }
+
+		bool IsReceived() const
+		{
+			return StatusCode != 0;
+		}
+
+		bool IsSuccessStatusCode() const
+		{
+			return StatusCode >= 200 && StatusCode <= 299;
+		}
+	};
+
+	/// <summary>
+	/// Sends encoded payloads to a Google Analytics collection endpoint.
+	/// </summary>
+	/// <remarks>
+	/// <see cref="AnalyticsManager"/> only talks to the network through this interface, so a loopback stand-in can replace the collector.
+	/// The interface only uses standard types, so stand-ins can be written and driven without the Windows Runtime.
+	/// Each request calls completed exactly once, on any thread, including when it fails.
+	/// </remarks>
+	class IHitTransport
+	{
+	public:
+
+		typedef std::function<void(const HitResponse& response)> ResponseHandler;
+
+		virtual ~IHitTransport() { }
+
+		/// <summary>
+		/// Posts the UTF-8 payload as the body of a request to the given end point. contentEncoding names the encoding the body was compressed with, or is empty.
+		/// </summary>
+		virtual void Post(const std::wstring& endPoint, const std::string& content, const std::string& contentEncoding, ResponseHandler completed) = 0;
+
+		/// <summary>
+		/// Issues a GET request for the given URI, which already carries the payload in its query string.
+		/// </summary>
+		virtual void Get(const std::wstring& uri, ResponseHandler completed) = 0;
+	};
+}
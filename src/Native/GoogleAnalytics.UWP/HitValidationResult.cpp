@@ -0,0 +1,47 @@
+//
+// HitValidationResult.cpp
+// Implementation of the HitValidationResult and HitValidationMessage classes.
+//
+
+#include "pch.h"
+#include <collection.h>
+#include "HitValidationResult.h"
+#include "DebugResponseParser.h"
+
+using namespace GoogleAnalytics;
+using namespace Platform;
+using namespace Platform::Collections;
+using namespace Windows::Foundation::Collections;
+
+HitValidationMessage::HitValidationMessage(const ValidationMessage& message)
+	: type((HitValidationMessageType)message.Type)
+	, code(ref new String(message.Code.c_str(), (unsigned int)message.Code.size()))
+	, parameter(ref new String(message.Parameter.c_str(), (unsigned int)message.Parameter.size()))
+	, description(ref new String(message.Description.c_str(), (unsigned int)message.Description.size()))
+{ }
+
+HitValidationResult::HitValidationResult(const ValidationResult& result)
+	: isValid(result.IsValid)
+{
+	auto list = ref new Vector<HitValidationMessage^>();
+	for (auto it = begin(result.Messages); it != end(result.Messages); ++it)
+	{
+		list->Append(ref new HitValidationMessage(*it));
+	}
+	messages = list->GetView();
+}
+
+IVectorView<HitValidationResult^>^ HitValidationResult::ParseDebugResponse(String^ response)
+{
+	std::vector<ValidationResult> results;
+	if (!response || !DebugResponseParser::Parse(response->Data(), response->Length(), results))
+	{
+		throw ref new InvalidArgumentException("response");
+	}
+	auto list = ref new Vector<HitValidationResult^>();
+	for (auto it = begin(results); it != end(results); ++it)
+	{
+		list->Append(ref new HitValidationResult(*it));
+	}
+	return list->GetView();
+}
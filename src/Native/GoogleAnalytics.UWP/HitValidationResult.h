@@ -0,0 +1,125 @@
+//
+// HitValidationResult.h
+// Declaration of the HitValidationResult and HitValidationMessage classes.
+//
+
+#pragma once
+
+#include "HitValidator.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Specifies how serious a <see cref="HitValidationMessage"/> is.
+	/// </summary>
+	public enum class HitValidationMessageType
+	{
+		/// <summary>
+		/// The hit would be rejected.
+		/// </summary>
+		Error,
+
+		Warning,
+
+		Info
+	};
+
+	/// <summary>
+	/// Describes a problem found with a <see cref="Hit"/>.
+	/// </summary>
+	public ref class HitValidationMessage sealed
+	{
+	private:
+
+		HitValidationMessageType type;
+		Platform::String^ code;
+		Platform::String^ parameter;
+		Platform::String^ description;
+
+	internal:
+
+		HitValidationMessage(const GoogleAnalytics::ValidationMessage& message);
+
+	public:
+
+		property HitValidationMessageType Type
+		{
+			HitValidationMessageType get()
+			{
+				return type;
+			}
+		}
+
+		/// <summary>
+		/// Gets the code of the problem, as reported by the /debug/collect end point, e.g. VALUE_REQUIRED.
+		/// </summary>
+		property Platform::String^ Code
+		{
+			Platform::String^ get()
+			{
+				return code;
+			}
+		}
+
+		/// <summary>
+		/// Gets the name of the parameter at fault.
+		/// </summary>
+		property Platform::String^ Parameter
+		{
+			Platform::String^ get()
+			{
+				return parameter;
+			}
+		}
+
+		property Platform::String^ Description
+		{
+			Platform::String^ get()
+			{
+				return description;
+			}
+		}
+	};
+
+	/// <summary>
+	/// The outcome of checking a <see cref="Hit"/> against the Measurement Protocol rules, see <see cref="AnalyticsManager::ValidateHit"/>.
+	/// </summary>
+	public ref class HitValidationResult sealed
+	{
+	private:
+
+		bool isValid;
+		Windows::Foundation::Collections::IVectorView<HitValidationMessage^>^ messages;
+
+	internal:
+
+		HitValidationResult(const GoogleAnalytics::ValidationResult& result);
+
+	public:
+
+		/// <summary>
+		/// Gets whether the hit would be accepted.
+		/// </summary>
+		property bool IsValid
+		{
+			bool get()
+			{
+				return isValid;
+			}
+		}
+
+		property Windows::Foundation::Collections::IVectorView<HitValidationMessage^>^ Messages
+		{
+			Windows::Foundation::Collections::IVectorView<HitValidationMessage^>^ get()
+			{
+				return messages;
+			}
+		}
+
+		/// <summary>
+		/// Reads the response of the /debug/collect end point, as found in <see cref="HitSentEventArgs::Response"/> when <see cref="AnalyticsManager::IsDebug"/> is set, into one result per hit.
+		/// </summary>
+		/// <remarks>Lets the results of <see cref="AnalyticsManager::ValidateHit"/> be compared with those of the service.</remarks>
+		static Windows::Foundation::Collections::IVectorView<HitValidationResult^>^ ParseDebugResponse(Platform::String^ response);
+	};
+}
@@ -0,0 +1,258 @@
+//
+// HitValidator.cpp
+// Implementation of the HitValidator class.
+//
+
+#include "pch.h"
+#include <cwchar>
+#include "HitValidator.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	struct Name
+	{
+		const wchar_t* Text;
+		size_t Length;
+	};
+
+	const Name HitTypes[] = { { L"pageview", 8 }, { L"screenview", 10 }, { L"event", 5 }, { L"transaction", 11 }, { L"item", 4 }, { L"social", 6 }, { L"exception", 9 }, { L"timing", 6 } };
+
+	const Name ProductActions[] = { { L"detail", 6 }, { L"click", 5 }, { L"add", 3 }, { L"remove", 6 }, { L"checkout", 8 }, { L"checkout_option", 15 }, { L"purchase", 8 }, { L"refund", 6 } };
+
+	const Name PromotionActions[] = { { L"view", 4 }, { L"click", 5 } };
+
+	const Name SessionControls[] = { { L"start", 5 }, { L"end", 3 } };
+
+	// the parameters each hit type needs on top of v, tid, cid (or uid) and t, in the order of HitTypes
+	const Name RequiredParameters[][3] =
+	{
+		{ },
+		{ { L"cd", 2 } },
+		{ { L"ec", 2 }, { L"ea", 2 } },
+		{ { L"ti", 2 } },
+		{ { L"ti", 2 }, { L"in", 2 } },
+		{ { L"sn", 2 }, { L"sa", 2 }, { L"st", 2 } },
+		{ },
+		{ { L"utc", 3 }, { L"utv", 3 }, { L"utt", 3 } },
+	};
+
+	template <size_t N>
+	int IndexOf(const Name (&names)[N], const wchar_t* value, size_t length)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			if (names[i].Length == length && wmemcmp(names[i].Text, value, length) == 0)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	bool IsDigit(wchar_t c)
+	{
+		return c >= L'0' && c <= L'9';
+	}
+
+	bool IsInteger(const wchar_t* value, size_t length)
+	{
+		size_t i = length > 0 && value[0] == L'-' ? 1 : 0;
+		// 18 digits always fit in 64 bits
+		if (i == length || length - i > 18) return false;
+		for (; i < length; i++)
+		{
+			if (!IsDigit(value[i])) return false;
+		}
+		return true;
+	}
+
+	bool IsCurrency(const wchar_t* value, size_t length)
+	{
+		size_t i = length > 0 && (value[0] == L'-' || value[0] == L'+') ? 1 : 0;
+		size_t digits = 0;
+		while (i < length && IsDigit(value[i]))
+		{
+			i++;
+			digits++;
+		}
+		if (i < length && value[i] == L'.')
+		{
+			i++;
+			size_t decimals = 0;
+			while (i < length && IsDigit(value[i]))
+			{
+				i++;
+				decimals++;
+			}
+			if (decimals > 6) return false;
+			digits += decimals;
+		}
+		return digits > 0 && i == length;
+	}
+
+	bool IsCurrencyCode(const wchar_t* value, size_t length)
+	{
+		if (length != 3) return false;
+		for (size_t i = 0; i < length; i++)
+		{
+			if (value[i] < L'A' || value[i] > L'Z') return false;
+		}
+		return true;
+	}
+
+	// UA-<account>-<property>
+	bool IsTrackingId(const wchar_t* value, size_t length)
+	{
+		if (length < 6 || wmemcmp(value, L"UA-", 3) != 0) return false;
+		size_t i = 3;
+		size_t account = 0;
+		while (i < length && IsDigit(value[i]))
+		{
+			i++;
+			account++;
+		}
+		if (account == 0 || i == length || value[i++] != L'-') return false;
+		size_t property = 0;
+		while (i < length && IsDigit(value[i]))
+		{
+			i++;
+			property++;
+		}
+		return property > 0 && i == length;
+	}
+
+	void Add(ValidationResult& result, ValidationMessageType type, const wchar_t* code, const wchar_t* key, size_t keyLength, const wchar_t* problem)
+	{
+		ValidationMessage message;
+		message.Type = type;
+		message.Code = code;
+		message.Parameter.assign(key, keyLength);
+		message.Description = L"The value provided for parameter '" + message.Parameter + L"' " + problem;
+		result.Messages.push_back(std::move(message));
+		if (type == ValidationMessageType::Error)
+		{
+			result.IsValid = false;
+		}
+	}
+
+	void AddRequired(ValidationResult& result, const wchar_t* key, size_t keyLength)
+	{
+		ValidationMessage message;
+		message.Type = ValidationMessageType::Error;
+		message.Code = L"VALUE_REQUIRED";
+		message.Parameter.assign(key, keyLength);
+		message.Description = L"A value is required for parameter '" + message.Parameter + L"'.";
+		result.Messages.push_back(std::move(message));
+		result.IsValid = false;
+	}
+}
+
+ValidationResult HitValidator::Validate(const HitRecord& record)
+{
+	ValidationResult result;
+	result.IsValid = true;
+
+	record.ForEach([&result](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+		KeyId id = ParseKey(key, keyLength);
+		if (id == UnknownKey) return;
+
+		if (!IsValid(id))
+		{
+			Add(result, ValidationMessageType::Error, L"VALUE_OUT_OF_BOUNDS", key, keyLength, L"uses an index that is out of range.");
+			return;
+		}
+
+		size_t maxLength = GetMaxValueLength(id);
+		if (maxLength != 0 && valueLength > maxLength)
+		{
+			Add(result, ValidationMessageType::Error, L"VALUE_OUT_OF_BOUNDS", key, keyLength, L"is longer than allowed.");
+		}
+
+		bool isValid = true;
+		switch (GetValueType(id))
+		{
+		case ValueType::Integer:
+			isValid = IsInteger(value, valueLength);
+			break;
+		case ValueType::Currency:
+			isValid = IsCurrency(value, valueLength);
+			break;
+		case ValueType::Boolean:
+			isValid = valueLength == 1 && (value[0] == L'0' || value[0] == L'1');
+			break;
+		default:
+			break;
+		}
+		if (!IsIndexed(id))
+		{
+			switch ((Parameter)id)
+			{
+			case Parameter::ProtocolVersion:
+				isValid = valueLength == 1 && value[0] == L'1';
+				break;
+			case Parameter::TrackingId:
+				isValid = IsTrackingId(value, valueLength);
+				break;
+			case Parameter::HitType:
+				isValid = IndexOf(HitTypes, value, valueLength) >= 0;
+				break;
+			case Parameter::ProductAction:
+				isValid = IndexOf(ProductActions, value, valueLength) >= 0;
+				break;
+			case Parameter::PromotionAction:
+				isValid = IndexOf(PromotionActions, value, valueLength) >= 0;
+				break;
+			case Parameter::SessionControl:
+				isValid = IndexOf(SessionControls, value, valueLength) >= 0;
+				break;
+			case Parameter::CurrencyCode:
+				isValid = IsCurrencyCode(value, valueLength);
+				break;
+			case Parameter::EventValue:
+				isValid = isValid && value[0] != L'-';
+				break;
+			default:
+				break;
+			}
+		}
+		if (!isValid)
+		{
+			Add(result, ValidationMessageType::Error, L"VALUE_INVALID", key, keyLength, L"is invalid.");
+		}
+	});
+
+	const wchar_t* value;
+	size_t valueLength;
+	const Parameter required[] = { Parameter::ProtocolVersion, Parameter::TrackingId, Parameter::HitType };
+	for (size_t i = 0; i < sizeof(required) / sizeof(required[0]); i++)
+	{
+		if (!record.TryGet(required[i], value, valueLength) || valueLength == 0)
+		{
+			AddRequired(result, GetName(required[i]), GetNameLength(required[i]));
+		}
+	}
+	if ((!record.TryGet(Parameter::ClientId, value, valueLength) || valueLength == 0) && (!record.TryGet(Parameter::UserId, value, valueLength) || valueLength == 0))
+	{
+		AddRequired(result, L"cid", 3);
+	}
+
+	if (record.TryGet(Parameter::HitType, value, valueLength))
+	{
+		int hitType = IndexOf(HitTypes, value, valueLength);
+		if (hitType >= 0)
+		{
+			const Name (&parameters)[3] = RequiredParameters[hitType];
+			for (size_t i = 0; i < 3 && parameters[i].Text; i++)
+			{
+				if (!record.TryGet(parameters[i].Text, parameters[i].Length, value, valueLength) || valueLength == 0)
+				{
+					AddRequired(result, parameters[i].Text, parameters[i].Length);
+				}
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,66 @@
+//
+// HitValidator.h
+// Declaration of the HitValidator class.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "HitRecord.h"
+
+namespace GoogleAnalytics
+{
+	enum class ValidationMessageType
+	{
+		Error,
+		Warning,
+		Info
+	};
+
+	/// <summary>
+	/// A problem found with a hit, in the terms the /debug/collect end point uses, so local and remote results can be compared.
+	/// </summary>
+	struct ValidationMessage
+	{
+		ValidationMessageType Type;
+
+		/// <summary>
+		/// VALUE_REQUIRED, VALUE_INVALID or VALUE_OUT_OF_BOUNDS.
+		/// </summary>
+		std::wstring Code;
+
+		/// <summary>
+		/// The wire name of the parameter at fault.
+		/// </summary>
+		std::wstring Parameter;
+
+		std::wstring Description;
+	};
+
+	struct ValidationResult
+	{
+		/// <summary>
+		/// Whether the hit would be accepted, i.e. none of the messages is an error.
+		/// </summary>
+		bool IsValid;
+
+		std::vector<ValidationMessage> Messages;
+	};
+
+	/// <summary>
+	/// Checks hits against the Measurement Protocol rules without a round trip to the /debug/collect end point.
+	/// </summary>
+	/// <remarks>
+	/// The rules come from the parameter table in <see cref="MeasurementProtocol"/> (value types, maximum lengths and index ranges), plus the
+	/// required parameters of each hit type and the values enumerated by the reference (hit types, product and promotion actions, session
+	/// control, ISO 4217 currency codes). Parameters outside of the vocabulary are passed over, as the service ignores them.
+	/// Checking a valid hit does not allocate.
+	/// </remarks>
+	class HitValidator
+	{
+	public:
+
+		static ValidationResult Validate(const GoogleAnalytics::HitRecord& record);
+	};
+}
@@ -0,0 +1,59 @@
+//
+// HitsCompletedEventArgs.cpp
+// Implementation of the ResponseBody and HitResult classes.
+//
+
+#include "pch.h"
+#include "HitsCompletedEventArgs.h"
+
+using namespace GoogleAnalytics;
+using namespace Platform;
+using namespace Windows::Foundation;
+using namespace concurrency;
+
+ResponseBody::ResponseBody(std::function<void(HitResponse::BodyHandler)> read)
+	: read(read)
+	, isRead(false)
+{ }
+
+task<String^> ResponseBody::ReadAsync()
+{
+	bool isFirst;
+	{
+		std::lock_guard<std::mutex> lg(lock);
+		isFirst = !isRead;
+		isRead = true;
+	}
+	if (isFirst)
+	{
+		auto body = this->body;
+		if (read)
+		{
+			read([body](const std::wstring& text) {
+				body.set(ref new String(text.c_str(), (unsigned int)text.size()));
+			});
+		}
+		else
+		{
+			body.set(nullptr);
+		}
+	}
+	return create_task(body);
+}
+
+HitResult::HitResult(GoogleAnalytics::Hit^ hit, HitStatus status, int httpStatusCode, String^ error, HitDropReason dropReason, std::shared_ptr<ResponseBody> responseBody)
+	: hit(hit)
+	, status(status)
+	, httpStatusCode(httpStatusCode)
+	, error(error)
+	, dropReason(dropReason)
+	, responseBody(responseBody)
+{ }
+
+IAsyncOperation<String^>^ HitResult::ReadResponseAsync()
+{
+	auto responseBody = this->responseBody;
+	return create_async([responseBody]() {
+		return responseBody ? responseBody->ReadAsync() : task_from_result<String^>(nullptr);
+	});
+}
@@ -0,0 +1,201 @@
+//
+// HitsCompletedEventArgs.h
+// Declaration of the HitsCompletedEventArgs and HitResult classes.
+//
+
+#pragma once
+
+#include <ppltasks.h>
+#include <memory>
+#include <mutex>
+#include "Hit.h"
+#include "HitTransport.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Specifies why a <see cref="Hit"/> was discarded without being sent.
+	/// </summary>
+	public enum class HitDropReason
+	{
+		/// <summary>
+		/// The hit was not dropped. The <see cref="HitResult::DropReason"/> of hits that were sent, rejected or failed.
+		/// </summary>
+		None,
+
+		/// <summary>
+		/// The ingestion queue was full. See <see cref="AnalyticsManager::OverflowPolicy"/>.
+		/// </summary>
+		QueueOverflow,
+
+		/// <summary>
+		/// The queued hits took more memory than <see cref="AnalyticsManager::QueueMemoryLimit"/>. See <see cref="AnalyticsManager::EvictionPolicy"/>.
+		/// </summary>
+		MemoryLimit,
+
+		/// <summary>
+		/// More hits were queued while offline than <see cref="AnalyticsManager::OfflineQueueLimit"/>.
+		/// </summary>
+		OfflineLimit,
+
+		/// <summary>
+		/// The hit was queued for so long that Google Analytics would no longer accept it.
+		/// </summary>
+		Expired,
+
+		/// <summary>
+		/// The encoded hit was over the 8192 byte payload limit of Google Analytics, and <see cref="AnalyticsManager::PayloadPolicy"/> is <see cref="OversizedPayloadPolicy::Reject"/>.
+		/// </summary>
+		PayloadTooLarge
+	};
+
+	/// <summary>
+	/// Reads the body of a response once, the first time it is asked for, and shares it between the hits the response was for.
+	/// </summary>
+	class ResponseBody
+	{
+	private:
+
+		std::mutex lock;
+
+		std::function<void(HitResponse::BodyHandler)> read;
+
+		concurrency::task_completion_event<Platform::String^> body;
+
+		bool isRead;
+
+	public:
+
+		ResponseBody(std::function<void(HitResponse::BodyHandler)> read);
+
+		concurrency::task<Platform::String^> ReadAsync();
+	};
+
+	/// <summary>
+	/// Specifies how a <see cref="Hit"/> came out of a dispatch.
+	/// </summary>
+	public enum class HitStatus
+	{
+		/// <summary>
+		/// Google Analytics accepted the hit.
+		/// </summary>
+		Sent,
+
+		/// <summary>
+		/// Google Analytics rejected the hit.
+		/// </summary>
+		Malformed,
+
+		/// <summary>
+		/// The request failed. The hit is queued again, unless it has expired.
+		/// </summary>
+		Failed,
+
+		/// <summary>
+		/// The hit was discarded without being sent. See <see cref="HitResult::DropReason"/>.
+		/// </summary>
+		Dropped
+	};
+
+	/// <summary>
+	/// The outcome of a single <see cref="Hit"/>, as reported by <see cref="AnalyticsManager::HitsCompleted"/>.
+	/// </summary>
+	public ref class HitResult sealed
+	{
+	private:
+
+		GoogleAnalytics::Hit^ hit;
+		HitStatus status;
+		int httpStatusCode;
+		Platform::String^ error;
+		HitDropReason dropReason;
+		std::shared_ptr<ResponseBody> responseBody;
+
+	internal:
+
+		HitResult(GoogleAnalytics::Hit^ hit, HitStatus status, int httpStatusCode, Platform::String^ error, HitDropReason dropReason, std::shared_ptr<ResponseBody> responseBody);
+
+	public:
+
+		property GoogleAnalytics::Hit^ Hit
+		{
+			GoogleAnalytics::Hit^ get()
+			{
+				return hit;
+			}
+		}
+
+		property HitStatus Status
+		{
+			HitStatus get()
+			{
+				return status;
+			}
+		}
+
+		/// <summary>
+		/// Gets the HTTP status code of the response, or zero when there was none.
+		/// </summary>
+		property int HttpStatusCode
+		{
+			int get()
+			{
+				return httpStatusCode;
+			}
+		}
+
+		/// <summary>
+		/// Gets why the request failed, for <see cref="HitStatus::Failed"/> hits.
+		/// </summary>
+		property Platform::String^ Error
+		{
+			Platform::String^ get()
+			{
+				return error;
+			}
+		}
+
+		/// <summary>
+		/// Gets why the hit was discarded, for <see cref="HitStatus::Dropped"/> hits, or <see cref="HitDropReason::None"/>.
+		/// </summary>
+		property HitDropReason DropReason
+		{
+			HitDropReason get()
+			{
+				return dropReason;
+			}
+		}
+
+		/// <summary>
+		/// Reads the text of the response, or returns null when there was none.
+		/// </summary>
+		/// <remarks>The body is only read when asked for, and once for all the hits that were sent in the same request.</remarks>
+		Windows::Foundation::IAsyncOperation<Platform::String^>^ ReadResponseAsync();
+	};
+
+	/// <summary>
+	/// Supplies the outcome of every <see cref="Hit"/> completed during a dispatch.
+	/// </summary>
+	public ref class HitsCompletedEventArgs sealed
+	{
+	private:
+
+		Windows::Foundation::Collections::IVectorView<HitResult^>^ results;
+
+	internal:
+
+		HitsCompletedEventArgs(Windows::Foundation::Collections::IVectorView<HitResult^>^ results)
+			: results(results)
+		{ }
+
+	public:
+
+		property Windows::Foundation::Collections::IVectorView<HitResult^>^ Results
+		{
+			Windows::Foundation::Collections::IVectorView<HitResult^>^ get()
+			{
+				return results;
+			}
+		}
+	};
+}
@@ -0,0 +1,132 @@
+//
+// HttpClientTransport.cpp
+// Implementation of the HttpClientTransport class.
+//
+
+#include "pch.h"
+#include "HttpClientTransport.h"
+
+using namespace GoogleAnalytics;
+using namespace Platform;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Metadata;
+using namespace Windows::Web::Http;
+using namespace Windows::Web::Http::Filters;
+using namespace Windows::Web::Http::Headers;
+using namespace Windows::Security::Cryptography;
+using namespace concurrency;
+
+HttpClientTransport::HttpClientTransport(String^ userAgent, unsigned int maxConnections, bool useHttp2, std::chrono::steady_clock::duration idleTimeout, std::shared_ptr<DispatchCounters> counters) :
+	userAgent(userAgent),
+	maxConnections(maxConnections),
+	useHttp2(useHttp2 && IsHttp2Supported()),
+	idleTimeout(idleTimeout),
+	counters(counters),
+	httpClient(nullptr)
+{ }
+
+bool HttpClientTransport::IsHttp2Supported()
+{
+	return ApiInformation::IsPropertyPresent("Windows.Web.Http.Filters.HttpBaseProtocolFilter", "MaxVersion");
+}
+
+HttpClient^ HttpClientTransport::AcquireClient()
+{
+	std::lock_guard<std::mutex> lg(clientLock);
+	auto now = std::chrono::steady_clock::now();
+	if (httpClient && now - lastUsed > idleTimeout)
+	{
+		// idle connections have most likely been closed by the server by now; start over rather than trip on them.
+		// requests still in flight hold their own reference to the old client.
+		httpClient = nullptr;
+	}
+	if (!httpClient)
+	{
+		auto filter = ref new HttpBaseProtocolFilter();
+		if (useHttp2)
+		{
+			// one connection carries every request as a separate stream; more would only repeat the handshakes and split the header tables
+			filter->MaxVersion = HttpVersion::Http20;
+			filter->MaxConnectionsPerServer = 1;
+		}
+		else if (maxConnections > 0)
+		{
+			filter->MaxConnectionsPerServer = maxConnections;
+		}
+		httpClient = ref new HttpClient(filter);
+		if (userAgent)
+		{
+			httpClient->DefaultRequestHeaders->UserAgent->ParseAdd(userAgent);
+		}
+		counters->ConnectionsOpened++;
+	}
+	else
+	{
+		counters->ConnectionsReused++;
+	}
+	counters->RequestsSent++;
+	lastUsed = now;
+	return httpClient;
+}
+
+void HttpClientTransport::Post(const std::wstring& endPoint, const std::string& content, const std::string& contentEncoding, ResponseHandler completed)
+{
+	auto httpClient = AcquireClient();
+	auto uri = ref new Uri(ref new String(endPoint.c_str(), (unsigned int)endPoint.size()));
+	auto bytes = ArrayReference<unsigned char>((unsigned char*)content.data(), (unsigned int)content.size());
+	auto httpContent = ref new HttpBufferContent(CryptographicBuffer::CreateFromByteArray(bytes));
+	httpContent->Headers->ContentType = ref new HttpMediaTypeHeaderValue("text/plain");
+	httpContent->Headers->ContentType->CharSet = "UTF-8";
+	if (!contentEncoding.empty())
+	{
+		// content codings are plain ASCII tokens
+		std::wstring coding(begin(contentEncoding), end(contentEncoding));
+		httpContent->Headers->ContentEncoding->Append(ref new HttpContentCodingHeaderValue(ref new String(coding.c_str(), (unsigned int)coding.size())));
+	}
+	Send(create_task([httpClient, uri, httpContent]() { return httpClient->PostAsync(uri, httpContent); }), completed);
+}
+
+void HttpClientTransport::Get(const std::wstring& uri, ResponseHandler completed)
+{
+	auto httpClient = AcquireClient();
+	auto requestUri = ref new Uri(ref new String(uri.c_str(), (unsigned int)uri.size()));
+	Send(create_task([httpClient, requestUri]() { return httpClient->GetAsync(requestUri); }), completed);
+}
+
+void HttpClientTransport::Send(task<HttpResponseMessage^> request, ResponseHandler completed)
+{
+	auto counters = this->counters;
+	request.then([counters, completed](task<HttpResponseMessage^> t) {
+		HitResponse response;
+		try
+		{
+			HttpResponseMessage^ message(t.get());
+			if (message->Version == HttpVersion::Http20)
+			{
+				counters->ResponsesOverHttp2++;
+			}
+			response.StatusCode = (int)message->StatusCode;
+			response.ReadBody = [message](HitResponse::BodyHandler handler) {
+				create_task(message->Content->ReadAsStringAsync()).then([handler](task<String^> body) {
+					std::wstring text;
+					try
+					{
+						auto value = body.get();
+						text.assign(value->Data(), value->Length());
+					}
+					catch (Exception^)
+					{
+						// the hit went through either way; an unreadable body reads as empty
+					}
+					handler(text);
+				});
+			};
+		}
+		catch (Exception^ ex)
+		{
+			response.StatusCode = 0;
+			response.Error.assign(ex->Message->Data(), ex->Message->Length());
+		}
+		completed(response);
+	});
+}
@@ -0,0 +1,64 @@
+//
+// HttpClientTransport.h
+// Declaration of the HttpClientTransport class.
+//
+
+#pragma once
+
+#include <ppltasks.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "HitTransport.h"
+#include "DispatchStatistics.h"
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// <see cref="IHitTransport"/> implemented on top of a long-lived <see cref="Windows::Web::Http::HttpClient"/>.
+	/// </summary>
+	/// <remarks>
+	/// The client keeps its connections alive between requests. It is only recreated once it has been idle for longer than the idle timeout, which lets the pooled connections go.
+	/// With useHttp2, the client negotiates HTTP/2 where the platform supports it and keeps a single connection per server; concurrent requests then
+	/// become streams of that connection, and the headers every request repeats (User-Agent, Content-Type) are HPACK-indexed rather than resent.
+	/// HTTP/2 is only negotiated over TLS; plain HTTP end points stay on HTTP/1.1.
+	/// </remarks>
+	class HttpClientTransport : public IHitTransport
+	{
+	private:
+
+		Platform::String^ userAgent;
+
+		unsigned int maxConnections;
+
+		bool useHttp2;
+
+		std::chrono::steady_clock::duration idleTimeout;
+
+		std::shared_ptr<DispatchCounters> counters;
+
+		std::mutex clientLock;
+
+		Windows::Web::Http::HttpClient^ httpClient;
+
+		std::chrono::steady_clock::time_point lastUsed;
+
+		Windows::Web::Http::HttpClient^ AcquireClient();
+
+		void Send(concurrency::task<Windows::Web::Http::HttpResponseMessage^> request, ResponseHandler completed);
+
+	public:
+
+		HttpClientTransport(Platform::String^ userAgent, unsigned int maxConnections, bool useHttp2, std::chrono::steady_clock::duration idleTimeout, std::shared_ptr<DispatchCounters> counters);
+
+		/// <summary>
+		/// Returns whether the platform HTTP stack can negotiate HTTP/2.
+		/// </summary>
+		static bool IsHttp2Supported();
+
+		virtual void Post(const std::wstring& endPoint, const std::string& content, const std::string& contentEncoding, ResponseHandler completed) override;
+
+		virtual void Get(const std::wstring& uri, ResponseHandler completed) override;
+	};
+}
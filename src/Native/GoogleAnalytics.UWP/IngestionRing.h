@@ -0,0 +1,139 @@
+//
+// IngestionRing.h
+// Declaration of the IngestionRing class.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Bounded queue that hands hits from any number of producing threads to the dispatcher.
+	/// </summary>
+	/// <remarks>
+	/// Each cell carries a sequence number telling producers and the consumer whose turn it is (Dmitry Vyukov's bounded queue). Producers
+	/// are lock-free; with a single consumer, taking an item out is wait-free: a fixed number of steps, with no retry loop. Only one thread
+	/// may take items out at a time, so a producer evicting the oldest item of a full ring must hold the consumer's lock.
+	/// </remarks>
+	template <typename T>
+	class IngestionRing
+	{
+	private:
+
+		struct Cell
+		{
+			std::atomic<size_t> Sequence;
+			T Value;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+
+		size_t mask;
+
+		// keep the producer and consumer cursors on separate cache lines
+		char padding0[64];
+
+		std::atomic<size_t> enqueuePosition;
+
+		char padding1[64];
+
+		std::atomic<size_t> dequeuePosition;
+
+		char padding2[64];
+
+		static size_t RoundUpToPowerOfTwo(size_t value)
+		{
+			size_t result = 2;
+			while (result < value)
+			{
+				result <<= 1;
+			}
+			return result;
+		}
+
+	public:
+
+		explicit IngestionRing(size_t capacity)
+			: cells(new Cell[RoundUpToPowerOfTwo(capacity)])
+			, mask(RoundUpToPowerOfTwo(capacity) - 1)
+			, enqueuePosition(0)
+			, dequeuePosition(0)
+		{
+			for (size_t i = 0; i <= mask; i++)
+			{
+				cells[i].Sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		size_t Capacity() const
+		{
+			return mask + 1;
+		}
+
+		/// <summary>
+		/// Gets the number of items in the ring. Only exact when no other thread is using it.
+		/// </summary>
+		size_t Size() const
+		{
+			size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+			size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+			return enqueued - dequeued;
+		}
+
+		/// <summary>
+		/// Adds an item, or returns false when the ring is full.
+		/// </summary>
+		bool TryPush(const T& value)
+		{
+			size_t position = enqueuePosition.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell& cell = cells[position & mask];
+				size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+				if (difference == 0)
+				{
+					if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.Value = value;
+						cell.Sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Takes the oldest item out, or returns false when the ring is empty or its oldest item is still being written.
+		/// Callers must not take items out concurrently.
+		/// </summary>
+		bool TryPop(T& value)
+		{
+			// only the consumer moves the dequeue position, so it is read and written without a compare-and-swap
+			size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			Cell& cell = cells[position & mask];
+			if (cell.Sequence.load(std::memory_order_acquire) != position + 1)
+			{
+				return false;
+			}
+			dequeuePosition.store(position + 1, std::memory_order_relaxed);
+			value = cell.Value;
+			cell.Value = T();
+			cell.Sequence.store(position + mask + 1, std::memory_order_release);
+			return true;
+		}
+	};
+}
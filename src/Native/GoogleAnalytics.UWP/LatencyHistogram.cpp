@@ -0,0 +1,39 @@
+//
+// LatencyHistogram.cpp
+// Implementation of the LatencyHistogram class.
+//
+
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+using namespace GoogleAnalytics;
+
+LatencyHistogram::LatencyHistogram()
+{
+	for (size_t i = 0; i < BucketCount; i++)
+	{
+		buckets[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void LatencyHistogram::Record(long long nanoseconds)
+{
+	long long microseconds = nanoseconds > 0 ? nanoseconds / 1000 : 0;
+	size_t bucket = 0;
+	while (microseconds != 0 && bucket < BucketCount - 1)
+	{
+		microseconds >>= 1;
+		bucket++;
+	}
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+long long LatencyHistogram::GetCount(size_t bucket) const
+{
+	return bucket < BucketCount ? buckets[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+long long LatencyHistogram::GetUpperBound(size_t bucket)
+{
+	return 1LL << bucket;
+}
@@ -0,0 +1,49 @@
+//
+// LatencyHistogram.h
+// Declaration of the LatencyHistogram class.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Lock-free distribution of durations, kept as counts in power of two buckets.
+	/// </summary>
+	/// <remarks>
+	/// Bucket 0 counts durations under 1 microsecond and bucket i counts durations in [2^(i-1), 2^i) microseconds; the last bucket also takes everything longer.
+	/// Recording is a single relaxed atomic increment, cheap enough for the thread that sends hits.
+	/// </remarks>
+	class LatencyHistogram
+	{
+	public:
+
+		static const size_t BucketCount = 28;
+
+	private:
+
+		std::atomic<long long> buckets[BucketCount];
+
+	public:
+
+		LatencyHistogram();
+
+		/// <summary>
+		/// Adds a duration, in nanoseconds.
+		/// </summary>
+		void Record(long long nanoseconds);
+
+		/// <summary>
+		/// Gets the number of durations recorded in a bucket.
+		/// </summary>
+		long long GetCount(size_t bucket) const;
+
+		/// <summary>
+		/// Gets the exclusive upper bound of a bucket, in microseconds.
+		/// </summary>
+		static long long GetUpperBound(size_t bucket);
+	};
+}
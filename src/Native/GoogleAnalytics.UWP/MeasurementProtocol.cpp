@@ -0,0 +1,317 @@
+//
+// MeasurementProtocol.cpp
+// Implementation of the Measurement Protocol parameter vocabulary.
+//
+
+#include "pch.h"
+#include <cwchar>
+#include "MeasurementProtocol.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	struct ParameterInfo
+	{
+		const wchar_t* Name;
+		size_t Length;
+		unsigned short MaxValueLength;
+		ValueType Type;
+	};
+
+	// in the order of the Parameter enumeration; a zero length means the service sets no limit
+	constexpr ParameterInfo ParameterNames[] =
+	{
+		{ L"v", 1, 0, ValueType::Text },
+		{ L"tid", 3, 0, ValueType::Text },
+		{ L"cid", 3, 0, ValueType::Text },
+		{ L"uid", 3, 0, ValueType::Text },
+		{ L"an", 2, 100, ValueType::Text },
+		{ L"av", 2, 100, ValueType::Text },
+		{ L"aid", 3, 150, ValueType::Text },
+		{ L"aiid", 4, 150, ValueType::Text },
+		{ L"t", 1, 0, ValueType::Text },
+		{ L"cd", 2, 2048, ValueType::Text },
+		{ L"aip", 3, 0, ValueType::Boolean },
+		{ L"sr", 2, 20, ValueType::Text },
+		{ L"vp", 2, 20, ValueType::Text },
+		{ L"ul", 2, 20, ValueType::Text },
+		{ L"sd", 2, 20, ValueType::Text },
+		{ L"dr", 2, 2048, ValueType::Text },
+		{ L"de", 2, 20, ValueType::Text },
+		{ L"uip", 3, 0, ValueType::Text },
+		{ L"ua", 2, 0, ValueType::Text },
+		{ L"dh", 2, 100, ValueType::Text },
+		{ L"dp", 2, 2048, ValueType::Text },
+		{ L"dt", 2, 1500, ValueType::Text },
+		{ L"xid", 3, 40, ValueType::Text },
+		{ L"xvar", 4, 0, ValueType::Text },
+		{ L"geoid", 5, 0, ValueType::Text },
+		{ L"sc", 2, 0, ValueType::Text },
+		{ L"ni", 2, 0, ValueType::Boolean },
+		{ L"qt", 2, 0, ValueType::Integer },
+		{ L"z", 1, 0, ValueType::Text },
+		{ L"ec", 2, 150, ValueType::Text },
+		{ L"ea", 2, 500, ValueType::Text },
+		{ L"el", 2, 500, ValueType::Text },
+		{ L"ev", 2, 0, ValueType::Integer },
+		{ L"exd", 3, 150, ValueType::Text },
+		{ L"exf", 3, 0, ValueType::Boolean },
+		{ L"sn", 2, 50, ValueType::Text },
+		{ L"sa", 2, 50, ValueType::Text },
+		{ L"st", 2, 2048, ValueType::Text },
+		{ L"utc", 3, 150, ValueType::Text },
+		{ L"utv", 3, 500, ValueType::Text },
+		{ L"utt", 3, 0, ValueType::Integer },
+		{ L"utl", 3, 500, ValueType::Text },
+		{ L"pa", 2, 0, ValueType::Text },
+		{ L"ti", 2, 500, ValueType::Text },
+		{ L"ta", 2, 500, ValueType::Text },
+		{ L"tr", 2, 0, ValueType::Currency },
+		{ L"tt", 2, 0, ValueType::Currency },
+		{ L"ts", 2, 0, ValueType::Currency },
+		{ L"tcc", 3, 500, ValueType::Text },
+		{ L"pal", 3, 500, ValueType::Text },
+		{ L"cos", 3, 0, ValueType::Integer },
+		{ L"col", 3, 30, ValueType::Text },
+		{ L"promoa", 6, 0, ValueType::Text },
+		{ L"cu", 2, 10, ValueType::Text },
+		{ L"ds", 2, 0, ValueType::Text },
+		{ L"dl", 2, 2048, ValueType::Text },
+		{ L"cn", 2, 100, ValueType::Text },
+		{ L"cs", 2, 100, ValueType::Text },
+		{ L"cm", 2, 50, ValueType::Text },
+		{ L"ck", 2, 500, ValueType::Text },
+		{ L"cc", 2, 500, ValueType::Text },
+		{ L"ci", 2, 100, ValueType::Text },
+		{ L"gclid", 5, 0, ValueType::Text },
+		{ L"dclid", 5, 0, ValueType::Text },
+		{ L"je", 2, 0, ValueType::Boolean },
+		{ L"fl", 2, 20, ValueType::Text },
+		{ L"linkid", 6, 0, ValueType::Text },
+		{ L"npa", 3, 0, ValueType::Boolean },
+		{ L"in", 2, 500, ValueType::Text },
+		{ L"ip", 2, 0, ValueType::Currency },
+		{ L"iq", 2, 0, ValueType::Integer },
+		{ L"ic", 2, 500, ValueType::Text },
+		{ L"iv", 2, 500, ValueType::Text },
+		{ L"plt", 3, 0, ValueType::Integer },
+		{ L"dns", 3, 0, ValueType::Integer },
+		{ L"pdt", 3, 0, ValueType::Integer },
+		{ L"rrt", 3, 0, ValueType::Integer },
+		{ L"tcp", 3, 0, ValueType::Integer },
+		{ L"srt", 3, 0, ValueType::Integer },
+		{ L"dit", 3, 0, ValueType::Integer },
+		{ L"clt", 3, 0, ValueType::Integer },
+	};
+
+	static_assert(sizeof(ParameterNames) / sizeof(ParameterNames[0]) == ParameterCount, "ParameterNames must cover the Parameter enumeration");
+
+	// the high bit of a key marks indexed families
+	static_assert(ParameterCount <= 0x80, "fixed parameters must fit in the low 7 bits of a key");
+
+	struct IndexedParameterInfo
+	{
+		const wchar_t* Prefix;
+		size_t PrefixLength;
+		const wchar_t* Infix;
+		size_t InfixLength;
+		const wchar_t* Suffix;
+		size_t SuffixLength;
+		unsigned short MaxIndex;
+		unsigned short MaxSubIndex;
+		unsigned short MaxValueLength;
+		ValueType Type;
+	};
+
+	// in the order of the IndexedParameter enumeration
+	constexpr IndexedParameterInfo IndexedParameterNames[] =
+	{
+		{ L"cd", 2, L"", 0, L"", 0, 200, 0, 150, ValueType::Text },
+		{ L"cm", 2, L"", 0, L"", 0, 200, 0, 0, ValueType::Currency },
+		{ L"pr", 2, L"id", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"nm", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"br", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"ca", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"va", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"pr", 2, L"", 0, 200, 0, 0, ValueType::Currency },
+		{ L"pr", 2, L"qt", 2, L"", 0, 200, 0, 0, ValueType::Integer },
+		{ L"pr", 2, L"cc", 2, L"", 0, 200, 0, 500, ValueType::Text },
+		{ L"pr", 2, L"ps", 2, L"", 0, 200, 0, 0, ValueType::Integer },
+		{ L"pr", 2, L"cd", 2, L"", 0, 200, 200, 150, ValueType::Text },
+		{ L"pr", 2, L"cm", 2, L"", 0, 200, 200, 0, ValueType::Currency },
+		{ L"promo", 5, L"id", 2, L"", 0, 200, 0, 0, ValueType::Text },
+		{ L"promo", 5, L"nm", 2, L"", 0, 200, 0, 0, ValueType::Text },
+		{ L"promo", 5, L"cr", 2, L"", 0, 200, 0, 0, ValueType::Text },
+		{ L"promo", 5, L"ps", 2, L"", 0, 200, 0, 0, ValueType::Text },
+		{ L"cg", 2, L"", 0, L"", 0, 5, 0, 100, ValueType::Text },
+		{ L"il", 2, L"nm", 2, L"", 0, 200, 0, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"id", 2, 200, 200, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"nm", 2, 200, 200, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"br", 2, 200, 200, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"ca", 2, 200, 200, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"va", 2, 200, 200, 0, ValueType::Text },
+		{ L"il", 2, L"pi", 2, L"pr", 2, 200, 200, 0, ValueType::Currency },
+		{ L"il", 2, L"pi", 2, L"ps", 2, 200, 200, 0, ValueType::Integer },
+	};
+
+	static_assert(sizeof(IndexedParameterNames) / sizeof(IndexedParameterNames[0]) == IndexedParameterCount, "IndexedParameterNames must cover the IndexedParameter enumeration");
+
+	const IndexedParameterInfo& GetFamily(KeyId key)
+	{
+		return IndexedParameterNames[(key & 0x7F)];
+	}
+
+	size_t FormatIndex(unsigned int index, wchar_t* text)
+	{
+		wchar_t digits[4];
+		size_t count = 0;
+		do
+		{
+			digits[count++] = (wchar_t)(L'0' + index % 10);
+			index /= 10;
+		} while (index != 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			text[i] = digits[count - 1 - i];
+		}
+		return count;
+	}
+
+	// parses a positive index without leading zeros, as the service writes them
+	bool ParseIndex(const wchar_t*& name, const wchar_t* end, unsigned int& index)
+	{
+		if (name == end || *name < L'1' || *name > L'9')
+		{
+			return false;
+		}
+		index = 0;
+		while (name != end && *name >= L'0' && *name <= L'9')
+		{
+			index = index * 10 + (*name - L'0');
+			if (index > MaxEncodedIndex)
+			{
+				return false;
+			}
+			++name;
+		}
+		return true;
+	}
+
+	bool Match(const wchar_t*& name, const wchar_t* end, const wchar_t* text, size_t length)
+	{
+		if ((size_t)(end - name) < length || wmemcmp(name, text, length) != 0)
+		{
+			return false;
+		}
+		name += length;
+		return true;
+	}
+}
+
+const wchar_t* MeasurementProtocol::GetName(Parameter parameter)
+{
+	return ParameterNames[(size_t)parameter].Name;
+}
+
+size_t MeasurementProtocol::GetNameLength(Parameter parameter)
+{
+	return ParameterNames[(size_t)parameter].Length;
+}
+
+Parameter MeasurementProtocol::Find(const wchar_t* name, size_t length)
+{
+	if (length == 0)
+	{
+		return Parameter::Unknown;
+	}
+	for (size_t i = 0; i < ParameterCount; i++)
+	{
+		if (ParameterNames[i].Length == length && ParameterNames[i].Name[0] == name[0] && wmemcmp(ParameterNames[i].Name, name, length) == 0)
+		{
+			return (Parameter)i;
+		}
+	}
+	return Parameter::Unknown;
+}
+
+bool MeasurementProtocol::IsValid(KeyId key)
+{
+	if (key == UnknownKey || !IsIndexed(key))
+	{
+		return key != UnknownKey;
+	}
+	const IndexedParameterInfo& family = GetFamily(key);
+	unsigned int index = (key >> 8) & MaxEncodedIndex;
+	unsigned int subIndex = (key >> 20) & MaxEncodedIndex;
+	return index >= 1 && index <= family.MaxIndex && (family.MaxSubIndex == 0 ? subIndex == 0 : subIndex >= 1 && subIndex <= family.MaxSubIndex);
+}
+
+size_t MeasurementProtocol::GetMaxValueLength(KeyId key)
+{
+	if (key == UnknownKey)
+	{
+		return 0;
+	}
+	return IsIndexed(key) ? GetFamily(key).MaxValueLength : ParameterNames[key & 0xFF].MaxValueLength;
+}
+
+ValueType MeasurementProtocol::GetValueType(KeyId key)
+{
+	if (key == UnknownKey)
+	{
+		return ValueType::Text;
+	}
+	return IsIndexed(key) ? GetFamily(key).Type : ParameterNames[key & 0xFF].Type;
+}
+
+size_t MeasurementProtocol::FormatKey(KeyId key, wchar_t* name)
+{
+	if (!IsIndexed(key))
+	{
+		const ParameterInfo& parameter = ParameterNames[key & 0xFF];
+		wmemcpy(name, parameter.Name, parameter.Length);
+		return parameter.Length;
+	}
+	const IndexedParameterInfo& family = GetFamily(key);
+	size_t length = 0;
+	wmemcpy(name, family.Prefix, family.PrefixLength);
+	length += family.PrefixLength;
+	length += FormatIndex((key >> 8) & MaxEncodedIndex, name + length);
+	wmemcpy(name + length, family.Infix, family.InfixLength);
+	length += family.InfixLength;
+	if (family.MaxSubIndex != 0)
+	{
+		length += FormatIndex((key >> 20) & MaxEncodedIndex, name + length);
+		wmemcpy(name + length, family.Suffix, family.SuffixLength);
+		length += family.SuffixLength;
+	}
+	return length;
+}
+
+KeyId MeasurementProtocol::ParseKey(const wchar_t* name, size_t length)
+{
+	Parameter parameter = Find(name, length);
+	if (parameter != Parameter::Unknown)
+	{
+		return MakeKey(parameter);
+	}
+	const wchar_t* end = name + length;
+	for (size_t i = 0; i < IndexedParameterCount; i++)
+	{
+		const IndexedParameterInfo& family = IndexedParameterNames[i];
+		const wchar_t* position = name;
+		unsigned int index = 0;
+		unsigned int subIndex = 0;
+		if (Match(position, end, family.Prefix, family.PrefixLength)
+			&& ParseIndex(position, end, index)
+			&& Match(position, end, family.Infix, family.InfixLength)
+			&& (family.MaxSubIndex == 0 || (ParseIndex(position, end, subIndex) && Match(position, end, family.Suffix, family.SuffixLength)))
+			&& position == end)
+		{
+			return MakeKey((IndexedParameter)i, index, subIndex);
+		}
+	}
+	return UnknownKey;
+}
@@ -0,0 +1,256 @@
+//
+// MeasurementProtocol.h
+// Declaration of the Measurement Protocol parameter vocabulary.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace GoogleAnalytics
+{
+	namespace MeasurementProtocol
+	{
+		/// <summary>
+		/// The fixed (non indexed) Measurement Protocol parameters.
+		/// </summary>
+		/// <remarks>See https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters </remarks>
+		enum class Parameter : unsigned char
+		{
+			ProtocolVersion,
+			TrackingId,
+			ClientId,
+			UserId,
+			ApplicationName,
+			ApplicationVersion,
+			ApplicationId,
+			ApplicationInstallerId,
+			HitType,
+			ScreenName,
+			AnonymizeIp,
+			ScreenResolution,
+			ViewportSize,
+			UserLanguage,
+			ScreenColors,
+			DocumentReferrer,
+			DocumentEncoding,
+			IpOverride,
+			UserAgentOverride,
+			DocumentHostName,
+			DocumentPath,
+			DocumentTitle,
+			ExperimentId,
+			ExperimentVariant,
+			GeographicalOverride,
+			SessionControl,
+			NonInteraction,
+			QueueTime,
+			CacheBuster,
+			EventCategory,
+			EventAction,
+			EventLabel,
+			EventValue,
+			ExceptionDescription,
+			ExceptionFatal,
+			SocialNetwork,
+			SocialAction,
+			SocialTarget,
+			TimingCategory,
+			TimingVariable,
+			TimingTime,
+			TimingLabel,
+			ProductAction,
+			TransactionId,
+			TransactionAffiliation,
+			TransactionRevenue,
+			TransactionTax,
+			TransactionShipping,
+			TransactionCoupon,
+			ProductActionList,
+			CheckoutStep,
+			CheckoutStepOption,
+			PromotionAction,
+			CurrencyCode,
+			DataSource,
+			DocumentLocation,
+			CampaignName,
+			CampaignSource,
+			CampaignMedium,
+			CampaignKeyword,
+			CampaignContent,
+			CampaignId,
+			GoogleAdsId,
+			DisplayAdsId,
+			JavaEnabled,
+			FlashVersion,
+			LinkId,
+			DisableAdvertisingPersonalization,
+			ItemName,
+			ItemPrice,
+			ItemQuantity,
+			ItemCode,
+			ItemCategory,
+			PageLoadTime,
+			DnsTime,
+			PageDownloadTime,
+			RedirectResponseTime,
+			TcpConnectTime,
+			ServerResponseTime,
+			DomInteractiveTime,
+			ContentLoadTime,
+
+			Count,
+
+			/// <summary>
+			/// Any parameter outside of the fixed vocabulary, such as indexed or custom ones.
+			/// </summary>
+			Unknown = 0xFF
+		};
+
+		const size_t ParameterCount = (size_t)Parameter::Count;
+
+		/// <summary>
+		/// Families of indexed Measurement Protocol parameters. Names are built as prefix, index, infix and, for two level families, a second index and
+		/// a suffix (pr&lt;i&gt;cd&lt;j&gt;, il&lt;i&gt;pi&lt;j&gt;id).
+		/// </summary>
+		/// <remarks>
+		/// Keys hold two indexes at most, so the three level product impression dimensions and metrics (il&lt;i&gt;pi&lt;j&gt;cd&lt;k&gt;, il&lt;i&gt;pi&lt;j&gt;cm&lt;k&gt;)
+		/// are left out and handled like any parameter outside of the vocabulary.
+		/// </remarks>
+		enum class IndexedParameter : unsigned char
+		{
+			CustomDimension,
+			CustomMetric,
+			ProductSku,
+			ProductName,
+			ProductBrand,
+			ProductCategory,
+			ProductVariant,
+			ProductPrice,
+			ProductQuantity,
+			ProductCouponCode,
+			ProductPosition,
+			ProductCustomDimension,
+			ProductCustomMetric,
+			PromotionId,
+			PromotionName,
+			PromotionCreative,
+			PromotionPosition,
+			ContentGroup,
+			ImpressionListName,
+			ImpressionSku,
+			ImpressionName,
+			ImpressionBrand,
+			ImpressionCategory,
+			ImpressionVariant,
+			ImpressionPrice,
+			ImpressionPosition,
+
+			Count
+		};
+
+		const size_t IndexedParameterCount = (size_t)IndexedParameter::Count;
+
+		/// <summary>
+		/// Identifies a parameter, fixed or indexed, without spelling out its name.
+		/// </summary>
+		/// <remarks>The low byte holds the parameter (fixed parameters as is, indexed families from 0x80), followed by 12 bits for the index and 12 bits for the second index.</remarks>
+		typedef unsigned int KeyId;
+
+		/// <summary>
+		/// The key of anything outside of the vocabulary.
+		/// </summary>
+		const KeyId UnknownKey = 0xFFFFFFFF;
+
+		const unsigned int MaxEncodedIndex = 0xFFF;
+
+		constexpr KeyId MakeKey(Parameter parameter)
+		{
+			return (KeyId)parameter;
+		}
+
+		/// <summary>
+		/// Makes the key of an indexed parameter. Indexes beyond what a key can hold are clamped, which leaves them out of range for <see cref="IsValid"/>.
+		/// </summary>
+		constexpr KeyId MakeKey(IndexedParameter family, unsigned int index, unsigned int subIndex = 0)
+		{
+			return (0x80u + (KeyId)family)
+				| ((index > MaxEncodedIndex ? MaxEncodedIndex : index) << 8)
+				| ((subIndex > MaxEncodedIndex ? MaxEncodedIndex : subIndex) << 20);
+		}
+
+		constexpr bool IsIndexed(KeyId key)
+		{
+			return key != UnknownKey && (key & 0x80) != 0;
+		}
+
+		/// <summary>
+		/// Returns whether an indexed key uses indexes within the range the service accepts. Fixed keys are always valid.
+		/// </summary>
+		bool IsValid(KeyId key);
+
+		/// <summary>
+		/// Gets the maximum length of a value for the given key, or zero when the service does not limit it.
+		/// </summary>
+		/// <remarks>The reference expresses limits in bytes; they are applied to characters here, which is exact for the ASCII values most parameters hold.</remarks>
+		size_t GetMaxValueLength(KeyId key);
+
+		/// <summary>
+		/// The kinds of values the service accepts, as listed in the parameter reference.
+		/// </summary>
+		enum class ValueType : unsigned char
+		{
+			Text,
+
+			/// <summary>
+			/// A 64 bit signed integer.
+			/// </summary>
+			Integer,
+
+			/// <summary>
+			/// A decimal number with up to 6 decimal places, e.g. 12.50.
+			/// </summary>
+			Currency,
+
+			/// <summary>
+			/// 1 or 0.
+			/// </summary>
+			Boolean
+		};
+
+		/// <summary>
+		/// Gets the type of the values of the given key. Keys outside of the vocabulary are text.
+		/// </summary>
+		ValueType GetValueType(KeyId key);
+
+		/// <summary>
+		/// The longest name a key formats to, e.g. il4095pi4095id.
+		/// </summary>
+		const size_t MaxKeyLength = 16;
+
+		/// <summary>
+		/// Writes the wire name of a key to name, which must have room for <see cref="MaxKeyLength"/> characters, and returns its length.
+		/// </summary>
+		size_t FormatKey(KeyId key, wchar_t* name);
+
+		/// <summary>
+		/// Resolves a wire name, fixed or indexed, to its key, or <see cref="UnknownKey"/>.
+		/// </summary>
+		KeyId ParseKey(const wchar_t* name, size_t length);
+
+		/// <summary>
+		/// Gets the wire name of a parameter.
+		/// </summary>
+		const wchar_t* GetName(Parameter parameter);
+
+		/// <summary>
+		/// Gets the length of the wire name of a parameter.
+		/// </summary>
+		size_t GetNameLength(Parameter parameter);
+
+		/// <summary>
+		/// Resolves a wire name to a parameter, or <see cref="Parameter::Unknown"/> when it is not part of the fixed vocabulary.
+		/// </summary>
+		Parameter Find(const wchar_t* name, size_t length);
+	}
+}
@@ -0,0 +1,179 @@
+//
+// PayloadEncoder.cpp
+// Implementation of the PayloadEncoder class.
+//
+
+#include "pch.h"
+#include "PayloadEncoder.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const char HexDigits[] = "0123456789ABCDEF";
+
+	bool IsUnreserved(unsigned long c)
+	{
+		return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+	}
+
+	// reads one code point, combining UTF-16 surrogate pairs where wchar_t is 16 bits wide
+	unsigned long NextCodePoint(const wchar_t* value, size_t length, size_t& i)
+	{
+		unsigned long c = (unsigned long)value[i++];
+		if (c >= 0xD800 && c <= 0xDBFF && i < length)
+		{
+			unsigned long low = (unsigned long)value[i];
+			if (low >= 0xDC00 && low <= 0xDFFF)
+			{
+				i++;
+				return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+			}
+		}
+		if (c >= 0xD800 && c <= 0xDFFF)
+		{
+			return 0xFFFD; // lone surrogate
+		}
+		return c;
+	}
+
+	size_t Utf8Length(unsigned long c)
+	{
+		return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+	}
+
+	size_t DigitCount(long long value)
+	{
+		size_t count = value < 0 ? 2 : 1;
+		unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+		while (magnitude >= 10)
+		{
+			magnitude /= 10;
+			count++;
+		}
+		return count;
+	}
+}
+
+PayloadEncoder::PayloadEncoder(std::string& buffer) :
+	buffer(buffer)
+{ }
+
+size_t PayloadEncoder::EncodedLength(const wchar_t* value, size_t length)
+{
+	size_t result = 0;
+	size_t i = 0;
+	while (i < length)
+	{
+		unsigned long c = NextCodePoint(value, length, i);
+		result += IsUnreserved(c) ? 1 : 3 * Utf8Length(c);
+	}
+	return result;
+}
+
+size_t PayloadEncoder::EncodedLength(size_t keyLength, const wchar_t* value, size_t valueLength)
+{
+	return keyLength + 2 + EncodedLength(value, valueLength);
+}
+
+size_t PayloadEncoder::EncodedLength(size_t keyLength, long long value)
+{
+	return keyLength + 2 + DigitCount(value);
+}
+
+size_t PayloadEncoder::TruncatedLength(const wchar_t* value, size_t length, size_t cap)
+{
+	if (length <= cap) return length;
+	if (cap > 0 && value[cap - 1] >= 0xD800 && value[cap - 1] <= 0xDBFF) cap--;
+	return cap;
+}
+
+void PayloadEncoder::Reserve(size_t length)
+{
+	buffer.reserve(buffer.size() + length);
+}
+
+void PayloadEncoder::AppendSeparator()
+{
+	// a newline starts the next hit of a batch payload
+	if (!buffer.empty() && buffer.back() != '\n')
+	{
+		buffer.push_back('&');
+	}
+}
+
+void PayloadEncoder::AppendKey(const wchar_t* key, size_t keyLength)
+{
+	AppendSeparator();
+	for (size_t i = 0; i < keyLength; i++)
+	{
+		buffer.push_back((char)key[i]);
+	}
+	buffer.push_back('=');
+}
+
+void PayloadEncoder::Append(const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength)
+{
+	AppendKey(key, keyLength);
+	size_t i = 0;
+	while (i < valueLength)
+	{
+		unsigned long c = NextCodePoint(value, valueLength, i);
+		if (IsUnreserved(c))
+		{
+			buffer.push_back((char)c);
+			continue;
+		}
+
+		unsigned char bytes[4];
+		size_t count = Utf8Length(c);
+		switch (count)
+		{
+		case 1:
+			bytes[0] = (unsigned char)c;
+			break;
+		case 2:
+			bytes[0] = (unsigned char)(0xC0 | (c >> 6));
+			bytes[1] = (unsigned char)(0x80 | (c & 0x3F));
+			break;
+		case 3:
+			bytes[0] = (unsigned char)(0xE0 | (c >> 12));
+			bytes[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			bytes[2] = (unsigned char)(0x80 | (c & 0x3F));
+			break;
+		default:
+			bytes[0] = (unsigned char)(0xF0 | (c >> 18));
+			bytes[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+			bytes[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+			bytes[3] = (unsigned char)(0x80 | (c & 0x3F));
+			break;
+		}
+		for (size_t b = 0; b < count; b++)
+		{
+			buffer.push_back('%');
+			buffer.push_back(HexDigits[bytes[b] >> 4]);
+			buffer.push_back(HexDigits[bytes[b] & 0x0F]);
+		}
+	}
+}
+
+void PayloadEncoder::Append(const wchar_t* key, size_t keyLength, long long value)
+{
+	AppendKey(key, keyLength);
+	char digits[24];
+	size_t count = 0;
+	unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+	do
+	{
+		digits[count++] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+	if (value < 0)
+	{
+		buffer.push_back('-');
+	}
+	while (count > 0)
+	{
+		buffer.push_back(digits[--count]);
+	}
+}
@@ -0,0 +1,98 @@
+//
+// PayloadEncoder.h
+// Declaration of the PayloadEncoder class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Writes hit parameters as an application/x-www-form-urlencoded UTF-8 payload.
+	/// </summary>
+	/// <remarks>Values are percent-encoded straight into the target buffer; only the RFC 3986 unreserved characters are left as is, which matches Uri::EscapeComponent. Use <see cref="EncodedLength"/> to size the buffer up front so appending never reallocates.</remarks>
+	class PayloadEncoder
+	{
+	private:
+
+		std::string& buffer;
+
+		void AppendSeparator();
+
+		void AppendKey(const wchar_t* key, size_t keyLength);
+
+	public:
+
+		PayloadEncoder(std::string& buffer);
+
+		/// <summary>
+		/// Gets the number of bytes a value occupies once UTF-8 and percent-encoded.
+		/// </summary>
+		static size_t EncodedLength(const wchar_t* value, size_t length);
+
+		/// <summary>
+		/// Gets the number of bytes a key=value pair, including its separator, occupies once encoded.
+		/// </summary>
+		static size_t EncodedLength(size_t keyLength, const wchar_t* value, size_t valueLength);
+
+		/// <summary>
+		/// Gets the number of bytes a key=number pair, including its separator, occupies once encoded.
+		/// </summary>
+		static size_t EncodedLength(size_t keyLength, long long value);
+
+		/// <summary>
+		/// Gets the length of a payload from the sum of the <see cref="EncodedLength"/> of its pairs: the first pair is written without a separator.
+		/// </summary>
+		static size_t PayloadLength(size_t pairsLength)
+		{
+			return pairsLength == 0 ? 0 : pairsLength - 1;
+		}
+
+		/// <summary>
+		/// Gets the length of a value cut to at most cap characters, without splitting a surrogate pair.
+		/// </summary>
+		static size_t TruncatedLength(const wchar_t* value, size_t length, size_t cap);
+
+		/// <summary>
+		/// Finds the largest cap on the length of values with which a payload fits in maxLength bytes, given getLength(cap), the length of the payload with every
+		/// value cut to at most cap characters (see <see cref="TruncatedLength"/>), and the length of its longest value. Returns false when even empty values do not fit.
+		/// </summary>
+		template <typename GetLength>
+		static bool FitValueLength(GetLength getLength, size_t longestValue, size_t maxLength, size_t& cap)
+		{
+			if (getLength(0) > maxLength) return false;
+			// only the longest values are cut, and all to the same length
+			size_t low = 0;
+			size_t high = longestValue;
+			while (low < high)
+			{
+				size_t middle = low + (high - low + 1) / 2;
+				if (getLength(middle) <= maxLength)
+				{
+					low = middle;
+				}
+				else
+				{
+					high = middle - 1;
+				}
+			}
+			cap = low;
+			return true;
+		}
+
+		void Reserve(size_t length);
+
+		/// <summary>
+		/// Appends a key=value pair. Keys are Measurement Protocol parameter names and are written as is.
+		/// </summary>
+		void Append(const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength);
+
+		/// <summary>
+		/// Appends a key=number pair without going through an intermediate string.
+		/// </summary>
+		void Append(const wchar_t* key, size_t keyLength, long long value);
+	};
+}
@@ -0,0 +1,84 @@
+//
+// RetryPolicy.cpp
+// Implementation of the RetryPolicy class.
+//
+
+#include "pch.h"
+#include "RetryPolicy.h"
+
+using namespace GoogleAnalytics;
+
+RetryPolicy::RetryPolicy(Clock::duration baseDelay, Clock::duration maxDelay, unsigned int failureThreshold, Clock::duration breakDuration, Random random) :
+	baseDelay(baseDelay),
+	maxDelay(maxDelay),
+	failureThreshold(failureThreshold > 0 ? failureThreshold : 1),
+	breakDuration(breakDuration),
+	consecutiveFailures(0),
+	state(CircuitState::Closed),
+	engine(std::random_device()()),
+	random(random)
+{ }
+
+RetryPolicy::Clock::duration RetryPolicy::GetBackoff(unsigned int attempt)
+{
+	auto ceiling = baseDelay;
+	for (unsigned int i = 0; i < attempt && ceiling < maxDelay; i++)
+	{
+		ceiling *= 2;
+	}
+	if (ceiling > maxDelay)
+	{
+		ceiling = maxDelay;
+	}
+
+	std::lock_guard<std::mutex> lg(lock);
+	if (random)
+	{
+		double fraction = random();
+		fraction = fraction < 0 ? 0 : fraction > 1 ? 1 : fraction;
+		return Clock::duration((Clock::rep)(ceiling.count() * fraction));
+	}
+	std::uniform_int_distribution<Clock::rep> distribution(0, ceiling.count());
+	return Clock::duration(distribution(engine));
+}
+
+bool RetryPolicy::IsExpired(Clock::duration age) const
+{
+	return age >= std::chrono::hours((int)MaxHitAgeHours);
+}
+
+RetryPolicy::CircuitState RetryPolicy::GetState(Clock::time_point now)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	if (state == CircuitState::Open && now >= openUntil)
+	{
+		state = CircuitState::HalfOpen;
+	}
+	return state;
+}
+
+RetryPolicy::Clock::time_point RetryPolicy::GetOpenUntil()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	return openUntil;
+}
+
+void RetryPolicy::RecordSuccess()
+{
+	std::lock_guard<std::mutex> lg(lock);
+	consecutiveFailures = 0;
+	state = CircuitState::Closed;
+}
+
+bool RetryPolicy::RecordFailure(Clock::time_point now)
+{
+	std::lock_guard<std::mutex> lg(lock);
+	consecutiveFailures++;
+	if (state == CircuitState::HalfOpen || (state == CircuitState::Closed && consecutiveFailures >= failureThreshold))
+	{
+		state = CircuitState::Open;
+		openUntil = now + breakDuration;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,102 @@
+//
+// RetryPolicy.h
+// Declaration of the RetryPolicy class.
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <random>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Decides when a hit that failed to send may be tried again, and pauses dispatching while the service cannot be reached.
+	/// </summary>
+	/// <remarks>
+	/// Retries back off exponentially with full jitter: attempt n waits a random time between zero and min(MaxDelay, BaseDelay * 2^n).
+	/// After FailureThreshold transport failures in a row the circuit opens and nothing is sent for BreakDuration. Once that has elapsed the circuit is half open: a single hit is let through, and its outcome closes or reopens the circuit.
+	/// Time is passed in by the caller, and the source of jitter can be replaced, so the policy can be driven deterministically.
+	/// </remarks>
+	class RetryPolicy
+	{
+	public:
+
+		typedef std::chrono::steady_clock Clock;
+
+		/// <summary>
+		/// Returns a uniformly distributed value between 0 and 1, inclusive.
+		/// </summary>
+		typedef std::function<double()> Random;
+
+		enum class CircuitState
+		{
+			Closed,
+			Open,
+			HalfOpen
+		};
+
+		/// <summary>
+		/// The Measurement Protocol ignores hits that reach it more than 4 hours after they were created.
+		/// </summary>
+		static const int MaxHitAgeHours = 4;
+
+	private:
+
+		std::mutex lock;
+
+		Clock::duration baseDelay;
+
+		Clock::duration maxDelay;
+
+		unsigned int failureThreshold;
+
+		Clock::duration breakDuration;
+
+		unsigned int consecutiveFailures;
+
+		CircuitState state;
+
+		Clock::time_point openUntil;
+
+		std::minstd_rand engine;
+
+		Random random;
+
+	public:
+
+		RetryPolicy(Clock::duration baseDelay = std::chrono::seconds(2), Clock::duration maxDelay = std::chrono::minutes(5), unsigned int failureThreshold = 5, Clock::duration breakDuration = std::chrono::seconds(60), Random random = nullptr);
+
+		/// <summary>
+		/// Returns how long to wait before the given retry attempt (zero based).
+		/// </summary>
+		Clock::duration GetBackoff(unsigned int attempt);
+
+		/// <summary>
+		/// Returns whether a hit of the given age is too old to be worth sending.
+		/// </summary>
+		bool IsExpired(Clock::duration age) const;
+
+		/// <summary>
+		/// Returns the state of the circuit at the given time, moving it from open to half open once the break is over.
+		/// </summary>
+		CircuitState GetState(Clock::time_point now);
+
+		/// <summary>
+		/// Returns the time at which an open circuit lets a hit through again.
+		/// </summary>
+		Clock::time_point GetOpenUntil();
+
+		/// <summary>
+		/// Records that the service answered a request, whatever the status code.
+		/// </summary>
+		void RecordSuccess();
+
+		/// <summary>
+		/// Records a transport failure. Returns true if this failure opened the circuit.
+		/// </summary>
+		bool RecordFailure(Clock::time_point now);
+	};
+}
@@ -0,0 +1,182 @@
+//
+// Sampler.cpp
+// Implementation of the Sampler class.
+//
+
+#include "pch.h"
+#include "Sampler.h"
+#include <cmath>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <vector>
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	struct HitTypeName
+	{
+		const wchar_t* Name;
+		size_t Length;
+	};
+
+	const HitTypeName HitTypeNames[] =
+	{
+		{ L"pageview", 8 },
+		{ L"screenview", 10 },
+		{ L"event", 5 },
+		{ L"transaction", 11 },
+		{ L"item", 4 },
+		{ L"social", 6 },
+		{ L"exception", 9 },
+		{ L"timing", 6 }
+	};
+
+	uint32_t RotateLeft(uint32_t value, int count)
+	{
+		return (value << count) | (value >> (32 - count));
+	}
+}
+
+Sampler::Sampler()
+	: bucket(NoBucket)
+	, sampleRate(100.0F)
+	, hasHitTypeSampleRates(false)
+{
+	for (size_t i = 0; i < HitTypeCount; i++)
+	{
+		hitTypeSampleRates[i].store(std::numeric_limits<float>::quiet_NaN());
+	}
+}
+
+uint32_t Sampler::Hash(const void* data, size_t length, uint32_t seed)
+{
+	const uint32_t c1 = 0xcc9e2d51;
+	const uint32_t c2 = 0x1b873593;
+	auto bytes = (const uint8_t*)data;
+	uint32_t h = seed;
+
+	size_t blockCount = length / 4;
+	for (size_t i = 0; i < blockCount; i++)
+	{
+		uint32_t k;
+		memcpy(&k, bytes + i * 4, 4);
+		k *= c1;
+		k = RotateLeft(k, 15);
+		k *= c2;
+		h ^= k;
+		h = RotateLeft(h, 13);
+		h = h * 5 + 0xe6546b64;
+	}
+
+	auto tail = bytes + blockCount * 4;
+	uint32_t k = 0;
+	switch (length & 3)
+	{
+	case 3:
+		k ^= (uint32_t)tail[2] << 16;
+		// fall through
+	case 2:
+		k ^= (uint32_t)tail[1] << 8;
+		// fall through
+	case 1:
+		k ^= tail[0];
+		k *= c1;
+		k = RotateLeft(k, 15);
+		k *= c2;
+		h ^= k;
+	}
+
+	h ^= (uint32_t)length;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+int Sampler::GetBucket(const wchar_t* clientId, size_t length)
+{
+	// hash UTF-16LE bytes rather than wchar_t memory, whose size and byte order depend on the platform
+	std::vector<uint8_t> bytes(length * 2);
+	for (size_t i = 0; i < length; i++)
+	{
+		bytes[i * 2] = (uint8_t)(clientId[i] & 0xFF);
+		bytes[i * 2 + 1] = (uint8_t)((clientId[i] >> 8) & 0xFF);
+	}
+	return (int)(Hash(bytes.data(), bytes.size()) % BucketCount);
+}
+
+void Sampler::SetClientId(const wchar_t* clientId, size_t length)
+{
+	bucket.store(clientId ? GetBucket(clientId, length) : (int)NoBucket);
+}
+
+float Sampler::GetSampleRate() const
+{
+	return sampleRate.load();
+}
+
+void Sampler::SetSampleRate(float value)
+{
+	sampleRate.store(value);
+}
+
+int Sampler::GetHitTypeIndex(const wchar_t* hitType, size_t length)
+{
+	if (hitType)
+	{
+		for (size_t i = 0; i < HitTypeCount; i++)
+		{
+			if (HitTypeNames[i].Length == length && wmemcmp(HitTypeNames[i].Name, hitType, length) == 0)
+			{
+				return (int)i;
+			}
+		}
+	}
+	return -1;
+}
+
+bool Sampler::SetHitTypeSampleRate(const wchar_t* hitType, size_t length, float value)
+{
+	int index = GetHitTypeIndex(hitType, length);
+	if (index < 0) return false;
+	hitTypeSampleRates[index].store(value);
+	hasHitTypeSampleRates.store(true);
+	return true;
+}
+
+void Sampler::ClearHitTypeSampleRate(const wchar_t* hitType, size_t length)
+{
+	int index = GetHitTypeIndex(hitType, length);
+	if (index >= 0)
+	{
+		hitTypeSampleRates[index].store(std::numeric_limits<float>::quiet_NaN());
+	}
+}
+
+bool Sampler::HasHitTypeSampleRates() const
+{
+	return hasHitTypeSampleRates.load(std::memory_order_relaxed);
+}
+
+bool Sampler::IsSampledIn(const wchar_t* hitType, size_t length) const
+{
+	float rate = sampleRate.load(std::memory_order_relaxed);
+	int index = HasHitTypeSampleRates() ? GetHitTypeIndex(hitType, length) : -1;
+	if (index >= 0)
+	{
+		float hitTypeRate = hitTypeSampleRates[index].load(std::memory_order_relaxed);
+		if (!std::isnan(hitTypeRate))
+		{
+			rate = hitTypeRate;
+		}
+	}
+
+	if (rate <= 0.0F) return false;
+	if (rate >= 100.0F) return true;
+	int clientBucket = bucket.load(std::memory_order_relaxed);
+	return clientBucket == NoBucket || clientBucket < rate * 100.0F;
+}
@@ -0,0 +1,94 @@
+//
+// Sampler.h
+// Declaration of the Sampler class.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Decides which hits are kept when a tracker samples its users.
+	/// </summary>
+	/// <remarks>
+	/// Each client id is assigned a bucket between 0 and 9999 from a MurmurHash3 of its UTF-16LE code units, so a user stays in the same bucket
+	/// across processes, versions and platforms. A hit is kept when its client's bucket is below the sample rate (a percentage) times 100.
+	/// The bucket is computed when the client id is set, and checking a hit only compares numbers. Rates can be set per hit type: since they share
+	/// the bucket, a user sampled in at a lower rate is also sampled in at any higher one.
+	/// </remarks>
+	class Sampler
+	{
+	public:
+
+		static const int BucketCount = 10000;
+
+		/// <summary>
+		/// The bucket of hits that have no client id, which are never sampled out by a rate above 0.
+		/// </summary>
+		static const int NoBucket = -1;
+
+	private:
+
+		static const size_t HitTypeCount = 8;
+
+		std::atomic<int> bucket;
+
+		std::atomic<float> sampleRate;
+
+		// NaN when the hit type uses sampleRate
+		std::atomic<float> hitTypeSampleRates[HitTypeCount];
+
+		std::atomic<bool> hasHitTypeSampleRates;
+
+		static int GetHitTypeIndex(const wchar_t* hitType, size_t length);
+
+	public:
+
+		Sampler();
+
+		/// <summary>
+		/// Computes a 32 bit MurmurHash3 (x86 variant) of a buffer.
+		/// </summary>
+		static uint32_t Hash(const void* data, size_t length, uint32_t seed = 0);
+
+		/// <summary>
+		/// Returns the bucket a client id falls into.
+		/// </summary>
+		static int GetBucket(const wchar_t* clientId, size_t length);
+
+		/// <summary>
+		/// Sets the client whose hits are sampled. Pass nullptr when there is none.
+		/// </summary>
+		void SetClientId(const wchar_t* clientId, size_t length);
+
+		/// <summary>
+		/// Gets or sets the percentage of clients whose hits are kept, for hit types without a rate of their own.
+		/// </summary>
+		float GetSampleRate() const;
+		void SetSampleRate(float value);
+
+		/// <summary>
+		/// Sets the percentage of clients whose hits of the given type are kept. Returns false if the hit type is not one of the Measurement Protocol's.
+		/// </summary>
+		bool SetHitTypeSampleRate(const wchar_t* hitType, size_t length, float value);
+
+		/// <summary>
+		/// Makes hits of the given type use the tracker wide sample rate again.
+		/// </summary>
+		void ClearHitTypeSampleRate(const wchar_t* hitType, size_t length);
+
+		/// <summary>
+		/// Returns whether some hit type has a rate of its own, i.e. whether IsSampledIn needs the hit type.
+		/// </summary>
+		bool HasHitTypeSampleRates() const;
+
+		/// <summary>
+		/// Returns whether a hit of the given type (or nullptr if unknown) should be sent.
+		/// </summary>
+		bool IsSampledIn(const wchar_t* hitType, size_t length) const;
+	};
+}
@@ -0,0 +1,159 @@
+//
+// SegmentStore.cpp
+// Implementation of the DirectorySegmentStore class.
+//
+
+#include "pch.h"
+#include <cstdio>
+#include "SegmentStore.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#define GA_TEXT(s) L##s
+#define GA_TO_STRING std::to_wstring
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define GA_TEXT(s) s
+#define GA_TO_STRING std::to_string
+#endif
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+#ifdef _WIN32
+	FILE* OpenFile(const std::wstring& path, const wchar_t* mode)
+	{
+		FILE* file = nullptr;
+		return _wfopen_s(&file, path.c_str(), mode) == 0 ? file : nullptr;
+	}
+
+	void RemoveFile(const std::wstring& path)
+	{
+		_wremove(path.c_str());
+	}
+
+	void MakeDirectory(const std::wstring& path)
+	{
+		_wmkdir(path.c_str());
+	}
+
+	void SyncFile(FILE* file)
+	{
+		_commit(_fileno(file));
+	}
+#else
+	FILE* OpenFile(const std::string& path, const char* mode)
+	{
+		return fopen(path.c_str(), mode);
+	}
+
+	void RemoveFile(const std::string& path)
+	{
+		remove(path.c_str());
+	}
+
+	void MakeDirectory(const std::string& path)
+	{
+		mkdir(path.c_str(), 0700);
+	}
+
+	void SyncFile(FILE* file)
+	{
+		fsync(fileno(file));
+	}
+#endif
+}
+
+DirectorySegmentStore::DirectorySegmentStore(const Path& directory) :
+	directory(directory)
+{
+	MakeDirectory(directory);
+}
+
+DirectorySegmentStore::Path DirectorySegmentStore::GetSegmentPath(uint32_t segment) const
+{
+	return directory + GA_TEXT("/hits.") + GA_TO_STRING(segment) + GA_TEXT(".log");
+}
+
+DirectorySegmentStore::Path DirectorySegmentStore::GetHeadPath() const
+{
+	return directory + GA_TEXT("/hits.head");
+}
+
+uint32_t DirectorySegmentStore::GetFirstSegment()
+{
+	unsigned long segment = 0;
+	FILE* file = OpenFile(GetHeadPath(), GA_TEXT("rb"));
+	if (file)
+	{
+		if (fscanf(file, "%lu", &segment) != 1)
+		{
+			segment = 0;
+		}
+		fclose(file);
+	}
+	return (uint32_t)segment;
+}
+
+void DirectorySegmentStore::SetFirstSegment(uint32_t segment)
+{
+	FILE* file = OpenFile(GetHeadPath(), GA_TEXT("wb"));
+	if (file)
+	{
+		fprintf(file, "%lu", (unsigned long)segment);
+		fflush(file);
+		SyncFile(file);
+		fclose(file);
+	}
+}
+
+bool DirectorySegmentStore::Exists(uint32_t segment)
+{
+	FILE* file = OpenFile(GetSegmentPath(segment), GA_TEXT("rb"));
+	if (file)
+	{
+		fclose(file);
+		return true;
+	}
+	return false;
+}
+
+bool DirectorySegmentStore::Read(uint32_t segment, std::string& contents)
+{
+	contents.clear();
+	FILE* file = OpenFile(GetSegmentPath(segment), GA_TEXT("rb"));
+	if (!file)
+	{
+		return false;
+	}
+	char buffer[16 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		contents.append(buffer, read);
+	}
+	bool result = !ferror(file);
+	fclose(file);
+	return result;
+}
+
+bool DirectorySegmentStore::Append(uint32_t segment, const char* data, size_t length)
+{
+	FILE* file = OpenFile(GetSegmentPath(segment), GA_TEXT("ab"));
+	if (!file)
+	{
+		return false;
+	}
+	bool result = fwrite(data, 1, length, file) == length && fflush(file) == 0;
+	SyncFile(file);
+	fclose(file);
+	return result;
+}
+
+void DirectorySegmentStore::Remove(uint32_t segment)
+{
+	RemoveFile(GetSegmentPath(segment));
+}
@@ -0,0 +1,83 @@
+//
+// SegmentStore.h
+// Declaration of the ISegmentStore interface and the DirectorySegmentStore class.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// File abstraction used by <see cref="HitLog"/>: a contiguous range of numbered, append-only segments.
+	/// </summary>
+	class ISegmentStore
+	{
+	public:
+
+		virtual ~ISegmentStore() { }
+
+		/// <summary>
+		/// Gets the id of the oldest segment still kept. Segments run from this id up to the first id that does not exist.
+		/// </summary>
+		virtual uint32_t GetFirstSegment() = 0;
+
+		/// <summary>
+		/// Records the id of the oldest segment still kept, once the segments before it have been removed.
+		/// </summary>
+		virtual void SetFirstSegment(uint32_t segment) = 0;
+
+		virtual bool Exists(uint32_t segment) = 0;
+
+		/// <summary>
+		/// Reads a whole segment. Returns false when the segment cannot be read.
+		/// </summary>
+		virtual bool Read(uint32_t segment, std::string& contents) = 0;
+
+		/// <summary>
+		/// Appends to a segment, creating it if needed, and flushes the data to disk before returning.
+		/// </summary>
+		virtual bool Append(uint32_t segment, const char* data, size_t length) = 0;
+
+		virtual void Remove(uint32_t segment) = 0;
+	};
+
+	/// <summary>
+	/// <see cref="ISegmentStore"/> that keeps each segment in its own file within a directory.
+	/// </summary>
+	class DirectorySegmentStore : public ISegmentStore
+	{
+	private:
+
+#ifdef _WIN32
+		typedef std::wstring Path;
+#else
+		typedef std::string Path;
+#endif
+
+		Path directory;
+
+		Path GetSegmentPath(uint32_t segment) const;
+
+		Path GetHeadPath() const;
+
+	public:
+
+		DirectorySegmentStore(const Path& directory);
+
+		virtual uint32_t GetFirstSegment() override;
+
+		virtual void SetFirstSegment(uint32_t segment) override;
+
+		virtual bool Exists(uint32_t segment) override;
+
+		virtual bool Read(uint32_t segment, std::string& contents) override;
+
+		virtual bool Append(uint32_t segment, const char* data, size_t length) override;
+
+		virtual void Remove(uint32_t segment) override;
+	};
+}
@@ -0,0 +1,64 @@
+//
+// TimeSource.cpp
+// Implementation of the TimeSource class.
+//
+
+#include "pch.h"
+#include "TimeSource.h"
+#include <chrono>
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	typedef std::chrono::duration<long long, std::ratio<1, 10000000>> Ticks;
+
+	const long long ReanchorInterval = 1000000000LL;
+}
+
+std::atomic<unsigned int> TimeSource::anchorVersion(0);
+std::atomic<long long> TimeSource::anchorUniversal(0);
+std::atomic<long long> TimeSource::anchorMonotonic(0);
+std::mutex TimeSource::anchorLock;
+
+long long TimeSource::MonotonicNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+long long TimeSource::SystemNow()
+{
+	return std::chrono::duration_cast<Ticks>(std::chrono::system_clock::now().time_since_epoch()).count() + UnixEpochTicks;
+}
+
+long long TimeSource::UniversalNow()
+{
+	auto monotonic = MonotonicNow();
+
+	// seqlock read: an odd version, or one that changed under us, means the anchor is being replaced
+	auto version = anchorVersion.load(std::memory_order_acquire);
+	auto universal = anchorUniversal.load(std::memory_order_relaxed);
+	auto anchored = anchorMonotonic.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (version == 0 || (version & 1) != 0 || anchorVersion.load(std::memory_order_relaxed) != version || monotonic - anchored >= ReanchorInterval)
+	{
+		return Reanchor(monotonic);
+	}
+	return universal + (monotonic - anchored) / 100;
+}
+
+long long TimeSource::Reanchor(long long monotonicNow)
+{
+	auto universal = SystemNow();
+	std::unique_lock<std::mutex> lg(anchorLock, std::try_to_lock);
+	if (lg.owns_lock())
+	{
+		auto version = anchorVersion.load(std::memory_order_relaxed);
+		anchorVersion.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		anchorUniversal.store(universal, std::memory_order_relaxed);
+		anchorMonotonic.store(monotonicNow, std::memory_order_relaxed);
+		anchorVersion.store(version + 2, std::memory_order_release);
+	}
+	return universal;
+}
@@ -0,0 +1,53 @@
+//
+// TimeSource.h
+// Declaration of the TimeSource class.
+//
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Cheap clocks for time stamping hits and measuring intervals.
+	/// </summary>
+	/// <remarks>
+	/// The wall clock is derived from the monotonic clock and an anchor pair (wall time, monotonic time) that is refreshed from the system clock at most once per second.
+	/// Reading it costs a single monotonic clock read; it follows changes to the system clock within a second.
+	/// </remarks>
+	class TimeSource
+	{
+	public:
+
+		/// <summary>
+		/// Number of 100 nanosecond ticks between 1601-01-01 (the Windows::Foundation::DateTime epoch) and 1970-01-01.
+		/// </summary>
+		static const long long UnixEpochTicks = 116444736000000000LL;
+
+		/// <summary>
+		/// Returns the current time as 100 nanosecond ticks since 1601-01-01 UTC, the representation of Windows::Foundation::DateTime::UniversalTime.
+		/// </summary>
+		static long long UniversalNow();
+
+		/// <summary>
+		/// Returns a monotonic time in nanoseconds, only meaningful relative to other values returned in the same process.
+		/// </summary>
+		static long long MonotonicNow();
+
+	private:
+
+		static std::atomic<unsigned int> anchorVersion;
+
+		static std::atomic<long long> anchorUniversal;
+
+		static std::atomic<long long> anchorMonotonic;
+
+		static std::mutex anchorLock;
+
+		static long long SystemNow();
+
+		static long long Reanchor(long long monotonicNow);
+	};
+}
@@ -5,44 +5,76 @@
 
 #include "pch.h"
 #include "TokenBucket.h"
-#include "DateTimeHelper.h"
-#include "TimeSpanHelper.h"
+#include "TimeSource.h"
+#include <algorithm>
 
 using namespace GoogleAnalytics;
-using namespace Platform;
-using namespace Windows::Foundation;
 
-TokenBucket::TokenBucket(double tokens, double fillRate) : 
-	capacity(tokens), 
-	tokens(tokens), 
-	fillRate(fillRate)
+namespace
 {
-	timeStamp = DateTimeHelper::Now();
-}
+	const double NanosecondsPerSecond = 1e9;
 
-bool TokenBucket::Consume(double tokens)
-{
-	std::lock_guard<std::mutex> lg(locker);  // make thread safe
-	if (GetTokens() - tokens > 0)
-	{
-		this->tokens -= tokens;
-		return true;
-	}
-	else
+	// keeps capacity * interval well within a long long
+	const double MaxSpan = 1e18;
+
+	long long ToInterval(double fillRate)
 	{
-		return false;
+		return (long long)(NanosecondsPerSecond / (std::max)(fillRate, 1e-6));
 	}
 }
 
-double TokenBucket::GetTokens()
+TokenBucket::TokenBucket(double capacity, double fillRate, Clock clock) :
+	clock(clock ? clock : &TimeSource::MonotonicNow),
+	capacity((std::max)(capacity, 0.0)),
+	interval((std::max)(ToInterval(fillRate), 1LL))
 {
-	auto now = DateTimeHelper::Now();
-	if (tokens < capacity)
+	// start full
+	emptyAt = this->clock() - (long long)(std::min)(this->capacity.load() * interval.load(), MaxSpan);
+}
+
+double TokenBucket::GetCapacity() const
+{
+	return capacity;
+}
+
+void TokenBucket::SetCapacity(double value)
+{
+	capacity = (std::max)(value, 0.0);
+}
+
+double TokenBucket::GetFillRate() const
+{
+	return NanosecondsPerSecond / interval;
+}
+
+void TokenBucket::SetFillRate(double value)
+{
+	interval = (std::max)(ToInterval(value), 1LL);
+}
+
+bool TokenBucket::Consume()
+{
+	return TryConsumeN(1) == 1;
+}
+
+size_t TokenBucket::TryConsumeN(size_t count)
+{
+	if (count == 0) return 0;
+
+	auto now = clock();
+	auto step = interval.load();
+	auto span = (long long)(std::min)(capacity.load() * step, MaxSpan);
+	auto current = emptyAt.load();
+	while (true)
 	{
-		auto delta = fillRate * TimeSpanHelper::GetTotalSeconds(TimeSpanHelper::FromTicks(now.UniversalTime - timeStamp.UniversalTime));
-		tokens = capacity < tokens + delta ? capacity : tokens + delta;
-		timeStamp = now;
+		// a bucket that has been idle for long is simply full; tokens beyond capacity are not banked
+		auto start = (std::max)(current, now - span);
+		auto available = now > start ? (unsigned long long)((now - start) / step) : 0ULL;
+		auto granted = (size_t)(std::min)((unsigned long long)count, available);
+		if (granted == 0) return 0;
+		if (emptyAt.compare_exchange_weak(current, start + (long long)granted * step))
+		{
+			return granted;
+		}
 	}
-	return tokens;
 }
-
@@ -5,32 +5,59 @@
 
 #pragma once
 
-#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <functional>
 
 namespace GoogleAnalytics
 {
-
-	ref class TokenBucket sealed
+	/// <summary>
+	/// Rate limiter holding up to capacity tokens, refilled at fillRate tokens per second.
+	/// </summary>
+	/// <remarks>
+	/// Implemented as a generic cell rate algorithm: the only state is the time at which the bucket would be empty, updated with a compare and swap, so consuming never blocks.
+	/// Time comes from a monotonic clock returning nanoseconds, which can be replaced to drive the bucket deterministically.
+	/// </remarks>
+	class TokenBucket
 	{
+	public:
+
+		typedef std::function<long long()> Clock;
+
 	private:
 
-		double capacity;
+		Clock clock;
+
+		std::atomic<long long> emptyAt;
 
-		double tokens;
+		std::atomic<double> capacity;
 
-		double fillRate;
+		std::atomic<long long> interval;
 
-		Windows::Foundation::DateTime timeStamp;
-		
-		std::mutex locker;
+	public:
 
-		double GetTokens();
+		TokenBucket(double capacity, double fillRate, Clock clock = nullptr);
 
-	internal:
+		/// <summary>
+		/// Gets or sets the number of tokens the bucket holds when full.
+		/// </summary>
+		double GetCapacity() const;
+		void SetCapacity(double value);
 
-		TokenBucket(double tokens, double fillRate);
+		/// <summary>
+		/// Gets or sets the number of tokens added per second.
+		/// </summary>
+		double GetFillRate() const;
+		void SetFillRate(double value);
 
-		bool Consume(double tokens = 1.0);
+		/// <summary>
+		/// Takes a single token, returning false if the bucket is empty.
+		/// </summary>
+		bool Consume();
 
+		/// <summary>
+		/// Takes up to count tokens at once and returns how many were granted.
+		/// </summary>
+		size_t TryConsumeN(size_t count);
 	};
 }
@@ -12,14 +12,65 @@ using namespace Platform;
 using namespace Platform::Collections;
 using namespace Windows::Foundation::Collections;
 using namespace Windows::Foundation;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	void SetParameter(HitRecord& record, Parameter key, String^ value)
+	{
+		record.Set(GetName(key), GetNameLength(key), value ? value->Data() : L"", value ? value->Length() : 0);
+	}
+
+	void SetParameter(HitRecord& record, String^ key, String^ value)
+	{
+		record.Set(key->Data(), key->Length(), value ? value->Data() : L"", value ? value->Length() : 0);
+	}
+
+	// passes the hits of a tracker created for a service manager other than AnalyticsManager to its EnqueueHit, merged into one map
+	class ServiceManagerHitSink : public ITrackerHitSink
+	{
+	public:
+		explicit ServiceManagerHitSink(IServiceManager^ serviceManager)
+			: serviceManager(serviceManager)
+		{
+		}
+
+		virtual void EnqueueTrackerHit(std::shared_ptr<const HitRecord> trackerParameters, IMap<String^, String^>^ params) override
+		{
+			auto result = ref new Map<String^, String^>();
+			trackerParameters->ForEach([result](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+				result->Insert(ref new String(key, (unsigned int)keyLength), ref new String(value, (unsigned int)valueLength));
+			});
+			for each (auto item in params)
+			{
+				result->Insert(item->Key, item->Value);
+			}
+			serviceManager->EnqueueHit(result);
+		}
+
+	private:
+		IServiceManager^ serviceManager;
+	};
+}
 
 Tracker::Tracker(String^ propertyId, IPlatformInfoProvider^ platformInfoProvider, IServiceManager^ analyticsManager)
+{
+	Initialize(propertyId, platformInfoProvider, std::make_shared<ServiceManagerHitSink>(analyticsManager));
+}
+
+Tracker::Tracker(String^ propertyId, IPlatformInfoProvider^ platformInfoProvider, std::shared_ptr<ITrackerHitSink> hitSink)
+{
+	Initialize(propertyId, platformInfoProvider, std::move(hitSink));
+}
+
+void Tracker::Initialize(String^ propertyId, IPlatformInfoProvider^ platformInfoProvider, std::shared_ptr<ITrackerHitSink> hitSink)
 {
 	this->propertyId = propertyId;
 	this->platformInfoProvider = platformInfoProvider;
-	this->analyticsManager = analyticsManager;
-	SampleRate = 100.0F;
+	this->hitSink = std::move(hitSink);
 	data = ref new Map<String^, String^>();
+	version = 1;
+	anonymizeIP = false;
 
 	if (platformInfoProvider != nullptr)
 	{
@@ -47,52 +98,322 @@ void Tracker::Send(IMap<String^, String^>^ params)
 {
 	if (propertyId)
 	{
-		if (!IsSampledOut())
+		// decided before any work is spent on a hit that is not going to be sent
+		if (!IsSampledOut(params))
 		{
-			analyticsManager->EnqueueHit(AddRequiredHitData(params));
+			auto current = GetSnapshot();
+			hitSink->EnqueueTrackerHit(std::shared_ptr<const HitRecord>(current, &current->Parameters), params);
 		}
 	}
 }
 
-IMap<String^, String^>^ Tracker::AddRequiredHitData(IMap<String^, String^>^ params)
-{
-	auto result = ref new Map<String^, String^>();
-	result->Insert("v", "1");
-	result->Insert("tid", PropertyId);
-	result->Insert("cid", ClientId);
-	result->Insert("an", AppName);
-	result->Insert("av", AppVersion);
-
-	if (AppId) result->Insert("aid", AppId);
-	if (AppInstallerId) result->Insert("aiid", AppInstallerId);
-	if (ScreenName) result->Insert("cd", ScreenName);
-	if (AnonymizeIP) result->Insert("aip", "1");
-	if (ScreenResolution) result->Insert("sr", ScreenResolution->Value.Width.ToString() + "x" + ScreenResolution->Value.Height.ToString());
-	if (ViewportSize) result->Insert("vp", ViewportSize->Value.Width.ToString() + "x" + ViewportSize->Value.Height.ToString());
-	if (Language) result->Insert("ul", Language);
-	if (ScreenColors) result->Insert("sd", ScreenColors->Value.ToString() + "-bits");
-
-	if (Referrer) result->Insert("dr", Referrer);
-	if (Encoding) result->Insert("de", Encoding);
-	if (IpOverride) result->Insert("uip", IpOverride);
-	if (UserAgentOverride) result->Insert("ua", UserAgentOverride);
-	if (HostName) result->Insert("dh", HostName);
-	if (Page) result->Insert("dp", Page);
-	if (Title) result->Insert("dt", Title);
-	if (ExperimentId) result->Insert("xid", ExperimentId);
-	if (ExperimentVariant) result->Insert("xvar", ExperimentVariant);
-	if (LocationOverride) result->Insert("geoid", LocationOverride);
+bool Tracker::AnonymizeIP::get()
+{
+	return anonymizeIP;
+}
 
-	for each (auto item in data)
+void Tracker::AnonymizeIP::set(bool value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	anonymizeIP = value;
+	version++;
+}
+
+String^ Tracker::ClientId::get()
+{
+	return clientId;
+}
+
+void Tracker::ClientId::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	clientId = value;
+	sampler.SetClientId(value ? value->Data() : nullptr, value ? value->Length() : 0);
+	version++;
+}
+
+String^ Tracker::IpOverride::get()
+{
+	return ipOverride;
+}
+
+void Tracker::IpOverride::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	ipOverride = value;
+	version++;
+}
+
+String^ Tracker::UserAgentOverride::get()
+{
+	return userAgentOverride;
+}
+
+void Tracker::UserAgentOverride::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	userAgentOverride = value;
+	version++;
+}
+
+String^ Tracker::LocationOverride::get()
+{
+	return locationOverride;
+}
+
+void Tracker::LocationOverride::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	locationOverride = value;
+	version++;
+}
+
+String^ Tracker::Referrer::get()
+{
+	return referrer;
+}
+
+void Tracker::Referrer::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	referrer = value;
+	version++;
+}
+
+IBox<Dimensions>^ Tracker::ScreenResolution::get()
+{
+	return screenResolution;
+}
+
+void Tracker::ScreenResolution::set(IBox<Dimensions>^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	screenResolution = value;
+	version++;
+}
+
+IBox<Dimensions>^ Tracker::ViewportSize::get()
+{
+	return viewportSize;
+}
+
+void Tracker::ViewportSize::set(IBox<Dimensions>^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	viewportSize = value;
+	version++;
+}
+
+String^ Tracker::Encoding::get()
+{
+	return encoding;
+}
+
+void Tracker::Encoding::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	encoding = value;
+	version++;
+}
+
+IBox<int>^ Tracker::ScreenColors::get()
+{
+	return screenColors;
+}
+
+void Tracker::ScreenColors::set(IBox<int>^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	screenColors = value;
+	version++;
+}
+
+String^ Tracker::Language::get()
+{
+	return language;
+}
+
+void Tracker::Language::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	language = value;
+	version++;
+}
+
+String^ Tracker::HostName::get()
+{
+	return hostName;
+}
+
+void Tracker::HostName::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	hostName = value;
+	version++;
+}
+
+String^ Tracker::Page::get()
+{
+	return page;
+}
+
+void Tracker::Page::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	page = value;
+	version++;
+}
+
+String^ Tracker::Title::get()
+{
+	return title;
+}
+
+void Tracker::Title::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	title = value;
+	version++;
+}
+
+String^ Tracker::ScreenName::get()
+{
+	return screenName;
+}
+
+void Tracker::ScreenName::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	screenName = value;
+	version++;
+}
+
+String^ Tracker::AppName::get()
+{
+	return appName;
+}
+
+void Tracker::AppName::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	appName = value;
+	version++;
+}
+
+String^ Tracker::AppId::get()
+{
+	return appId;
+}
+
+void Tracker::AppId::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	appId = value;
+	version++;
+}
+
+String^ Tracker::AppVersion::get()
+{
+	return appVersion;
+}
+
+void Tracker::AppVersion::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	appVersion = value;
+	version++;
+}
+
+String^ Tracker::AppInstallerId::get()
+{
+	return appInstallerId;
+}
+
+void Tracker::AppInstallerId::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	appInstallerId = value;
+	version++;
+}
+
+String^ Tracker::ExperimentId::get()
+{
+	return experimentId;
+}
+
+void Tracker::ExperimentId::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	experimentId = value;
+	version++;
+}
+
+String^ Tracker::ExperimentVariant::get()
+{
+	return experimentVariant;
+}
+
+void Tracker::ExperimentVariant::set(String^ value)
+{
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	experimentVariant = value;
+	version++;
+}
+
+
+std::shared_ptr<const TrackerSnapshot> Tracker::GetSnapshot()
+{
+	// Send may run on several threads: readers share the current snapshot without locking and only a stale one is rebuilt, under the same lock the setters take
+	auto current = std::atomic_load(&snapshot);
+	if (current && current->Version == version.load())
 	{
-		result->Insert(item->Key, item->Value);
+		return current;
 	}
-	for each (auto item in params)
+
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	current = std::atomic_load(&snapshot);
+	if (current && current->Version == version.load())
 	{
-		result->Insert(item->Key, item->Value);
+		return current;
 	}
 
-	return result;
+	auto result = std::make_shared<TrackerSnapshot>();
+	result->Version = version.load();
+	HitRecord& parameters = result->Parameters;
+	SetParameter(parameters, Parameter::ProtocolVersion, "1");
+	SetParameter(parameters, Parameter::TrackingId, propertyId);
+	SetParameter(parameters, Parameter::ClientId, clientId);
+	SetParameter(parameters, Parameter::ApplicationName, appName);
+	SetParameter(parameters, Parameter::ApplicationVersion, appVersion);
+
+	if (appId) SetParameter(parameters, Parameter::ApplicationId, appId);
+	if (appInstallerId) SetParameter(parameters, Parameter::ApplicationInstallerId, appInstallerId);
+	if (screenName) SetParameter(parameters, Parameter::ScreenName, screenName);
+	if (anonymizeIP) SetParameter(parameters, Parameter::AnonymizeIp, "1");
+	if (screenResolution) SetParameter(parameters, Parameter::ScreenResolution, screenResolution->Value.Width.ToString() + "x" + screenResolution->Value.Height.ToString());
+	if (viewportSize) SetParameter(parameters, Parameter::ViewportSize, viewportSize->Value.Width.ToString() + "x" + viewportSize->Value.Height.ToString());
+	if (language) SetParameter(parameters, Parameter::UserLanguage, language);
+	if (screenColors) SetParameter(parameters, Parameter::ScreenColors, screenColors->Value.ToString() + "-bits");
+
+	if (referrer) SetParameter(parameters, Parameter::DocumentReferrer, referrer);
+	if (encoding) SetParameter(parameters, Parameter::DocumentEncoding, encoding);
+	if (ipOverride) SetParameter(parameters, Parameter::IpOverride, ipOverride);
+	if (userAgentOverride) SetParameter(parameters, Parameter::UserAgentOverride, userAgentOverride);
+	if (hostName) SetParameter(parameters, Parameter::DocumentHostName, hostName);
+	if (page) SetParameter(parameters, Parameter::DocumentPath, page);
+	if (title) SetParameter(parameters, Parameter::DocumentTitle, title);
+	if (experimentId) SetParameter(parameters, Parameter::ExperimentId, experimentId);
+	if (experimentVariant) SetParameter(parameters, Parameter::ExperimentVariant, experimentVariant);
+	if (locationOverride) SetParameter(parameters, Parameter::GeographicalOverride, locationOverride);
+
+	for each (auto item in data)
+	{
+		SetParameter(parameters, item->Key, item->Value);
+	}
+
+	current = result;
+	std::atomic_store(&snapshot, current);
+	return current;
 }
 
 String^ Tracker::Get(String^ key)
@@ -102,24 +423,45 @@ String^ Tracker::Get(String^ key)
 
 void Tracker::Set(String^ key, String^ value)
 {
-	if (data->HasKey(key))
+	std::lock_guard<std::mutex> lg(snapshotLock);
+	data->Insert(key, value);
+	version++;
+}
+
+bool Tracker::IsSampledOut(IMap<String^, String^>^ params)
+{
+	String^ hitType = nullptr;
+	if (sampler.HasHitTypeSampleRates() && params->HasKey("t"))
 	{
-		data->Remove(key);
+		hitType = params->Lookup("t");
 	}
-	data->Insert(key, value);
+	return !sampler.IsSampledIn(hitType ? hitType->Data() : nullptr, hitType ? hitType->Length() : 0);
+}
+
+float Tracker::SampleRate::get()
+{
+	return sampler.GetSampleRate();
+}
+
+void Tracker::SampleRate::set(float value)
+{
+	sampler.SetSampleRate(value);
 }
 
-bool Tracker::IsSampledOut()
+void Tracker::SetHitTypeSampleRate(String^ hitType, float sampleRate)
 {
-	if (SampleRate <= 0.0F)
+	if (!hitType || !sampler.SetHitTypeSampleRate(hitType->Data(), hitType->Length(), sampleRate))
 	{
-		return true;
+		throw ref new InvalidArgumentException("hitType");
 	}
-	else if (SampleRate < 100.0F)
+}
+
+void Tracker::ClearHitTypeSampleRate(String^ hitType)
+{
+	if (hitType)
 	{
-		return ((ClientId != nullptr) && (std::abs(ClientId->GetHashCode()) % 10000 >= SampleRate * 100.0F));
+		sampler.ClearHitTypeSampleRate(hitType->Data(), hitType->Length());
 	}
-	else return false;
 }
 
 
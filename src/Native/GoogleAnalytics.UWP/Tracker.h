@@ -10,11 +10,31 @@
 #include "Hit.h"
 #include "IPlatformInfoProvider.h"
 #include "IServiceManager.h"
+#include "HitRecord.h"
+#include "Sampler.h"
+#include "TrackerHitSink.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace GoogleAnalytics
 {
 	ref class AnalyticsManager;
 
+	/// <summary>
+	/// Immutable copy of the tracker level parameters added to every hit sent by a <see cref="Tracker"/>.
+	/// </summary>
+	/// <remarks>Hits keep a reference to the snapshot current when they were sent instead of copying its parameters.</remarks>
+	struct TrackerSnapshot
+	{
+		/// <summary>
+		/// The version of the tracker the snapshot was taken from.
+		/// </summary>
+		unsigned long long Version;
+
+		GoogleAnalytics::HitRecord Parameters;
+	};
+
 	/// <summary>
 	/// Represents an object capable of tracking events for a single Google Analytics property.
 	/// </summary>
@@ -22,12 +42,65 @@ namespace GoogleAnalytics
 	{
 	private:
 
-		GoogleAnalytics::IServiceManager^ analyticsManager;
+		std::shared_ptr<GoogleAnalytics::ITrackerHitSink> hitSink;
 
 		Platform::String^ propertyId;
 
 		Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ data;
 
+		bool anonymizeIP;
+
+		Platform::String^ clientId;
+
+		Platform::String^ ipOverride;
+
+		Platform::String^ userAgentOverride;
+
+		Platform::String^ locationOverride;
+
+		Platform::String^ referrer;
+
+		Platform::IBox<Dimensions>^ screenResolution;
+
+		Platform::IBox<Dimensions>^ viewportSize;
+
+		Platform::String^ encoding;
+
+		Platform::IBox<int>^ screenColors;
+
+		Platform::String^ language;
+
+		Platform::String^ hostName;
+
+		Platform::String^ page;
+
+		Platform::String^ title;
+
+		Platform::String^ screenName;
+
+		Platform::String^ appName;
+
+		Platform::String^ appId;
+
+		Platform::String^ appVersion;
+
+		Platform::String^ appInstallerId;
+
+		Platform::String^ experimentId;
+
+		Platform::String^ experimentVariant;
+
+		/// <summary>
+		/// Incremented under snapshotLock each time a tracker level parameter changes.
+		/// </summary>
+		std::atomic<unsigned long long> version;
+
+		std::mutex snapshotLock;
+
+		std::shared_ptr<const TrackerSnapshot> snapshot;
+
+		std::shared_ptr<const TrackerSnapshot> GetSnapshot();
+
 		Windows::Foundation::EventRegistrationToken viewPortResolutionChangedEventToken;
 
 		Windows::Foundation::EventRegistrationToken screenResolutionChangedEventToken;
@@ -38,9 +111,18 @@ namespace GoogleAnalytics
 
 		void platformTrackingInfo_ScreenResolutionChanged(Platform::Object^ sender, Platform::Object^ args);
 
-		Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ AddRequiredHitData(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ hit);
+		GoogleAnalytics::Sampler sampler;
+
+		bool IsSampledOut(Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ params);
+
+		void Initialize(Platform::String^ propertyId, GoogleAnalytics::IPlatformInfoProvider^ platformInfoProvider, std::shared_ptr<GoogleAnalytics::ITrackerHitSink> hitSink);
 
-		bool IsSampledOut();
+	internal:
+
+		/// <summary>
+		/// Creates a tracker that passes its hits to hitSink, keeping the tracker level parameters apart from those of each hit.
+		/// </summary>
+		Tracker(Platform::String^ propertyId, GoogleAnalytics::IPlatformInfoProvider^ platformInfoProvider, std::shared_ptr<GoogleAnalytics::ITrackerHitSink> hitSink);
 
 	public:
 
@@ -68,7 +150,11 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#aiid"/>
-		property bool AnonymizeIP;
+		property bool AnonymizeIP
+		{
+			bool get();
+			void set(bool value);
+		}
 
 #pragma endregion General 
 
@@ -80,7 +166,11 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Required for all hit types.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#cid"/>
-		property Platform::String^ ClientId;
+		property Platform::String^ ClientId
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion 
 
@@ -92,21 +182,33 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#uip"/>
-		property Platform::String^ IpOverride;
+		property Platform::String^ IpOverride
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the User Agent of the browser. Note that Google has libraries to identify real user agents. Hand crafting your own agent could break at any time.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#ua"/>
-		property Platform::String^ UserAgentOverride;
+		property Platform::String^ UserAgentOverride
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the geographical location of the user. The geographical ID should be a two letter country code or a criteria ID representing a city or region (see http://developers.google.com/analytics/devguides/collection/protocol/v1/geoid). This parameter takes precedent over any location derived from IP address, including the IP Override parameter. An invalid code will result in geographical dimensions to be set to '(not set)'.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#geoid"/>
-		property Platform::String^ LocationOverride;
+		property Platform::String^ LocationOverride
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion Session 
 
@@ -118,7 +220,11 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#dr"/>
-		property Platform::String^ Referrer;
+		property Platform::String^ Referrer
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion 
 
@@ -129,35 +235,55 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#sr"/>
-		property Platform::IBox<Dimensions>^ ScreenResolution;
+		property Platform::IBox<Dimensions>^ ScreenResolution
+		{
+			Platform::IBox<Dimensions>^ get();
+			void set(Platform::IBox<Dimensions>^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the viewable area of the browser / device.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#vp"/>
-		property Platform::IBox<Dimensions>^ ViewportSize;
+		property Platform::IBox<Dimensions>^ ViewportSize
+		{
+			Platform::IBox<Dimensions>^ get();
+			void set(Platform::IBox<Dimensions>^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the character set used to encode the page / document.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#de"/> 
-		property Platform::String^ Encoding;
+		property Platform::String^ Encoding
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the screen color depth.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#sd"/>
-		property Platform::IBox<int>^ ScreenColors;
+		property Platform::IBox<int>^ ScreenColors
+		{
+			Platform::IBox<int>^ get();
+			void set(Platform::IBox<int>^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the language.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#ul"/>
-		property Platform::String^ Language;
+		property Platform::String^ Language
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion System Info 
 
@@ -169,28 +295,44 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#dh"/>
-		property Platform::String^ HostName;
+		property Platform::String^ HostName
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the path portion of the page URL.
 		/// </summary>
 		/// <remarks>Optional. Should begin with '/'.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#dp"/>
-		property Platform::String^ Page;
+		property Platform::String^ Page
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the title of the page / document.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#dt"/>
-		property Platform::String^ Title;
+		property Platform::String^ Title
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the 'Screen Name' of the screenview hit. On web properties this will default to the unique URL of the page.
 		/// </summary>
 		/// <remarks>Required for screenview hit type. Note: This parameter is optional on web properties, and required on mobile properties for screenview hits.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#cd"/>
-		property Platform::String^ ScreenName;
+		property Platform::String^ ScreenName
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion Content Info 
 
@@ -201,28 +343,44 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#an"/>
-		property Platform::String^ AppName;
+		property Platform::String^ AppName
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the application identifier.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#aid"/>
-		property Platform::String^ AppId;
+		property Platform::String^ AppId
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the application version.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#av"/>
-		property Platform::String^ AppVersion;
+		property Platform::String^ AppVersion
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the application installer identifier.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#aiid"/>
-		property Platform::String^ AppInstallerId;
+		property Platform::String^ AppInstallerId
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion App Tracking 
 
@@ -234,14 +392,22 @@ namespace GoogleAnalytics
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#xid"/>
-		property Platform::String^ ExperimentId;
+		property Platform::String^ ExperimentId
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 		/// <summary>
 		/// Gets or sets the parameter that specifies that this user has been exposed to a particular variation of an experiment. It should be sent in conjunction with the Experiment ID parameter.
 		/// </summary>
 		/// <remarks>Optional.</remarks>
 		/// <seealso href="https://developers.google.com/analytics/devguides/collection/protocol/v1/parameters#xvar"/>
-		property Platform::String^ ExperimentVariant;
+		property Platform::String^ ExperimentVariant
+		{
+			Platform::String^ get();
+			void set(Platform::String^ value);
+		}
 
 #pragma endregion Content experiments 
 
@@ -249,8 +415,28 @@ namespace GoogleAnalytics
 		/// <summary>
 		/// Gets or sets the rate at which <see cref="Hit"/>s should be excluded for sampling purposes. Default is 100.
 		/// </summary>
-		/// <remarks>100 means no items should be excluded, 50 means half should be excluded, and 0 means all items should be excluded.</remarks>
-		property float SampleRate;
+		/// <remarks>
+		/// 100 means no items should be excluded, 50 means half should be excluded, and 0 means all items should be excluded.
+		/// Sampling is per user: whether a user is sampled out depends only on <see cref="ClientId"/> and the rate, and stays the same across sessions and app versions.
+		/// </remarks>
+		property float SampleRate
+		{
+			float get();
+			void set(float value);
+		}
+
+		/// <summary>
+		/// Sets a sample rate for one hit type, in place of <see cref="SampleRate"/>, e.g. to keep every exception but only a tenth of the screen views.
+		/// </summary>
+		/// <param name="hitType">One of the Measurement Protocol hit types, such as "screenview" or "exception".</param>
+		/// <param name="sampleRate">The rate for that hit type, with the same meaning as <see cref="SampleRate"/>.</param>
+		void SetHitTypeSampleRate(Platform::String^ hitType, float sampleRate);
+
+		/// <summary>
+		/// Makes a hit type use <see cref="SampleRate"/> again after <see cref="SetHitTypeSampleRate"/>.
+		/// </summary>
+		/// <param name="hitType">The hit type passed to <see cref="SetHitTypeSampleRate"/>.</param>
+		void ClearHitTypeSampleRate(Platform::String^ hitType);
 
 		/// <summary>
 		/// Gets the model value for the given key added through <see cref="Set"/>.
@@ -0,0 +1,28 @@
+//
+// TrackerHitSink.h
+// Declaration of the ITrackerHitSink interface.
+//
+
+#pragma once
+
+#include "HitRecord.h"
+#include <memory>
+
+namespace GoogleAnalytics
+{
+	/// <summary>
+	/// Takes the hits sent by a <see cref="Tracker"/>.
+	/// </summary>
+	/// <remarks>
+	/// A hit arrives as the tracker level parameters, an immutable snapshot shared between the hits of a tracker, and the parameters of the hit itself, which take precedence.
+	/// <see cref="AnalyticsManager"/> keeps the two apart; a tracker created for any other <see cref="IServiceManager"/> merges them into the map it passes to EnqueueHit.
+	/// </remarks>
+	class ITrackerHitSink
+	{
+	public:
+
+		virtual ~ITrackerHitSink() { }
+
+		virtual void EnqueueTrackerHit(std::shared_ptr<const HitRecord> trackerParameters, Windows::Foundation::Collections::IMap<Platform::String^, Platform::String^>^ params) = 0;
+	};
+}
@@ -0,0 +1,51 @@
+//
+// BenchmarkHarness.h
+// Declaration of the minimal benchmark registry used by the portable micro-benchmarks.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace GoogleAnalytics
+{
+	namespace Benchmarks
+	{
+		struct BenchmarkCase
+		{
+			const char* Name;
+			void (*Run)(size_t iterations);
+		};
+
+		std::vector<BenchmarkCase>& GetBenchmarks();
+
+		/// <summary>
+		/// Gets the number of allocations made through operator new since the benchmark executable started.
+		/// </summary>
+		size_t GetAllocationCount();
+
+		struct Registration
+		{
+			Registration(const char* name, void (*run)(size_t))
+			{
+				BenchmarkCase benchmark = { name, run };
+				GetBenchmarks().push_back(benchmark);
+			}
+		};
+
+		/// <summary>
+		/// Keeps the optimizer from discarding a result the benchmark does not otherwise use.
+		/// </summary>
+		void KeepAlive(const void* value);
+	}
+}
+
+/// <summary>
+/// Defines a benchmark that runs the measured operation iterations times. Benchmarks are named Suite_Case; the benchmark executable reports
+/// the time and the allocations per iteration of each, and running it with a suite name only runs that suite.
+/// </summary>
+#define BENCHMARK(name) \
+	static void name(size_t iterations); \
+	static GoogleAnalytics::Benchmarks::Registration name##_Registration(#name, &name); \
+	static void name(size_t iterations)
@@ -0,0 +1,106 @@
+//
+// BenchmarkMain.cpp
+// Runs the registered micro-benchmarks and reports time and allocations per iteration.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "BenchmarkHarness.h"
+
+using namespace GoogleAnalytics::Benchmarks;
+
+namespace
+{
+	std::atomic<size_t> allocationCount(0);
+
+	const void* volatile sink;
+}
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+std::vector<BenchmarkCase>& GoogleAnalytics::Benchmarks::GetBenchmarks()
+{
+	static std::vector<BenchmarkCase> benchmarks;
+	return benchmarks;
+}
+
+size_t GoogleAnalytics::Benchmarks::GetAllocationCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+void GoogleAnalytics::Benchmarks::KeepAlive(const void* value)
+{
+	sink = value;
+}
+
+// usage: GoogleAnalyticsBenchmarks [--iterations N] [Suite]
+int main(int argc, char* argv[])
+{
+	size_t iterations = 100000;
+	const char* suite = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+		{
+			iterations = (size_t)std::strtoull(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			suite = argv[i];
+		}
+	}
+	if (iterations == 0) iterations = 1;
+	size_t suiteLength = suite ? std::strlen(suite) : 0;
+
+	int run = 0;
+	auto& benchmarks = GetBenchmarks();
+	for (auto it = benchmarks.begin(); it != benchmarks.end(); ++it)
+	{
+		// Suite_Case
+		if (suite && (std::strncmp(it->Name, suite, suiteLength) != 0 || it->Name[suiteLength] != '_')) continue;
+		size_t allocations = GetAllocationCount();
+		auto started = std::chrono::steady_clock::now();
+		it->Run(iterations);
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+		allocations = GetAllocationCount() - allocations;
+		std::printf("%-56s %12.1f ns %10.2f allocations\n", it->Name, (double)elapsed / iterations, (double)allocations / iterations);
+		run++;
+	}
+	return run == 0 ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+//
+// FlushPolicyTests.cpp
+// Tests of FlushPolicy thresholds, timers and the cycles held for hits a flush left behind.
+//
+
+#include "TestHarness.h"
+#include "FlushPolicy.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const long long Second = 1000000000LL;
+
+	typedef FlushPolicy::Action Action;
+	typedef FlushPolicy::Trigger Trigger;
+
+	Action Add(FlushPolicy& policy, size_t bytes, long long now, long long& due, Trigger& trigger)
+	{
+		due = -1;
+		return policy.Add(bytes, now, due, trigger);
+	}
+}
+
+TEST(FlushPolicy_FirstHitArmsOneTimer)
+{
+	FlushPolicy policy(10, 1000, 30 * Second);
+	long long due;
+	Trigger trigger;
+	CHECK_EQUAL(-1LL, policy.GetDue());
+	CHECK(Add(policy, 10, 5 * Second, due, trigger) == Action::ArmTimer);
+	CHECK_EQUAL(35 * Second, due);
+	CHECK(trigger == Trigger::Age);
+	CHECK(Add(policy, 10, 6 * Second, due, trigger) == Action::None);
+	CHECK_EQUAL(35 * Second, policy.GetDue());
+}
+
+TEST(FlushPolicy_FlushesOnceAtHitOrByteThreshold)
+{
+	FlushPolicy policy(3, 0, 30 * Second);
+	long long due;
+	Trigger trigger;
+	Add(policy, 10, 0, due, trigger);
+	Add(policy, 10, 0, due, trigger);
+	CHECK(Add(policy, 10, 0, due, trigger) == Action::FlushNow);
+	CHECK(trigger == Trigger::HitCount);
+	// the flush already asked for covers the hits queued until it runs
+	CHECK(Add(policy, 10, 0, due, trigger) == Action::None);
+
+	FlushPolicy bytePolicy(0, 100, 0);
+	CHECK(Add(bytePolicy, 60, 0, due, trigger) == Action::None);
+	CHECK(Add(bytePolicy, 40, 0, due, trigger) == Action::FlushNow);
+	CHECK(trigger == Trigger::ByteCount);
+}
+
+TEST(FlushPolicy_ResetClosesTheCycle)
+{
+	FlushPolicy policy(3, 0, 30 * Second);
+	long long due;
+	Trigger trigger;
+	Add(policy, 10, 0, due, trigger);
+	Add(policy, 10, 0, due, trigger);
+	policy.Reset();
+	CHECK_EQUAL(-1LL, policy.GetDue());
+	// counting starts over and the next hit opens a cycle of its own
+	CHECK(Add(policy, 10, 40 * Second, due, trigger) == Action::ArmTimer);
+	CHECK_EQUAL(70 * Second, due);
+	CHECK(Add(policy, 10, 40 * Second, due, trigger) == Action::None);
+	CHECK(Add(policy, 10, 40 * Second, due, trigger) == Action::FlushNow);
+}
+
+TEST(FlushPolicy_HoldWithoutHitsLeavesTheCycleClosed)
+{
+	FlushPolicy policy(3, 0, 30 * Second);
+	long long due = -1;
+	policy.Reset();
+	CHECK(policy.Hold(0, 0, -1, 10 * Second, due) == Action::None);
+	CHECK_EQUAL(-1LL, due);
+	CHECK_EQUAL(-1LL, policy.GetDue());
+}
+
+TEST(FlushPolicy_HoldAgesFromTheOldestHit)
+{
+	FlushPolicy policy(10, 0, 30 * Second);
+	long long due;
+	policy.Reset();
+	CHECK(policy.Hold(2, 20, 5 * Second, 20 * Second, due) == Action::ArmTimer);
+	CHECK_EQUAL(35 * Second, due);
+	CHECK_EQUAL(35 * Second, policy.GetDue());
+
+	// the hits left behind count toward the thresholds of the held cycle
+	Trigger trigger;
+	for (int i = 0; i < 7; i++)
+	{
+		CHECK(Add(policy, 10, 21 * Second, due, trigger) == Action::None);
+	}
+	CHECK(Add(policy, 10, 21 * Second, due, trigger) == Action::FlushNow);
+}
+
+TEST(FlushPolicy_HoldWaitsAtLeastMinHoldDelay)
+{
+	FlushPolicy policy(0, 0, 30 * Second);
+	long long due;
+	policy.Reset();
+	// long overdue hits are not tried again right away
+	CHECK(policy.Hold(1, 10, 0, 100 * Second, due) == Action::ArmTimer);
+	CHECK_EQUAL(100 * Second + FlushPolicy::MinHoldDelay, due);
+	CHECK_EQUAL(due, policy.GetDue());
+
+	// nor later than MaxAge, when that is shorter
+	FlushPolicy shortPolicy(0, 0, Second / 2);
+	CHECK(shortPolicy.Hold(1, 10, 0, 100 * Second, due) == Action::ArmTimer);
+	CHECK_EQUAL(100 * Second + Second / 2, due);
+}
+
+TEST(FlushPolicy_HoldKeepsTheEarliestOpening)
+{
+	FlushPolicy policy(0, 0, 30 * Second);
+	long long due;
+	Trigger trigger;
+	policy.Reset();
+	// a hit queued while the flush ran opened the cycle before the flush finished
+	Add(policy, 10, 12 * Second, due, trigger);
+	CHECK(policy.Hold(3, 30, 15 * Second, 16 * Second, due) == Action::ArmTimer);
+	CHECK_EQUAL(42 * Second, due);
+	CHECK(policy.Hold(3, 30, 2 * Second, 16 * Second, due) == Action::ArmTimer);
+	CHECK_EQUAL(32 * Second, due);
+}
+
+TEST(FlushPolicy_HoldAtThresholdDoesNotFlushAgain)
+{
+	FlushPolicy policy(3, 100, 30 * Second);
+	long long due;
+	Trigger trigger;
+	policy.Reset();
+	// throttled hits over the thresholds wait for the timer instead of being flushed on every hit
+	CHECK(policy.Hold(5, 50, 0, Second, due) == Action::ArmTimer);
+	CHECK(Add(policy, 10, 2 * Second, due, trigger) == Action::None);
+	CHECK(Add(policy, 100, 2 * Second, due, trigger) == Action::None);
+	CHECK_EQUAL(30 * Second, policy.GetDue());
+
+	// without age as a trigger, nothing is armed
+	FlushPolicy countPolicy(3, 0, 0);
+	CHECK(countPolicy.Hold(1, 10, 0, Second, due) == Action::None);
+	CHECK_EQUAL(-1LL, countPolicy.GetDue());
+	CHECK(Add(countPolicy, 10, 2 * Second, due, trigger) == Action::None);
+	CHECK(Add(countPolicy, 10, 2 * Second, due, trigger) == Action::FlushNow);
+}
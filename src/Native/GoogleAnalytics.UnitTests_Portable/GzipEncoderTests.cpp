@@ -0,0 +1,164 @@
+//
+// GzipEncoderTests.cpp
+// Round trips of GzipEncoder output through zlib.
+//
+
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "GzipEncoder.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	std::string Compress(const std::vector<std::string>& writes)
+	{
+		std::string output;
+		GzipEncoder encoder(output);
+		for (auto it = writes.begin(); it != writes.end(); ++it)
+		{
+			encoder.Write(*it);
+		}
+		encoder.Finish();
+		return output;
+	}
+
+#ifdef HAVE_ZLIB
+	// inflates a gzip stream, checking its CRC and length trailer; returns false if zlib rejects it
+	bool Decompress(const std::string& compressed, std::string& result)
+	{
+		z_stream stream = z_stream();
+		if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) return false;
+		stream.next_in = (Bytef*)compressed.data();
+		stream.avail_in = (uInt)compressed.size();
+		char buffer[4096];
+		int status;
+		result.clear();
+		do
+		{
+			stream.next_out = (Bytef*)buffer;
+			stream.avail_out = sizeof(buffer);
+			status = inflate(&stream, Z_NO_FLUSH);
+			if (status != Z_OK && status != Z_STREAM_END) break;
+			result.append(buffer, sizeof(buffer) - stream.avail_out);
+		} while (status != Z_STREAM_END);
+		bool isConsumed = stream.avail_in == 0;
+		inflateEnd(&stream);
+		return status == Z_STREAM_END && isConsumed;
+	}
+
+	void CheckRoundTrip(const std::vector<std::string>& writes)
+	{
+		std::string expected;
+		for (auto it = writes.begin(); it != writes.end(); ++it)
+		{
+			expected += *it;
+		}
+		std::string inflated;
+		CHECK(Decompress(Compress(writes), inflated));
+		CHECK(inflated == expected);
+	}
+#endif
+
+	std::string MakePayload(int i)
+	{
+		return "v=1&tid=UA-12345-1&cid=35009a79-1a05-49d7-b876-2b884d0f825b&t=event&ec=video&ea=play&el=clip" + std::to_string(i) + "&ev=" + std::to_string(i * 7) + "\n";
+	}
+}
+
+TEST(GzipEncoder_WritesGzipHeader)
+{
+	auto output = Compress(std::vector<std::string>(1, "hello"));
+	CHECK(output.size() >= 18);
+	CHECK_EQUAL(0x1F, (unsigned char)output[0]);
+	CHECK_EQUAL(0x8B, (unsigned char)output[1]);
+	// deflate
+	CHECK_EQUAL(8, output[2]);
+	// the trailer ends with the input size
+	CHECK_EQUAL(5, output[output.size() - 4]);
+}
+
+TEST(GzipEncoder_CompressesRepeatedPayloads)
+{
+	std::vector<std::string> writes;
+	size_t inputSize = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		writes.push_back(MakePayload(i));
+		inputSize += writes.back().size();
+	}
+	CHECK(Compress(writes).size() * 3 < inputSize);
+}
+
+#ifdef HAVE_ZLIB
+TEST(GzipEncoder_RoundTripsEmptyInput)
+{
+	CheckRoundTrip(std::vector<std::string>());
+	CheckRoundTrip(std::vector<std::string>(1, std::string()));
+}
+
+TEST(GzipEncoder_RoundTripsShortInput)
+{
+	CheckRoundTrip(std::vector<std::string>(1, "a"));
+	CheckRoundTrip(std::vector<std::string>(1, "v=1&t=pageview"));
+}
+
+TEST(GzipEncoder_RoundTripsBatchWrittenHitByHit)
+{
+	std::vector<std::string> writes;
+	for (int i = 0; i < 20; i++)
+	{
+		writes.push_back(MakePayload(i));
+	}
+	CheckRoundTrip(writes);
+}
+
+TEST(GzipEncoder_RoundTripsLongRuns)
+{
+	// matches are at most 258 bytes long and reach back at most 32KB
+	CheckRoundTrip(std::vector<std::string>(1, std::string(100000, 'x')));
+	std::string pattern;
+	for (int i = 0; i < 5000; i++)
+	{
+		pattern += "abcdefghij" + std::to_string(i % 37);
+	}
+	CheckRoundTrip(std::vector<std::string>(1, pattern));
+}
+
+TEST(GzipEncoder_RoundTripsRandomBytes)
+{
+	std::mt19937 random(12345);
+	std::string data;
+	for (int i = 0; i < 70000; i++)
+	{
+		data.push_back((char)(random() & 0xFF));
+	}
+	CheckRoundTrip(std::vector<std::string>(1, data));
+
+	// split at arbitrary points, so matches span writes
+	std::vector<std::string> writes;
+	for (size_t position = 0; position < data.size();)
+	{
+		size_t length = (std::min)(data.size() - position, (size_t)(random() % 3000));
+		writes.push_back(data.substr(position, length));
+		position += length;
+	}
+	CheckRoundTrip(writes);
+}
+
+TEST(GzipEncoder_RoundTripsSmallAlphabet)
+{
+	std::mt19937 random(7);
+	std::string data;
+	for (int i = 0; i < 50000; i++)
+	{
+		data.push_back("ab&="[random() % 4]);
+	}
+	CheckRoundTrip(std::vector<std::string>(1, data));
+}
+#endif
@@ -0,0 +1,182 @@
+//
+// HitAggregatorTests.cpp
+// Tests of HitAggregator grouping, windows and merged values.
+//
+
+#include <cwchar>
+#include <initializer_list>
+#include <string>
+#include "TestHarness.h"
+#include "HitAggregator.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const long long Second = 1000000000LL;
+
+	struct Parameter
+	{
+		const wchar_t* Key;
+		const wchar_t* Value;
+	};
+
+	HitRecord MakeRecord(std::initializer_list<Parameter> parameters)
+	{
+		HitRecord record;
+		for (auto& parameter : parameters)
+		{
+			record.Set(parameter.Key, std::wcslen(parameter.Key), parameter.Value, std::wcslen(parameter.Value));
+		}
+		return record;
+	}
+
+	std::wstring Get(const HitRecord& record, const wchar_t* key)
+	{
+		const wchar_t* value;
+		size_t valueLength;
+		return record.TryGet(key, std::wcslen(key), value, valueLength) ? std::wstring(value, valueLength) : L"<none>";
+	}
+
+	HitAggregator::Rule MakeRule(long long window, unsigned int countMetricIndex, unsigned int minMetricIndex = 0, unsigned int maxMetricIndex = 0)
+	{
+		HitAggregator::Rule rule;
+		rule.Window = window;
+		rule.CountMetricIndex = countMetricIndex;
+		rule.MinMetricIndex = minMetricIndex;
+		rule.MaxMetricIndex = maxMetricIndex;
+		return rule;
+	}
+
+	bool Add(HitAggregator& aggregator, const HitRecord& record, long long now)
+	{
+		bool isNewGroup;
+		long long due;
+		return aggregator.TryAdd(record, now / 100, now, now, isNewGroup, due);
+	}
+}
+
+TEST(HitAggregator_IgnoresHitsWithoutRule)
+{
+	HitAggregator aggregator;
+	CHECK(!aggregator.HasRules());
+	aggregator.SetRule(L"Game", false, MakeRule(10 * Second, 1));
+	CHECK(aggregator.HasRules());
+	CHECK(!Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Menu" }, { L"ea", L"Open" } }), 0));
+	CHECK(!Add(aggregator, MakeRecord({ { L"t", L"screenview" }, { L"cd", L"Game" } }), 0));
+	// timings of a category are merged by a rule of their own
+	CHECK(!Add(aggregator, MakeRecord({ { L"t", L"timing" }, { L"utc", L"Game" }, { L"utv", L"Load" }, { L"utt", L"5" } }), 0));
+	aggregator.SetRule(L"Game", false, MakeRule(0, 1));
+	CHECK(!aggregator.HasRules());
+}
+
+TEST(HitAggregator_GroupsIgnoringValueQueueTimeCacheBusterAndCount)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Game", false, MakeRule(10 * Second, 3));
+	bool isNewGroup;
+	long long due;
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Hit" }, { L"ev", L"1" }, { L"qt", L"10" }, { L"z", L"1" } }), 0, 0, 0, isNewGroup, due));
+	CHECK(isNewGroup);
+	CHECK_EQUAL(10 * Second, due);
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Hit" }, { L"ev", L"2" }, { L"qt", L"20" }, { L"z", L"2" }, { L"cm3", L"7" } }), 0, Second, Second, isNewGroup, due));
+	CHECK(!isNewGroup);
+	CHECK_EQUAL(10 * Second, due);
+	// any other parameter starts a group of its own
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Miss" }, { L"ev", L"4" } }), 0, Second, Second, isNewGroup, due));
+	CHECK(isNewGroup);
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Hit" }, { L"ev", L"8" }, { L"cm4", L"1" } }), 0, Second, Second, isNewGroup, due));
+	CHECK(isNewGroup);
+	CHECK_EQUAL(3u, aggregator.TakeDue(-1).size());
+}
+
+TEST(HitAggregator_TakesGroupsOnceTheirWindowIsOver)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Game", false, MakeRule(10 * Second, 1));
+	CHECK_EQUAL(-1LL, aggregator.GetNextDue());
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Hit" } }), 0));
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Miss" } }), 4 * Second));
+	CHECK_EQUAL(10 * Second, aggregator.GetNextDue());
+
+	CHECK(aggregator.TakeDue(10 * Second - 1).empty());
+	auto due = aggregator.TakeDue(10 * Second);
+	CHECK_EQUAL(1u, due.size());
+	CHECK(Get(due[0].Record, L"ea") == L"Hit");
+	CHECK_EQUAL(14 * Second, aggregator.GetNextDue());
+
+	// a hit after the window closed starts a new group with a window of its own
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Hit" } }), 11 * Second));
+	due = aggregator.TakeDue(14 * Second);
+	CHECK_EQUAL(1u, due.size());
+	CHECK(Get(due[0].Record, L"ea") == L"Miss");
+	CHECK_EQUAL(21 * Second, aggregator.GetNextDue());
+
+	aggregator.Clear();
+	CHECK_EQUAL(-1LL, aggregator.GetNextDue());
+	CHECK(aggregator.TakeDue(-1).empty());
+}
+
+TEST(HitAggregator_SumsEventValuesAndCountsHits)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Game", false, MakeRule(10 * Second, 2));
+	bool isNewGroup;
+	long long due;
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Score" }, { L"ev", L"5" } }), 1234, 100, 100, isNewGroup, due));
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Score" }, { L"ev", L"-2" } }), 5678, 200, 200, isNewGroup, due));
+	CHECK(aggregator.TryAdd(MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Score" } }), 9999, 300, 300, isNewGroup, due));
+
+	auto merged = aggregator.TakeDue(-1);
+	CHECK_EQUAL(1u, merged.size());
+	CHECK(Get(merged[0].Record, L"ev") == L"3");
+	CHECK(Get(merged[0].Record, L"cm2") == L"3");
+	// the merged hit is the first one
+	CHECK_EQUAL(1234LL, merged[0].UniversalTimeStamp);
+	CHECK_EQUAL(100LL, merged[0].MonotonicTimeStamp);
+	CHECK(Get(merged[0].Record, L"ea") == L"Score");
+}
+
+TEST(HitAggregator_LeavesValueOutWhenNoHitHasOne)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Game", false, MakeRule(10 * Second, 1));
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Tap" } }), 0));
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"event" }, { L"ec", L"Game" }, { L"ea", L"Tap" } }), 0));
+	auto merged = aggregator.TakeDue(-1);
+	CHECK_EQUAL(1u, merged.size());
+	CHECK(Get(merged[0].Record, L"ev") == L"<none>");
+	CHECK(Get(merged[0].Record, L"cm1") == L"2");
+}
+
+TEST(HitAggregator_KeepsRoundedMeanOfTimings)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Load", true, MakeRule(10 * Second, 1));
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"timing" }, { L"utc", L"Load" }, { L"utv", L"Level" }, { L"utt", L"100" } }), 0));
+	CHECK(Add(aggregator, MakeRecord({ { L"t", L"timing" }, { L"utc", L"Load" }, { L"utv", L"Level" }, { L"utt", L"201" } }), 0));
+	auto merged = aggregator.TakeDue(-1);
+	CHECK_EQUAL(1u, merged.size());
+	CHECK(Get(merged[0].Record, L"utt") == L"151");
+	CHECK(Get(merged[0].Record, L"cm1") == L"2");
+	// no other statistic unless asked for
+	CHECK_EQUAL(5u, merged[0].Record.Count());
+}
+
+TEST(HitAggregator_ReportsShortestAndLongestTimings)
+{
+	HitAggregator aggregator;
+	aggregator.SetRule(L"Load", true, MakeRule(10 * Second, 1, 2, 3));
+	const wchar_t* times[] = { L"40", L"10", L"70" };
+	for (auto time : times)
+	{
+		// metrics set by an earlier merge do not split the group
+		CHECK(Add(aggregator, MakeRecord({ { L"t", L"timing" }, { L"utc", L"Load" }, { L"utv", L"Level" }, { L"utt", time }, { L"cm2", time }, { L"cm3", time } }), 0));
+	}
+	auto merged = aggregator.TakeDue(-1);
+	CHECK_EQUAL(1u, merged.size());
+	CHECK(Get(merged[0].Record, L"utt") == L"40");
+	CHECK(Get(merged[0].Record, L"cm1") == L"3");
+	CHECK(Get(merged[0].Record, L"cm2") == L"10");
+	CHECK(Get(merged[0].Record, L"cm3") == L"70");
+}
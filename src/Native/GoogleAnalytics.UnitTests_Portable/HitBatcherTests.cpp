@@ -0,0 +1,80 @@
+//
+// HitBatcherTests.cpp
+// Tests of how HitBatcher packs payloads within the limits of the batch endpoint.
+//
+
+#include <vector>
+#include "TestHarness.h"
+#include "HitBatcher.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	size_t BatchBytes(const std::vector<size_t>& batch, const std::vector<size_t>& sizes)
+	{
+		size_t bytes = 0;
+		for (auto it = batch.begin(); it != batch.end(); ++it)
+		{
+			bytes += sizes[*it] + (bytes > 0 ? 1 : 0);
+		}
+		return bytes;
+	}
+}
+
+TEST(HitBatcher_CapsHitsPerBatch)
+{
+	std::vector<size_t> sizes(45, 100);
+	auto batches = HitBatcher().Pack(sizes);
+	CHECK_EQUAL(3u, batches.size());
+	CHECK_EQUAL(20u, batches[0].size());
+	CHECK_EQUAL(20u, batches[1].size());
+	CHECK_EQUAL(5u, batches[2].size());
+}
+
+TEST(HitBatcher_CountsNewlinesAgainstByteLimit)
+{
+	// two payloads of exactly half the limit do not fit with the newline between them
+	std::vector<size_t> sizes(2, HitBatcher::MaxBatchBytes / 2);
+	CHECK_EQUAL(2u, HitBatcher().Pack(sizes).size());
+
+	sizes[1] = HitBatcher::MaxBatchBytes / 2 - 1;
+	auto batches = HitBatcher().Pack(sizes);
+	CHECK_EQUAL(1u, batches.size());
+	CHECK_EQUAL(HitBatcher::MaxBatchBytes, BatchBytes(batches[0], sizes));
+}
+
+TEST(HitBatcher_KeepsOrderAndLimits)
+{
+	std::vector<size_t> sizes;
+	for (size_t i = 0; i < 200; i++)
+	{
+		sizes.push_back(100 + (i * 977) % 8000);
+	}
+	auto batches = HitBatcher().Pack(sizes);
+	size_t next = 0;
+	for (auto batch = batches.begin(); batch != batches.end(); ++batch)
+	{
+		CHECK(batch->size() <= HitBatcher::MaxHitsPerBatch);
+		CHECK(BatchBytes(*batch, sizes) <= HitBatcher::MaxBatchBytes);
+		for (auto index = batch->begin(); index != batch->end(); ++index)
+		{
+			CHECK_EQUAL(next, *index);
+			next++;
+		}
+	}
+	CHECK_EQUAL(sizes.size(), next);
+}
+
+TEST(HitBatcher_SendsOversizedPayloadAlone)
+{
+	std::vector<size_t> sizes;
+	sizes.push_back(10);
+	sizes.push_back(HitBatcher::MaxHitBytes + 1);
+	sizes.push_back(10);
+	auto batches = HitBatcher().Pack(sizes);
+	CHECK_EQUAL(2u, batches.size());
+	CHECK_EQUAL(1u, batches[0].size());
+	CHECK_EQUAL(1u, batches[0][0]);
+	CHECK_EQUAL(2u, batches[1].size());
+}
@@ -0,0 +1,288 @@
+//
+// HitBuilderBenchmarks.cpp
+// Builds screen view, event and 50 product ecommerce hits the way HitBuilder does, and compares the ecommerce hit against the per-call lineage copies it replaced.
+//
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "BenchmarkHarness.h"
+#include "HitBuilderBuffer.h"
+#include "HitRecord.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::Benchmarks;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	// HitBuilder itself is a Windows Runtime class; these mirror its Add, Derive and Build over the same buffer.
+	// A shared immutable string stands in for Platform::String^, which is copied by reference count, and a std::map for Platform::Collections::Map, which wraps one.
+	typedef std::shared_ptr<const std::wstring> String;
+	typedef BasicHitBuilderBuffer<String> Buffer;
+	typedef std::map<std::wstring, String> Parameters;
+
+	const unsigned int ProductCount = 50;
+
+	String MakeString(const std::wstring& value)
+	{
+		return std::make_shared<const std::wstring>(value);
+	}
+
+	void Add(Buffer::Parameters& parameters, KeyId key, const String& value)
+	{
+		if (IsValid(key))
+		{
+			Buffer::Parameter parameter = { key, nullptr, value };
+			parameters.push_back(parameter);
+		}
+	}
+
+	std::wstring GetName(const Buffer::Parameter& parameter)
+	{
+		if (parameter.Name)
+		{
+			return *parameter.Name;
+		}
+		wchar_t name[MaxKeyLength];
+		size_t length = FormatKey(parameter.Key, name);
+		return std::wstring(name, length);
+	}
+
+	struct Builder
+	{
+		std::shared_ptr<Buffer> Entries;
+		size_t Length;
+
+		explicit Builder(const Buffer::Parameters& parameters) : Entries(std::make_shared<Buffer>()), Length(parameters.size())
+		{
+			Entries->Extend(0, parameters);
+		}
+
+		Builder(std::shared_ptr<Buffer> entries, size_t length) : Entries(entries), Length(length)
+		{
+		}
+
+		Builder Derive(const Buffer::Parameters& parameters) const
+		{
+			return Builder(Entries->Extend(Length, parameters), Length + parameters.size());
+		}
+
+		Parameters Build() const
+		{
+			Parameters data;
+			std::unordered_set<KeyId> seen;
+			Entries->ForEachReversed(0, Length, [&](const Buffer::Parameter& parameter) {
+				if (parameter.Key != UnknownKey)
+				{
+					if (seen.insert(parameter.Key).second)
+					{
+						data.emplace(GetName(parameter), parameter.Value);
+					}
+				}
+				else
+				{
+					data.emplace(*parameter.Name, parameter.Value);
+				}
+			});
+			return data;
+		}
+	};
+
+	struct Product
+	{
+		String Id;
+		String Name;
+		String Category;
+		String Price;
+		String Quantity;
+	};
+
+	// the values an app passes in, made once
+	struct Values
+	{
+		String ScreenView = MakeString(L"screenview");
+		String Event = MakeString(L"event");
+		String MainPage = MakeString(L"Main Page");
+		String Video = MakeString(L"Video");
+		String Play = MakeString(L"Play");
+		String Trailer = MakeString(L"Holiday trailer (2 min)");
+		String FortyTwo = MakeString(L"42");
+		String Premium = MakeString(L"premium");
+		String Checkout = MakeString(L"Checkout");
+		String Purchase = MakeString(L"purchase");
+		String PurchaseAction = MakeString(L"Purchase");
+		String TransactionId = MakeString(L"T-12345");
+		String Revenue = MakeString(L"1300.50");
+	};
+
+	const Values& GetValues()
+	{
+		static Values values;
+		return values;
+	}
+
+	const std::vector<Product>& GetProducts()
+	{
+		static std::vector<Product> products;
+		if (products.empty())
+		{
+			for (unsigned int i = 1; i <= ProductCount; i++)
+			{
+				Product product = { MakeString(L"SKU-" + std::to_wstring(10000 + i)), MakeString(L"Product " + std::to_wstring(i)), MakeString(L"Apparel/T-Shirts"),
+					MakeString(std::to_wstring(i) + L".99"), MakeString(L"1") };
+				products.push_back(product);
+			}
+		}
+		return products;
+	}
+
+	Builder BuildScreenView()
+	{
+		Buffer::Parameters data;
+		auto& values = GetValues();
+		Add(data, MakeKey(Parameter::HitType), values.ScreenView);
+		Add(data, MakeKey(Parameter::ScreenName), values.MainPage);
+		return Builder(data);
+	}
+
+	Builder BuildEvent()
+	{
+		Buffer::Parameters data;
+		auto& values = GetValues();
+		Add(data, MakeKey(Parameter::HitType), values.Event);
+		Add(data, MakeKey(Parameter::EventCategory), values.Video);
+		Add(data, MakeKey(Parameter::EventAction), values.Play);
+		Add(data, MakeKey(Parameter::EventLabel), values.Trailer);
+		Add(data, MakeKey(Parameter::EventValue), values.FortyTwo);
+		Buffer::Parameters dimension;
+		Add(dimension, MakeKey(IndexedParameter::CustomDimension, 1), values.Premium);
+		return Builder(data).Derive(dimension);
+	}
+
+	// CreateCustomEvent("Checkout", "Purchase", ...).AddProduct(...) 50 times, then SetProductAction(purchase)
+	Builder BuildPurchase()
+	{
+		Buffer::Parameters data;
+		auto& values = GetValues();
+		Add(data, MakeKey(Parameter::HitType), values.Event);
+		Add(data, MakeKey(Parameter::EventCategory), values.Checkout);
+		Add(data, MakeKey(Parameter::EventAction), values.PurchaseAction);
+		Builder builder(data);
+		unsigned int index = 1;
+		for (auto& product : GetProducts())
+		{
+			Buffer::Parameters fields;
+			Add(fields, MakeKey(IndexedParameter::ProductSku, index), product.Id);
+			Add(fields, MakeKey(IndexedParameter::ProductName, index), product.Name);
+			Add(fields, MakeKey(IndexedParameter::ProductCategory, index), product.Category);
+			Add(fields, MakeKey(IndexedParameter::ProductPrice, index), product.Price);
+			Add(fields, MakeKey(IndexedParameter::ProductQuantity, index), product.Quantity);
+			builder = builder.Derive(fields);
+			index++;
+		}
+		Buffer::Parameters action;
+		Add(action, MakeKey(Parameter::ProductAction), values.Purchase);
+		Add(action, MakeKey(Parameter::TransactionId), values.TransactionId);
+		Add(action, MakeKey(Parameter::TransactionRevenue), values.Revenue);
+		return builder.Derive(action);
+	}
+
+	// what Tracker::Send does with the built parameters: Hit::ToRecord sizes the record once, then copies every pair into it
+	HitRecord ToRecord(const Parameters& data)
+	{
+		HitRecord record;
+		size_t characterCount = 0;
+		for (auto& kvp : data)
+		{
+			characterCount += kvp.first.size() + kvp.second->size();
+		}
+		record.Reserve(data.size(), characterCount);
+		for (auto& kvp : data)
+		{
+			record.Set(kvp.first.data(), kvp.first.size(), kvp.second->data(), kvp.second->size());
+		}
+		return record;
+	}
+}
+
+BENCHMARK(HitBuilder_ScreenView)
+{
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto data = BuildScreenView().Build();
+		KeepAlive(&data);
+	}
+}
+
+BENCHMARK(HitBuilder_Event)
+{
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto data = BuildEvent().Build();
+		KeepAlive(&data);
+	}
+}
+
+BENCHMARK(HitBuilder_Ecommerce50Products)
+{
+	GetProducts();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto data = BuildPurchase().Build();
+		KeepAlive(&data);
+	}
+}
+
+BENCHMARK(HitBuilder_Ecommerce50ProductsLineage)
+{
+	// what building did before: every call copied the lineage so far and its own map, and Build replayed each ancestor's map
+	GetProducts();
+	auto& values = GetValues();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		std::vector<std::shared_ptr<Parameters>> lineage;
+		auto extend = [&lineage](const Parameters& data) {
+			std::vector<std::shared_ptr<Parameters>> copy(lineage);
+			copy.push_back(std::make_shared<Parameters>(data));
+			lineage.swap(copy);
+		};
+		extend(Parameters { { L"t", values.Event }, { L"ec", values.Checkout }, { L"ea", values.PurchaseAction } });
+		unsigned int index = 1;
+		for (auto& product : GetProducts())
+		{
+			auto prefix = L"pr" + std::to_wstring(index);
+			extend(Parameters { { prefix + L"id", product.Id }, { prefix + L"nm", product.Name }, { prefix + L"ca", product.Category }, { prefix + L"pr", product.Price }, { prefix + L"qt", product.Quantity } });
+			index++;
+		}
+		extend(Parameters { { L"pa", values.Purchase }, { L"ti", values.TransactionId }, { L"tr", values.Revenue } });
+
+		Parameters data;
+		for (auto& ancestor : lineage)
+		{
+			for (auto& kvp : *ancestor)
+			{
+				auto found = data.find(kvp.first);
+				if (found != data.end())
+				{
+					data.erase(found);
+				}
+				data.insert(kvp);
+			}
+		}
+		KeepAlive(&data);
+	}
+}
+
+BENCHMARK(HitBuilder_Ecommerce50ProductsToRecord)
+{
+	// the whole path from the fluent calls to the record Tracker::Send hands to the manager
+	GetProducts();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto record = ToRecord(BuildPurchase().Build());
+		KeepAlive(&record);
+	}
+}
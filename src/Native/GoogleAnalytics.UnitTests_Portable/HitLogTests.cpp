@@ -0,0 +1,337 @@
+//
+// HitLogTests.cpp
+// Tests of HitLog recovery, torn and corrupt records, and compaction.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include "TestHarness.h"
+#include "HitLog.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	// segments kept in memory; the contents outlive the store, so a log can be reopened over them as after a restart
+	struct MemorySegments
+	{
+		std::map<uint32_t, std::string> Segments;
+		uint32_t First = 0;
+	};
+
+	class MemorySegmentStore : public ISegmentStore
+	{
+	private:
+
+		std::shared_ptr<MemorySegments> segments;
+
+	public:
+
+		MemorySegmentStore(std::shared_ptr<MemorySegments> segments) : segments(segments) { }
+
+		virtual uint32_t GetFirstSegment() override { return segments->First; }
+
+		virtual void SetFirstSegment(uint32_t segment) override { segments->First = segment; }
+
+		virtual bool Exists(uint32_t segment) override { return segments->Segments.count(segment) != 0; }
+
+		virtual bool Read(uint32_t segment, std::string& contents) override
+		{
+			auto it = segments->Segments.find(segment);
+			if (it == segments->Segments.end()) return false;
+			contents = it->second;
+			return true;
+		}
+
+		virtual bool Append(uint32_t segment, const char* data, size_t length) override
+		{
+			segments->Segments[segment].append(data, length);
+			return true;
+		}
+
+		virtual void Remove(uint32_t segment) override { segments->Segments.erase(segment); }
+	};
+
+	std::unique_ptr<HitLog> OpenLog(std::shared_ptr<MemorySegments> segments, size_t maxSegmentBytes = HitLog::DefaultSegmentBytes)
+	{
+		return std::unique_ptr<HitLog>(new HitLog(std::unique_ptr<ISegmentStore>(new MemorySegmentStore(segments)), maxSegmentBytes));
+	}
+
+	HitRecord MakeRecord(const std::wstring& page)
+	{
+		HitRecord record;
+		record.Set(L"t", 1, L"screenview", 10);
+		record.Set(L"cd", 2, page.data(), page.size());
+		return record;
+	}
+
+	std::wstring GetScreen(const LoggedHit& hit)
+	{
+		const wchar_t* value;
+		size_t length;
+		return hit.Record.TryGet(L"cd", 2, value, length) ? std::wstring(value, length) : std::wstring();
+	}
+
+	uint64_t Append(HitLog& log, const std::wstring& page, long long timeStamp = 0)
+	{
+		bool isFirstPending;
+		return log.Append(MakeRecord(page), timeStamp, isFirstPending);
+	}
+
+	void Acknowledge(HitLog& log, uint64_t sequence)
+	{
+		bool isFirstPending;
+		log.Acknowledge(sequence, isFirstPending);
+	}
+}
+
+TEST(HitLog_RecoversUnacknowledgedHitsInOrder)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments);
+		CHECK(log->Recover().empty());
+		Append(*log, L"first", 1000);
+		auto second = Append(*log, L"second", 2000);
+		Append(*log, L"third", 3000);
+		Acknowledge(*log, second);
+		log->Commit();
+	}
+
+	auto log = OpenLog(segments);
+	auto hits = log->Recover();
+	CHECK_EQUAL(2u, hits.size());
+	CHECK(GetScreen(hits[0]) == L"first");
+	CHECK_EQUAL(1000LL, hits[0].TimeStamp);
+	CHECK(GetScreen(hits[1]) == L"third");
+	CHECK_EQUAL(3000LL, hits[1].TimeStamp);
+	CHECK(hits[0].Sequence < hits[1].Sequence);
+
+	// sequence numbers carry on after the recovered ones
+	CHECK(Append(*log, L"fourth") > hits[1].Sequence);
+}
+
+TEST(HitLog_UncommittedHitsAreNotDurable)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments);
+		log->Recover();
+		Append(*log, L"committed");
+		log->Commit();
+		Append(*log, L"pending");
+	}
+	auto hits = OpenLog(segments)->Recover();
+	CHECK_EQUAL(1u, hits.size());
+	CHECK(GetScreen(hits[0]) == L"committed");
+}
+
+TEST(HitLog_IgnoresTornTail)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments);
+		log->Recover();
+		Append(*log, L"whole");
+		log->Commit();
+		Append(*log, L"torn");
+		log->Commit();
+	}
+	CHECK_EQUAL(1u, segments->Segments.size());
+	std::string& contents = segments->Segments[0];
+	std::string intact = contents;
+
+	// a crash can cut the last write anywhere, including inside its header
+	for (size_t cut = 1; cut < 40; cut++)
+	{
+		contents = intact.substr(0, intact.size() - cut);
+		auto hits = OpenLog(segments)->Recover();
+		CHECK_EQUAL(1u, hits.size());
+		if (!hits.empty()) CHECK(GetScreen(hits[0]) == L"whole");
+	}
+}
+
+TEST(HitLog_StopsAtCorruptRecord)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments);
+		log->Recover();
+		Append(*log, L"good");
+		log->Commit();
+		Append(*log, L"corrupt");
+		log->Commit();
+	}
+	std::string& contents = segments->Segments[0];
+	// flip a bit in the value of the second hit
+	size_t position = contents.rfind('c');
+	CHECK(position != std::string::npos);
+	contents[position] ^= 0x01;
+
+	auto log = OpenLog(segments);
+	auto hits = log->Recover();
+	CHECK_EQUAL(1u, hits.size());
+	if (!hits.empty()) CHECK(GetScreen(hits[0]) == L"good");
+
+	// new records never follow a damaged tail
+	Append(*log, L"after");
+	log->Commit();
+	CHECK_EQUAL(2u, segments->Segments.size());
+	hits = OpenLog(segments)->Recover();
+	CHECK_EQUAL(2u, hits.size());
+	if (hits.size() == 2) CHECK(GetScreen(hits[1]) == L"after");
+}
+
+TEST(HitLog_CorruptLengthDoesNotOverrun)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments);
+		log->Recover();
+		Append(*log, L"hit");
+		log->Commit();
+	}
+	// a body length far beyond the end of the segment
+	segments->Segments[0][3] = (char)0x7F;
+	CHECK(OpenLog(segments)->Recover().empty());
+}
+
+TEST(HitLog_KeepsSurrogatePairs)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	std::wstring page = L"smile ";
+	if (sizeof(wchar_t) > 2)
+	{
+		page += (wchar_t)0x1F600;
+	}
+	else
+	{
+		page += (wchar_t)0xD83D;
+		page += (wchar_t)0xDE00;
+	}
+	{
+		auto log = OpenLog(segments);
+		log->Recover();
+		Append(*log, page);
+		log->Commit();
+	}
+	auto hits = OpenLog(segments)->Recover();
+	CHECK_EQUAL(1u, hits.size());
+	if (!hits.empty()) CHECK(GetScreen(hits[0]) == page);
+}
+
+TEST(HitLog_CompactionDropsAcknowledgedSegments)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	std::vector<uint64_t> sequences;
+	{
+		auto log = OpenLog(segments, 256);
+		log->Recover();
+		for (int i = 0; i < 40; i++)
+		{
+			sequences.push_back(Append(*log, L"page" + std::to_wstring(i)));
+			log->Commit();
+		}
+		CHECK(segments->Segments.size() > 4);
+		// all but the last hit go through
+		for (size_t i = 0; i + 1 < sequences.size(); i++)
+		{
+			Acknowledge(*log, sequences[i]);
+		}
+		log->Commit();
+		log->Compact();
+	}
+	CHECK(segments->First > 0);
+	CHECK(segments->Segments.size() <= 2);
+	auto hits = OpenLog(segments, 256)->Recover();
+	CHECK_EQUAL(1u, hits.size());
+	if (!hits.empty()) CHECK(GetScreen(hits[0]) == L"page39");
+}
+
+TEST(HitLog_CompactionMovesLiveHitsForward)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments, 512);
+		log->Recover();
+		std::vector<uint64_t> sequences;
+		for (int i = 0; i < 30; i++)
+		{
+			sequences.push_back(Append(*log, L"page" + std::to_wstring(i)));
+			log->Commit();
+		}
+		// only the first hit is still unsent: its segment is mostly acknowledged
+		for (size_t i = 1; i < sequences.size(); i++)
+		{
+			Acknowledge(*log, sequences[i]);
+		}
+		log->Commit();
+		log->Compact();
+	}
+	CHECK(segments->First > 0);
+	auto hits = OpenLog(segments, 512)->Recover();
+	CHECK_EQUAL(1u, hits.size());
+	if (!hits.empty()) CHECK(GetScreen(hits[0]) == L"page0");
+}
+
+TEST(HitLog_RemovesSegmentsLeftBehindByInterruptedCompaction)
+{
+	auto segments = std::make_shared<MemorySegments>();
+	{
+		auto log = OpenLog(segments, 128);
+		log->Recover();
+		for (int i = 0; i < 6; i++)
+		{
+			Append(*log, L"page" + std::to_wstring(i));
+			log->Commit();
+		}
+	}
+	// the head moved past segment 0, but the process died before removing it
+	segments->First = 1;
+	auto hits = OpenLog(segments, 128)->Recover();
+	CHECK(segments->Segments.count(0) == 0);
+	for (auto it = hits.begin(); it != hits.end(); ++it)
+	{
+		CHECK(GetScreen(*it) != L"page0");
+	}
+}
+
+#ifndef _WIN32
+TEST(HitLog_RecoversFromDirectory)
+{
+	char directory[] = "/tmp/GoogleAnalyticsTestsXXXXXX";
+	CHECK(mkdtemp(directory) != nullptr);
+	std::string path = std::string(directory) + "/log";
+	{
+		HitLog log(std::unique_ptr<ISegmentStore>(new DirectorySegmentStore(path)));
+		log.Recover();
+		Append(log, L"on disk", 42);
+		log.Commit();
+	}
+	{
+		HitLog log(std::unique_ptr<ISegmentStore>(new DirectorySegmentStore(path)));
+		auto hits = log.Recover();
+		CHECK_EQUAL(1u, hits.size());
+		if (!hits.empty())
+		{
+			CHECK(GetScreen(hits[0]) == L"on disk");
+			CHECK_EQUAL(42LL, hits[0].TimeStamp);
+			Acknowledge(log, hits[0].Sequence);
+			log.Commit();
+		}
+	}
+	{
+		HitLog log(std::unique_ptr<ISegmentStore>(new DirectorySegmentStore(path)));
+		CHECK(log.Recover().empty());
+	}
+	std::string command = std::string("rm -rf ") + directory;
+	CHECK(std::system(command.c_str()) == 0);
+}
+#endif
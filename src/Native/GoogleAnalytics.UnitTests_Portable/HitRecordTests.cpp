@@ -0,0 +1,98 @@
+//
+// HitRecordTests.cpp
+// Tests of HitRecord storage and lookups.
+//
+
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "HitRecord.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	std::wstring Get(const HitRecord& record, const std::wstring& key)
+	{
+		const wchar_t* value;
+		size_t length;
+		return record.TryGet(key.data(), key.size(), value, length) ? std::wstring(value, length) : L"<missing>";
+	}
+}
+
+TEST(HitRecord_KeepsFirstSetOrder)
+{
+	HitRecord record;
+	record.Set(L"t", 1, L"event", 5);
+	record.Set(L"x-custom", 8, L"1", 1);
+	record.Set(L"cd12", 4, L"dim", 3);
+	record.Set(L"t", 1, L"screenview", 10);
+	std::vector<std::wstring> keys;
+	record.ForEach([&keys](const wchar_t* key, size_t keyLength, const wchar_t*, size_t) {
+		keys.push_back(std::wstring(key, keyLength));
+	});
+	CHECK_EQUAL(3u, keys.size());
+	CHECK(keys[0] == L"t");
+	CHECK(keys[1] == L"x-custom");
+	CHECK(keys[2] == L"cd12");
+	CHECK(Get(record, L"t") == L"screenview");
+	CHECK(Get(record, L"cd12") == L"dim");
+	CHECK(Get(record, L"cd13") == L"<missing>");
+
+	const wchar_t* value;
+	size_t length;
+	CHECK(record.TryGet(MeasurementProtocol::Parameter::HitType, value, length));
+	CHECK(std::wstring(value, length) == L"screenview");
+}
+
+TEST(HitRecord_StaysBoundedWhenSetRepeatedly)
+{
+	HitRecord record;
+	record.Set(L"cd", 2, L"home", 4);
+	record.Set(L"custom", 6, L"x", 1);
+	size_t largest = 0;
+	for (int i = 0; i < 100000; i++)
+	{
+		std::wstring value(i % 64 + 1, L'a' + (wchar_t)(i % 26));
+		record.Set(L"cd", 2, value.data(), value.size());
+		record.Set(L"custom", 6, value.data(), value.size());
+		CHECK(Get(record, L"cd") == value);
+		CHECK(Get(record, L"custom") == value);
+		largest = (std::max)(largest, record.ByteSize());
+	}
+	CHECK(largest < 4096);
+}
+
+TEST(HitRecord_FindsIndexedKeysAmongMany)
+{
+	HitRecord record;
+	for (int product = 1; product <= 200; product++)
+	{
+		std::wstring id = L"pr" + std::to_wstring(product) + L"id";
+		std::wstring quantity = L"pr" + std::to_wstring(product) + L"qt";
+		std::wstring value = L"sku" + std::to_wstring(product);
+		record.Set(id.data(), id.size(), value.data(), value.size());
+		record.Set(quantity.data(), quantity.size(), L"1", 1);
+	}
+	record.Set(L"x-custom", 8, L"1", 1);
+	record.Set(L"pr7id", 5, L"replaced", 8);
+	record.Set(L"il1pi2cd3", 9, L"three levels", 12);
+
+	CHECK_EQUAL((size_t)402, record.Count());
+	CHECK(Get(record, L"pr7id") == L"replaced");
+	CHECK(Get(record, L"pr200id") == L"sku200");
+	CHECK(Get(record, L"pr200qt") == L"1");
+	CHECK(Get(record, L"pr201id") == L"<missing>");
+	CHECK(Get(record, L"x-custom") == L"1");
+	CHECK(Get(record, L"il1pi2cd3") == L"three levels");
+
+	// set order is kept, whatever the order of the index
+	std::vector<std::wstring> keys;
+	record.ForEach([&](const wchar_t* key, size_t keyLength, const wchar_t*, size_t) {
+		keys.push_back(std::wstring(key, keyLength));
+	});
+	CHECK(keys[0] == L"pr1id");
+	CHECK(keys[1] == L"pr1qt");
+	CHECK(keys[2] == L"pr2id");
+	CHECK(keys[400] == L"x-custom");
+}
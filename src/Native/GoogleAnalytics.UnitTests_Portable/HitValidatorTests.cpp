@@ -0,0 +1,155 @@
+//
+// HitValidatorTests.cpp
+// Tests of the Measurement Protocol rules checked by HitValidator, and of reading /debug/collect responses.
+//
+
+#include <string>
+#include "TestHarness.h"
+#include "HitValidator.h"
+#include "DebugResponseParser.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	void Set(HitRecord& record, const std::wstring& key, const std::wstring& value)
+	{
+		record.Set(key.data(), key.size(), value.data(), value.size());
+	}
+
+	HitRecord MakeHit(const std::wstring& hitType)
+	{
+		HitRecord record;
+		Set(record, L"v", L"1");
+		Set(record, L"tid", L"UA-12345-1");
+		Set(record, L"cid", L"35009a79-1a05-49d7-b876-2b884d0f825b");
+		Set(record, L"t", hitType);
+		return record;
+	}
+
+	bool HasMessage(const ValidationResult& result, const wchar_t* code, const wchar_t* parameter)
+	{
+		for (auto it = result.Messages.begin(); it != result.Messages.end(); ++it)
+		{
+			if (it->Code == code && it->Parameter == parameter) return true;
+		}
+		return false;
+	}
+}
+
+TEST(HitValidator_AcceptsCompleteHits)
+{
+	auto pageview = MakeHit(L"pageview");
+	auto result = HitValidator::Validate(pageview);
+	CHECK(result.IsValid);
+	CHECK(result.Messages.empty());
+
+	auto event = MakeHit(L"event");
+	Set(event, L"ec", L"video");
+	Set(event, L"ea", L"play");
+	Set(event, L"ev", L"42");
+	Set(event, L"cd7", L"dimension");
+	Set(event, L"x-unknown", L"ignored");
+	CHECK(HitValidator::Validate(event).IsValid);
+}
+
+TEST(HitValidator_RequiresCoreParameters)
+{
+	HitRecord record;
+	Set(record, L"t", L"pageview");
+	auto result = HitValidator::Validate(record);
+	CHECK(!result.IsValid);
+	CHECK(HasMessage(result, L"VALUE_REQUIRED", L"v"));
+	CHECK(HasMessage(result, L"VALUE_REQUIRED", L"tid"));
+	CHECK(HasMessage(result, L"VALUE_REQUIRED", L"cid"));
+
+	// a user id stands in for the client id
+	auto withUserId = MakeHit(L"pageview");
+	HitRecord noClient;
+	withUserId.ForEach([&noClient](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+		if (std::wstring(key, keyLength) != L"cid") noClient.Set(key, keyLength, value, valueLength);
+	});
+	Set(noClient, L"uid", L"user");
+	CHECK(HitValidator::Validate(noClient).IsValid);
+}
+
+TEST(HitValidator_RequiresHitTypeParameters)
+{
+	auto event = MakeHit(L"event");
+	Set(event, L"ec", L"video");
+	auto result = HitValidator::Validate(event);
+	CHECK(!result.IsValid);
+	CHECK(HasMessage(result, L"VALUE_REQUIRED", L"ea"));
+
+	auto timing = MakeHit(L"timing");
+	Set(timing, L"utc", L"load");
+	Set(timing, L"utv", L"page");
+	result = HitValidator::Validate(timing);
+	CHECK(HasMessage(result, L"VALUE_REQUIRED", L"utt"));
+}
+
+TEST(HitValidator_ChecksValueFormats)
+{
+	auto hit = MakeHit(L"pageview");
+	Set(hit, L"tid", L"UA-12345");
+	CHECK(HasMessage(HitValidator::Validate(hit), L"VALUE_INVALID", L"tid"));
+
+	hit = MakeHit(L"bogus");
+	CHECK(HasMessage(HitValidator::Validate(hit), L"VALUE_INVALID", L"t"));
+
+	hit = MakeHit(L"transaction");
+	Set(hit, L"ti", L"T1");
+	Set(hit, L"tr", L"12.3456789");
+	Set(hit, L"cu", L"eur");
+	auto result = HitValidator::Validate(hit);
+	CHECK(HasMessage(result, L"VALUE_INVALID", L"tr"));
+	CHECK(HasMessage(result, L"VALUE_INVALID", L"cu"));
+
+	hit = MakeHit(L"event");
+	Set(hit, L"ec", L"c");
+	Set(hit, L"ea", L"a");
+	Set(hit, L"ev", L"-1");
+	Set(hit, L"ni", L"2");
+	result = HitValidator::Validate(hit);
+	CHECK(HasMessage(result, L"VALUE_INVALID", L"ev"));
+	CHECK(HasMessage(result, L"VALUE_INVALID", L"ni"));
+}
+
+TEST(HitValidator_ChecksLengthsAndIndices)
+{
+	auto hit = MakeHit(L"pageview");
+	Set(hit, L"cd201", L"out of range");
+	CHECK(HasMessage(HitValidator::Validate(hit), L"VALUE_OUT_OF_BOUNDS", L"cd201"));
+
+	hit = MakeHit(L"pageview");
+	Set(hit, L"cd1", std::wstring(151, L'x'));
+	CHECK(HasMessage(HitValidator::Validate(hit), L"VALUE_OUT_OF_BOUNDS", L"cd1"));
+
+	hit = MakeHit(L"pageview");
+	Set(hit, L"cd1", std::wstring(150, L'x'));
+	CHECK(HitValidator::Validate(hit).IsValid);
+}
+
+TEST(HitValidator_ReadsDebugResponses)
+{
+	std::wstring response =
+		L"{ \"hitParsingResult\": [ {"
+		L"  \"valid\": false, \"parserMessage\": [ { \"messageType\": \"ERROR\", \"description\": \"A value is required for parameter 'tid'.\","
+		L"  \"messageCode\": \"VALUE_REQUIRED\", \"parameter\": \"tid\" } ], \"hit\": \"/debug/collect?v=1\\u0026t=pageview\" },"
+		L"  { \"valid\": true, \"parserMessage\": [], \"hit\": \"/debug/collect?v=1\" } ],"
+		L"  \"parserMessage\": [ { \"messageType\": \"INFO\", \"description\": \"Found 2 hits in the request.\" } ] }";
+	std::vector<ValidationResult> results;
+	CHECK(DebugResponseParser::Parse(response.data(), response.size(), results));
+	CHECK_EQUAL(2u, results.size());
+	if (results.size() == 2)
+	{
+		CHECK(!results[0].IsValid);
+		CHECK(HasMessage(results[0], L"VALUE_REQUIRED", L"tid"));
+		CHECK(results[1].IsValid);
+		CHECK(results[1].Messages.empty());
+	}
+
+	std::wstring truncated = response.substr(0, response.size() / 2);
+	results.clear();
+	CHECK(!DebugResponseParser::Parse(truncated.data(), truncated.size(), results));
+}
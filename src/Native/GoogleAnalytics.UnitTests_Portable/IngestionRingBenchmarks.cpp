@@ -0,0 +1,88 @@
+//
+// IngestionRingBenchmarks.cpp
+// Compares producers contending on the ingestion ring with producers contending on a mutex-guarded queue, the path it replaced.
+//
+
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "BenchmarkHarness.h"
+#include "IngestionRing.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::Benchmarks;
+
+namespace
+{
+	const int ProducerCount = 4;
+
+	// runs ProducerCount threads calling produce(item) for their share of iterations items, while this thread calls consume() until all are taken
+	template <typename Produce, typename Consume>
+	void RunContended(size_t iterations, Produce produce, Consume consume)
+	{
+		size_t share = iterations / ProducerCount + 1;
+		size_t total = share * ProducerCount;
+		std::vector<std::thread> producers;
+		for (int p = 0; p < ProducerCount; p++)
+		{
+			producers.push_back(std::thread([&produce, share, p]() {
+				for (size_t i = 0; i < share; i++)
+				{
+					produce((int)(p * share + i));
+				}
+			}));
+		}
+		size_t consumed = 0;
+		while (consumed < total)
+		{
+			size_t taken = consume();
+			if (taken == 0) std::this_thread::yield();
+			consumed += taken;
+		}
+		for (auto it = producers.begin(); it != producers.end(); ++it)
+		{
+			it->join();
+		}
+	}
+}
+
+BENCHMARK(IngestionRing_MutexQueueContended)
+{
+	std::mutex lock;
+	std::queue<int> queue;
+	RunContended(iterations,
+		[&](int item) {
+			std::lock_guard<std::mutex> lg(lock);
+			queue.push(item);
+		},
+		[&]() {
+			// the dispatcher drains under the same lock the producers take
+			std::lock_guard<std::mutex> lg(lock);
+			size_t taken = queue.size();
+			while (!queue.empty()) queue.pop();
+			return taken;
+		});
+}
+
+BENCHMARK(IngestionRing_RingContended)
+{
+	IngestionRing<int> ring(4096);
+	RunContended(iterations,
+		[&](int item) {
+			while (!ring.TryPush(item))
+			{
+				std::this_thread::yield();
+			}
+		},
+		[&]() {
+			size_t taken = 0;
+			int item;
+			while (ring.TryPop(item))
+			{
+				taken++;
+			}
+			return taken;
+		});
+}
@@ -0,0 +1,143 @@
+//
+// IngestionRingTests.cpp
+// Tests of IngestionRing wraparound, overflow handling and concurrent use.
+//
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "IngestionRing.h"
+
+using namespace GoogleAnalytics;
+
+TEST(IngestionRing_RoundsCapacityUpToPowerOfTwo)
+{
+	CHECK_EQUAL(2u, IngestionRing<int>(1).Capacity());
+	CHECK_EQUAL(8u, IngestionRing<int>(5).Capacity());
+	CHECK_EQUAL(4096u, IngestionRing<int>(4096).Capacity());
+}
+
+TEST(IngestionRing_KeepsOrderAcrossWraparound)
+{
+	IngestionRing<int> ring(4);
+	int next = 0;
+	int expected = 0;
+	// far more items than cells, with the ring at every fill level
+	for (int round = 0; round < 1000; round++)
+	{
+		int pushes = round % 5;
+		for (int i = 0; i < pushes && ring.TryPush(next); i++)
+		{
+			next++;
+		}
+		int pops = (round * 3) % 5;
+		int value;
+		for (int i = 0; i < pops && ring.TryPop(value); i++)
+		{
+			CHECK_EQUAL(expected, value);
+			expected++;
+		}
+		CHECK_EQUAL((size_t)(next - expected), ring.Size());
+	}
+	int value;
+	while (ring.TryPop(value))
+	{
+		CHECK_EQUAL(expected, value);
+		expected++;
+	}
+	CHECK_EQUAL(next, expected);
+}
+
+TEST(IngestionRing_RejectsPushWhenFull)
+{
+	// what QueueOverflowPolicy::DropNewest relies on
+	IngestionRing<int> ring(4);
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK(ring.TryPush(i));
+	}
+	CHECK(!ring.TryPush(4));
+	CHECK_EQUAL(4u, ring.Size());
+	int value;
+	CHECK(ring.TryPop(value));
+	CHECK_EQUAL(0, value);
+	CHECK(ring.TryPush(4));
+}
+
+TEST(IngestionRing_EvictsOldestWhenFull)
+{
+	// what QueueOverflowPolicy::DropOldest does: a producer takes the oldest item out to make room
+	IngestionRing<int> ring(4);
+	std::vector<int> evicted;
+	for (int i = 0; i < 10; i++)
+	{
+		while (!ring.TryPush(i))
+		{
+			int oldest;
+			if (ring.TryPop(oldest))
+			{
+				evicted.push_back(oldest);
+			}
+		}
+	}
+	CHECK_EQUAL(6u, evicted.size());
+	for (int i = 0; i < (int)evicted.size(); i++)
+	{
+		CHECK_EQUAL(i, evicted[i]);
+	}
+	int value;
+	for (int i = 6; i < 10; i++)
+	{
+		CHECK(ring.TryPop(value));
+		CHECK_EQUAL(i, value);
+	}
+	CHECK(!ring.TryPop(value));
+}
+
+TEST(IngestionRing_DeliversEveryItemToOneConsumer)
+{
+	const int Producers = 4;
+	const int ItemsPerProducer = 20000;
+	IngestionRing<int> ring(256);
+	std::atomic<int> done(0);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < Producers; p++)
+	{
+		threads.push_back(std::thread([&ring, &done, p]() {
+			for (int i = 0; i < ItemsPerProducer; i++)
+			{
+				while (!ring.TryPush(p * ItemsPerProducer + i))
+				{
+					std::this_thread::yield();
+				}
+			}
+			done++;
+		}));
+	}
+	std::vector<int> lastSeen(Producers, -1);
+	long long count = 0;
+	bool isOrdered = true;
+	int value;
+	while (done < Producers || ring.Size() != 0)
+	{
+		if (ring.TryPop(value))
+		{
+			int producer = value / ItemsPerProducer;
+			// each producer's items come out in the order it pushed them
+			isOrdered = isOrdered && value > lastSeen[producer];
+			lastSeen[producer] = value;
+			count++;
+		}
+	}
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+	{
+		it->join();
+	}
+	while (ring.TryPop(value))
+	{
+		count++;
+	}
+	CHECK(isOrdered);
+	CHECK_EQUAL((long long)Producers * ItemsPerProducer, count);
+}
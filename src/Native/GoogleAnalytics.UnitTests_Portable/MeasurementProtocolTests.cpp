@@ -0,0 +1,55 @@
+//
+// MeasurementProtocolTests.cpp
+// Tests of the Measurement Protocol parameter vocabulary.
+//
+
+#include <string>
+#include "TestHarness.h"
+#include "MeasurementProtocol.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::MeasurementProtocol;
+
+namespace
+{
+	std::wstring Format(KeyId key)
+	{
+		wchar_t name[MaxKeyLength];
+		return std::wstring(name, FormatKey(key, name));
+	}
+
+	KeyId Parse(const std::wstring& name)
+	{
+		return ParseKey(name.data(), name.size());
+	}
+}
+
+TEST(MeasurementProtocol_KnowsCampaignAndTimingParameters)
+{
+	CHECK(Parse(L"dl") == MakeKey(Parameter::DocumentLocation));
+	CHECK(Parse(L"cm") == MakeKey(Parameter::CampaignMedium));
+	CHECK(Parse(L"gclid") == MakeKey(Parameter::GoogleAdsId));
+	CHECK(Parse(L"plt") == MakeKey(Parameter::PageLoadTime));
+	CHECK(Parse(L"clt") == MakeKey(Parameter::ContentLoadTime));
+	CHECK(GetValueType(MakeKey(Parameter::DnsTime)) == ValueType::Integer);
+	CHECK_EQUAL((size_t)50, GetMaxValueLength(MakeKey(Parameter::CampaignMedium)));
+
+	// the custom metric family shares the cm prefix
+	CHECK(Parse(L"cm3") == MakeKey(IndexedParameter::CustomMetric, 3));
+}
+
+TEST(MeasurementProtocol_RoundTripsIndexedFamilies)
+{
+	const wchar_t* names[] = { L"cd7", L"pr2cd9", L"promo1nm", L"cg5", L"il3nm", L"il3pi12id", L"il200pi200ps" };
+	for (const wchar_t* name : names)
+	{
+		KeyId key = Parse(name);
+		CHECK(IsIndexed(key));
+		CHECK(IsValid(key));
+		CHECK(Format(key) == name);
+	}
+	CHECK(Parse(L"il1pi2pr") == MakeKey(IndexedParameter::ImpressionPrice, 1, 2));
+	CHECK(!IsValid(Parse(L"cg6")));
+	CHECK(Parse(L"il1pi2") == UnknownKey);
+	CHECK(Parse(L"il1pi2cd3") == UnknownKey);
+}
@@ -0,0 +1,111 @@
+//
+// PayloadEncoderBenchmarks.cpp
+// Compares the allocations of encoding a hit with PayloadEncoder against the map copy and string concatenation it replaced.
+//
+
+#include <cwchar>
+#include <string>
+#include <unordered_map>
+#include "BenchmarkHarness.h"
+#include "HitRecord.h"
+#include "PayloadEncoder.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::Benchmarks;
+
+namespace
+{
+	struct Parameter
+	{
+		const wchar_t* Key;
+		const wchar_t* Value;
+	};
+
+	// an event hit as a tracker sends it, with a few custom dimensions
+	const Parameter EventHit[] =
+	{
+		{ L"v", L"1" }, { L"tid", L"UA-12345-1" }, { L"cid", L"35009a79-1a05-49d7-b876-2b884d0f825b" }, { L"t", L"event" },
+		{ L"an", L"Sample App" }, { L"av", L"1.0.0.0" }, { L"ul", L"en-us" }, { L"sr", L"1920x1080" }, { L"vp", L"1280x720" },
+		{ L"cd", L"Main Page" }, { L"ec", L"Video" }, { L"ea", L"Play" }, { L"el", L"Holiday trailer (2 min)" }, { L"ev", L"42" },
+		{ L"cd1", L"premium" }, { L"cd2", L"A/B group 7" }, { L"cm1", L"3" },
+	};
+
+	HitRecord MakeRecord()
+	{
+		HitRecord record;
+		for (auto& parameter : EventHit)
+		{
+			record.Set(parameter.Key, std::wcslen(parameter.Key), parameter.Value, std::wcslen(parameter.Value));
+		}
+		return record;
+	}
+
+	// stands in for Uri::EscapeComponent, which returned a new string per value
+	std::wstring Escape(const std::wstring& value)
+	{
+		static const wchar_t HexDigits[] = L"0123456789ABCDEF";
+		std::wstring escaped;
+		for (wchar_t c : value)
+		{
+			if ((c >= L'A' && c <= L'Z') || (c >= L'a' && c <= L'z') || (c >= L'0' && c <= L'9') || c == L'-' || c == L'.' || c == L'_' || c == L'~')
+			{
+				escaped += c;
+			}
+			else
+			{
+				escaped += L'%';
+				escaped += HexDigits[(c >> 4) & 0xF];
+				escaped += HexDigits[c & 0xF];
+			}
+		}
+		return escaped;
+	}
+}
+
+BENCHMARK(PayloadEncoder_MapCopyAndConcatenation)
+{
+	// what dispatching did before: copy the hit into a map, add qt and z to the copy, then concatenate key=escaped value pairs
+	std::unordered_map<std::wstring, std::wstring> data;
+	for (auto& parameter : EventHit)
+	{
+		data[parameter.Key] = parameter.Value;
+	}
+	for (size_t i = 0; i < iterations; i++)
+	{
+		std::unordered_map<std::wstring, std::wstring> copy(data);
+		copy[L"qt"] = std::to_wstring(1500 + i);
+		copy[L"z"] = std::to_wstring(i);
+		std::wstring body;
+		for (auto& kvp : copy)
+		{
+			if (!body.empty()) body += L"&";
+			body += kvp.first + L"=" + Escape(kvp.second);
+		}
+		KeepAlive(body.data());
+	}
+}
+
+BENCHMARK(PayloadEncoder_EncodeFromRecord)
+{
+	HitRecord record = MakeRecord();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		long long queueTime = 1500 + (long long)i;
+		long long cacheBuster = (long long)i;
+		size_t length = 0;
+		record.ForEach([&](const wchar_t*, size_t keyLength, const wchar_t* value, size_t valueLength) {
+			length += PayloadEncoder::EncodedLength(keyLength, value, valueLength);
+		});
+		length += PayloadEncoder::EncodedLength(2, queueTime) + PayloadEncoder::EncodedLength(1, cacheBuster);
+
+		std::string payload;
+		PayloadEncoder encoder(payload);
+		encoder.Reserve(PayloadEncoder::PayloadLength(length));
+		record.ForEach([&](const wchar_t* key, size_t keyLength, const wchar_t* value, size_t valueLength) {
+			encoder.Append(key, keyLength, value, valueLength);
+		});
+		encoder.Append(L"qt", 2, queueTime);
+		encoder.Append(L"z", 1, cacheBuster);
+		KeepAlive(payload.data());
+	}
+}
@@ -0,0 +1,171 @@
+//
+// PayloadEncoderTests.cpp
+// Tests of payload encoding and of the lengths used to size payloads against the Measurement Protocol limits.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "PayloadEncoder.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	std::string Encode(const std::wstring& value)
+	{
+		std::string payload;
+		PayloadEncoder encoder(payload);
+		encoder.Append(L"k", 1, value.data(), value.size());
+		return payload;
+	}
+
+	std::wstring Surrogates(unsigned long c)
+	{
+		std::wstring text;
+		if (sizeof(wchar_t) > 2)
+		{
+			text += (wchar_t)c;
+		}
+		else
+		{
+			c -= 0x10000;
+			text += (wchar_t)(0xD800 + (c >> 10));
+			text += (wchar_t)(0xDC00 + (c & 0x3FF));
+		}
+		return text;
+	}
+}
+
+TEST(PayloadEncoder_LeavesUnreservedCharacters)
+{
+	CHECK(Encode(L"AZaz09-._~") == "k=AZaz09-._~");
+}
+
+TEST(PayloadEncoder_PercentEncodesUtf8)
+{
+	CHECK(Encode(L"a b&c=d/") == "k=a%20b%26c%3Dd%2F");
+	CHECK(Encode(L"é") == "k=%C3%A9");
+	CHECK(Encode(L"€") == "k=%E2%82%AC");
+	CHECK(Encode(Surrogates(0x1F600)) == "k=%F0%9F%98%80");
+}
+
+TEST(PayloadEncoder_ReplacesLoneSurrogates)
+{
+	std::wstring value(1, (wchar_t)0xD800);
+	CHECK(Encode(value) == "k=%EF%BF%BD");
+}
+
+TEST(PayloadEncoder_SeparatesPairsAndHits)
+{
+	std::string payload;
+	PayloadEncoder encoder(payload);
+	encoder.Append(L"v", 1, L"1", 1);
+	encoder.Append(L"t", 1, L"event", 5);
+	encoder.Append(L"qt", 2, 1500LL);
+	CHECK(payload == "v=1&t=event&qt=1500");
+	// the next hit of a batch starts after a newline, without a separator
+	payload += '\n';
+	encoder.Append(L"v", 1, L"1", 1);
+	encoder.Append(L"ev", 2, -42LL);
+	CHECK(payload == "v=1&t=event&qt=1500\nv=1&ev=-42");
+}
+
+TEST(PayloadEncoder_EncodedLengthMatchesOutput)
+{
+	const std::wstring values[] = { L"", L"plain", L"with space", L"é€", Surrogates(0x10348) + L"x", std::wstring(1, (wchar_t)0xDC00) };
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		std::string payload;
+		PayloadEncoder encoder(payload);
+		encoder.Append(L"dp", 2, values[i].data(), values[i].size());
+		CHECK_EQUAL(payload.size() - 3, PayloadEncoder::EncodedLength(values[i].data(), values[i].size()));
+	}
+	const long long numbers[] = { 0, 7, -7, 10, 9999999999LL, -9223372036854775807LL - 1 };
+	for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+	{
+		std::string payload = "x";
+		PayloadEncoder encoder(payload);
+		encoder.Append(L"qt", 2, numbers[i]);
+		// with a separator, since the payload was not empty
+		CHECK_EQUAL(payload.size() - 1, PayloadEncoder::EncodedLength(2, numbers[i]));
+	}
+}
+
+namespace
+{
+	struct Pair
+	{
+		std::wstring Key;
+		std::wstring Value;
+	};
+
+	size_t PayloadLength(const std::vector<Pair>& pairs, size_t cap)
+	{
+		size_t length = 0;
+		for (auto it = pairs.begin(); it != pairs.end(); ++it)
+		{
+			length += PayloadEncoder::EncodedLength(it->Key.size(), it->Value.data(), PayloadEncoder::TruncatedLength(it->Value.data(), it->Value.size(), cap));
+		}
+		return PayloadEncoder::PayloadLength(length);
+	}
+
+	std::string Encode(const std::vector<Pair>& pairs, size_t cap)
+	{
+		std::string payload;
+		PayloadEncoder encoder(payload);
+		for (auto it = pairs.begin(); it != pairs.end(); ++it)
+		{
+			encoder.Append(it->Key.data(), it->Key.size(), it->Value.data(), PayloadEncoder::TruncatedLength(it->Value.data(), it->Value.size(), cap));
+		}
+		return payload;
+	}
+
+	// v=1&t=event&dp= and a value of the given length
+	std::vector<Pair> HitOfLength(size_t valueLength)
+	{
+		std::vector<Pair> pairs;
+		pairs.push_back(Pair{ L"v", L"1" });
+		pairs.push_back(Pair{ L"t", L"event" });
+		pairs.push_back(Pair{ L"dp", std::wstring(valueLength, L'a') });
+		return pairs;
+	}
+}
+
+TEST(PayloadEncoder_PayloadLengthCountsSeparatorsBetweenPairs)
+{
+	CHECK_EQUAL((size_t)0, PayloadLength(std::vector<Pair>(), SIZE_MAX));
+	auto pairs = HitOfLength(4);
+	CHECK_EQUAL(Encode(pairs, SIZE_MAX).size(), PayloadLength(pairs, SIZE_MAX));
+}
+
+TEST(PayloadEncoder_FitsPayloadOfExactlyTheLimit)
+{
+	const size_t limit = 8192;
+	auto pairs = HitOfLength(limit - 15);
+	CHECK_EQUAL(limit, PayloadLength(pairs, SIZE_MAX));
+	CHECK_EQUAL(limit, Encode(pairs, SIZE_MAX).size());
+
+	// one byte over: the value is cut by one character
+	pairs = HitOfLength(limit - 14);
+	CHECK(PayloadLength(pairs, SIZE_MAX) > limit);
+	size_t cap = SIZE_MAX;
+	CHECK(PayloadEncoder::FitValueLength([&](size_t c) { return PayloadLength(pairs, c); }, limit - 14, limit, cap));
+	CHECK_EQUAL(limit - 15, cap);
+	CHECK_EQUAL(limit, Encode(pairs, cap).size());
+
+	// nothing fits when the keys alone are too long
+	cap = SIZE_MAX;
+	CHECK(!PayloadEncoder::FitValueLength([&](size_t c) { return PayloadLength(pairs, c); }, limit - 14, 8, cap));
+}
+
+TEST(PayloadEncoder_TruncatesWithoutSplittingSurrogatePairs)
+{
+	std::wstring value = L"ab";
+	value += (wchar_t)0xD83D;
+	value += (wchar_t)0xDE00;
+	CHECK_EQUAL((size_t)2, PayloadEncoder::TruncatedLength(value.data(), value.size(), 3));
+	CHECK_EQUAL((size_t)4, PayloadEncoder::TruncatedLength(value.data(), value.size(), 4));
+	CHECK_EQUAL((size_t)4, PayloadEncoder::TruncatedLength(value.data(), value.size(), 10));
+}
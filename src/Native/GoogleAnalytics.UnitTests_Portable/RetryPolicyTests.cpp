@@ -0,0 +1,181 @@
+//
+// RetryPolicyTests.cpp
+// Tests of RetryPolicy backoff, expiry and circuit breaking, driven by an injected clock and source of jitter.
+//
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "TestHarness.h"
+#include "RetryPolicy.h"
+
+using namespace GoogleAnalytics;
+using namespace std::chrono;
+
+namespace
+{
+	typedef RetryPolicy::Clock Clock;
+
+	struct ManualRandom
+	{
+		std::shared_ptr<double> Value = std::make_shared<double>(1.0);
+
+		RetryPolicy::Random Get() const
+		{
+			auto value = Value;
+			return [value]() { return *value; };
+		}
+	};
+}
+
+TEST(RetryPolicy_DoublesCeilingUpToMaxDelay)
+{
+	ManualRandom random;
+	RetryPolicy policy(seconds(2), minutes(5), 3, seconds(60), random.Get());
+	// the largest jitter gives the ceiling itself
+	CHECK(policy.GetBackoff(0) == Clock::duration(seconds(2)));
+	CHECK(policy.GetBackoff(1) == Clock::duration(seconds(4)));
+	CHECK(policy.GetBackoff(4) == Clock::duration(seconds(32)));
+	CHECK(policy.GetBackoff(7) == Clock::duration(seconds(256)));
+	CHECK(policy.GetBackoff(8) == Clock::duration(minutes(5)));
+	CHECK(policy.GetBackoff(1000) == Clock::duration(minutes(5)));
+}
+
+TEST(RetryPolicy_JittersOverTheFullRange)
+{
+	ManualRandom random;
+	RetryPolicy policy(seconds(2), minutes(5), 3, seconds(60), random.Get());
+	*random.Value = 0;
+	CHECK(policy.GetBackoff(3) == Clock::duration::zero());
+	*random.Value = 0.5;
+	CHECK(policy.GetBackoff(3) == Clock::duration(seconds(8)));
+	// out of range values are clamped
+	*random.Value = 7;
+	CHECK(policy.GetBackoff(3) == Clock::duration(seconds(16)));
+	*random.Value = -1;
+	CHECK(policy.GetBackoff(3) == Clock::duration::zero());
+}
+
+TEST(RetryPolicy_DefaultJitterStaysWithinCeiling)
+{
+	RetryPolicy policy(seconds(2), minutes(5));
+	bool isBelowHalf = false;
+	bool isAboveHalf = false;
+	for (int i = 0; i < 1000; i++)
+	{
+		auto backoff = policy.GetBackoff(2);
+		CHECK(backoff >= Clock::duration::zero());
+		CHECK(backoff <= Clock::duration(seconds(8)));
+		isBelowHalf |= backoff < Clock::duration(seconds(4));
+		isAboveHalf |= backoff > Clock::duration(seconds(4));
+	}
+	CHECK(isBelowHalf);
+	CHECK(isAboveHalf);
+}
+
+TEST(RetryPolicy_ExpiresHitsAfterFourHours)
+{
+	RetryPolicy policy;
+	CHECK(!policy.IsExpired(Clock::duration::zero()));
+	CHECK(!policy.IsExpired(hours(4) - milliseconds(1)));
+	CHECK(policy.IsExpired(hours(4)));
+	CHECK(policy.IsExpired(hours(5)));
+}
+
+TEST(RetryPolicy_OpensHalfOpensAndClosesCircuit)
+{
+	ManualRandom random;
+	RetryPolicy policy(seconds(2), minutes(5), 3, seconds(60), random.Get());
+	Clock::time_point now;
+
+	CHECK(!policy.RecordFailure(now));
+	CHECK(!policy.RecordFailure(now));
+	CHECK(policy.GetState(now) == RetryPolicy::CircuitState::Closed);
+	// the third failure in a row opens the circuit for the break duration
+	CHECK(policy.RecordFailure(now));
+	CHECK(policy.GetOpenUntil() == now + seconds(60));
+	CHECK(policy.GetState(now + seconds(59)) == RetryPolicy::CircuitState::Open);
+	CHECK(policy.GetState(now + seconds(60)) == RetryPolicy::CircuitState::HalfOpen);
+
+	// a failed probe reopens it straight away
+	now += seconds(60);
+	CHECK(policy.RecordFailure(now));
+	CHECK(policy.GetState(now) == RetryPolicy::CircuitState::Open);
+	CHECK(policy.GetState(now + seconds(60)) == RetryPolicy::CircuitState::HalfOpen);
+
+	// a successful probe closes it and forgets the failures
+	policy.RecordSuccess();
+	CHECK(policy.GetState(now + seconds(60)) == RetryPolicy::CircuitState::Closed);
+	CHECK(!policy.RecordFailure(now));
+	CHECK(!policy.RecordFailure(now));
+}
+
+TEST(RetryPolicy_SuccessResetsFailureCount)
+{
+	ManualRandom random;
+	RetryPolicy policy(seconds(2), minutes(5), 3, seconds(60), random.Get());
+	Clock::time_point now;
+	for (int i = 0; i < 10; i++)
+	{
+		CHECK(!policy.RecordFailure(now));
+		CHECK(!policy.RecordFailure(now));
+		policy.RecordSuccess();
+	}
+	CHECK(policy.GetState(now) == RetryPolicy::CircuitState::Closed);
+}
+
+TEST(RetryPolicy_RecoversFromInjectedOutage)
+{
+	// a collector that drops every request for the first 10 minutes, then answers; hits are tried as the dispatcher would
+	ManualRandom random;
+	*random.Value = 0.5;
+	RetryPolicy policy(seconds(2), minutes(5), 3, seconds(60), random.Get());
+	auto start = Clock::time_point() + hours(1);
+	auto outageEnd = start + minutes(10);
+
+	struct PendingHit
+	{
+		unsigned int Attempts;
+		Clock::time_point NotBefore;
+		bool IsSent;
+	};
+	std::vector<PendingHit> hits(5, PendingHit{ 0, start, false });
+
+	int failedRequests = 0;
+	int opened = 0;
+	auto now = start;
+	while (now < start + hours(1))
+	{
+		auto state = policy.GetState(now);
+		bool isProbeSent = false;
+		for (auto& hit : hits)
+		{
+			if (hit.IsSent || hit.NotBefore > now || state == RetryPolicy::CircuitState::Open) continue;
+			// a half open circuit lets a single hit through
+			if (state == RetryPolicy::CircuitState::HalfOpen && isProbeSent) continue;
+			isProbeSent = true;
+			if (now < outageEnd)
+			{
+				failedRequests++;
+				if (policy.RecordFailure(now)) opened++;
+				hit.NotBefore = now + policy.GetBackoff(hit.Attempts++);
+			}
+			else
+			{
+				policy.RecordSuccess();
+				hit.IsSent = true;
+			}
+			state = policy.GetState(now);
+		}
+		now += seconds(1);
+	}
+
+	for (auto& hit : hits)
+	{
+		CHECK(hit.IsSent);
+	}
+	CHECK(policy.GetState(now) == RetryPolicy::CircuitState::Closed);
+	// the breaker kept the outage to a handful of requests: three failures in a row open it, then a single probe goes out per break
+	CHECK_EQUAL(1 + 9, opened);
+	CHECK_EQUAL(3 + 9, failedRequests);
+}
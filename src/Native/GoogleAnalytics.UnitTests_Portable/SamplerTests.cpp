@@ -0,0 +1,127 @@
+//
+// SamplerTests.cpp
+// Tests of the Sampler hash, client buckets and sample rates.
+//
+
+#include <cstring>
+#include <cwchar>
+#include "TestHarness.h"
+#include "Sampler.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const wchar_t ClientId[] = L"35009a79-1a05-49d7-b876-2b884d0f825b";
+
+	const wchar_t OtherClientId[] = L"555";
+
+	// the buckets of ClientId and OtherClientId, from a reference MurmurHash3 of their UTF-16LE bytes
+	const int ClientBucket = 5611;
+
+	const int OtherClientBucket = 600;
+
+	uint32_t Hash(const char* text, uint32_t seed)
+	{
+		return Sampler::Hash(text, std::strlen(text), seed);
+	}
+
+	bool IsSampledIn(const Sampler& sampler, const wchar_t* hitType)
+	{
+		return sampler.IsSampledIn(hitType, hitType ? std::wcslen(hitType) : 0);
+	}
+}
+
+TEST(Sampler_HashMatchesKnownAnswers)
+{
+	// the MurmurHash3_x86_32 verification values, which exercise every tail length and the seed
+	CHECK_EQUAL(0x00000000u, Hash("", 0));
+	CHECK_EQUAL(0x514E28B7u, Hash("", 1));
+	CHECK_EQUAL(0x81F16F39u, Hash("", 0xFFFFFFFF));
+	const char zeros[4] = { 0, 0, 0, 0 };
+	CHECK_EQUAL(0x2362F9DEu, Sampler::Hash(zeros, 4, 0));
+	CHECK_EQUAL(0x7FA09EA6u, Hash("a", 0x9747B28C));
+	CHECK_EQUAL(0xC84A62DDu, Hash("abc", 0x9747B28C));
+	CHECK_EQUAL(0xF0478627u, Hash("abcd", 0x9747B28C));
+	CHECK_EQUAL(0x24884CBAu, Hash("Hello, world!", 0x9747B28C));
+	CHECK_EQUAL(0x2FA826CDu, Hash("The quick brown fox jumps over the lazy dog", 0x9747B28C));
+	CHECK_EQUAL(0x2E4FF723u, Hash("The quick brown fox jumps over the lazy dog", 0));
+}
+
+TEST(Sampler_BucketsUtf16LittleEndianCodeUnits)
+{
+	// the same on every platform, whatever the size of wchar_t
+	CHECK_EQUAL(ClientBucket, Sampler::GetBucket(ClientId, std::wcslen(ClientId)));
+	CHECK_EQUAL(OtherClientBucket, Sampler::GetBucket(OtherClientId, std::wcslen(OtherClientId)));
+	CHECK_EQUAL((int)(Sampler::Hash("5\0" "5\0" "5\0", 6) % Sampler::BucketCount), OtherClientBucket);
+}
+
+TEST(Sampler_KeepsHitsOfClientsBelowTheRate)
+{
+	Sampler sampler;
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	sampler.SetSampleRate(57.0F);
+	CHECK(IsSampledIn(sampler, L"event"));
+	sampler.SetSampleRate(56.0F);
+	CHECK(!IsSampledIn(sampler, L"event"));
+	CHECK_EQUAL(56.0F, sampler.GetSampleRate());
+}
+
+TEST(Sampler_RecomputesBucketWhenClientIdChanges)
+{
+	Sampler sampler;
+	sampler.SetSampleRate(10.0F);
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	CHECK(!IsSampledIn(sampler, L"screenview"));
+	sampler.SetClientId(OtherClientId, std::wcslen(OtherClientId));
+	CHECK(IsSampledIn(sampler, L"screenview"));
+	sampler.SetSampleRate(5.0F);
+	CHECK(!IsSampledIn(sampler, L"screenview"));
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	sampler.SetSampleRate(60.0F);
+	CHECK(IsSampledIn(sampler, L"screenview"));
+}
+
+TEST(Sampler_KeepsHitsWithoutClientIdUnlessRateIsZero)
+{
+	Sampler sampler;
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	sampler.SetClientId(nullptr, 0);
+	sampler.SetSampleRate(0.01F);
+	CHECK(IsSampledIn(sampler, L"event"));
+	sampler.SetSampleRate(0.0F);
+	CHECK(!IsSampledIn(sampler, L"event"));
+}
+
+TEST(Sampler_UnsetHitTypeRatesFallBackToSampleRate)
+{
+	Sampler sampler;
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	sampler.SetSampleRate(57.0F);
+	CHECK(!sampler.HasHitTypeSampleRates());
+
+	CHECK(sampler.SetHitTypeSampleRate(L"event", 5, 50.0F));
+	CHECK(sampler.HasHitTypeSampleRates());
+	CHECK(!IsSampledIn(sampler, L"event"));
+	// no rate of their own: the tracker wide one applies
+	CHECK(IsSampledIn(sampler, L"screenview"));
+	CHECK(IsSampledIn(sampler, L"custom"));
+	CHECK(IsSampledIn(sampler, nullptr));
+
+	// follows the tracker wide rate again once cleared
+	sampler.ClearHitTypeSampleRate(L"event", 5);
+	CHECK(IsSampledIn(sampler, L"event"));
+	sampler.SetSampleRate(50.0F);
+	CHECK(!IsSampledIn(sampler, L"event"));
+}
+
+TEST(Sampler_HitTypeRateOverridesSampleRate)
+{
+	Sampler sampler;
+	sampler.SetClientId(ClientId, std::wcslen(ClientId));
+	sampler.SetSampleRate(0.0F);
+	CHECK(sampler.SetHitTypeSampleRate(L"exception", 9, 100.0F));
+	CHECK(IsSampledIn(sampler, L"exception"));
+	CHECK(!IsSampledIn(sampler, L"event"));
+	CHECK(!sampler.SetHitTypeSampleRate(L"custom", 6, 100.0F));
+}
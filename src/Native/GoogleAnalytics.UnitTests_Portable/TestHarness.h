@@ -0,0 +1,47 @@
+//
+// TestHarness.h
+// Declaration of the minimal test registry and assertions used by the portable unit tests.
+//
+
+#pragma once
+
+#include <vector>
+
+namespace GoogleAnalytics
+{
+	namespace Tests
+	{
+		struct TestCase
+		{
+			const char* Name;
+			void (*Run)();
+		};
+
+		std::vector<TestCase>& GetTests();
+
+		void Fail(const char* file, int line, const char* expression);
+
+		struct Registration
+		{
+			Registration(const char* name, void (*run)())
+			{
+				TestCase test = { name, run };
+				GetTests().push_back(test);
+			}
+		};
+	}
+}
+
+/// <summary>
+/// Defines a test. Tests are named Suite_Behavior; running the test executable with a suite name only runs that suite.
+/// </summary>
+#define TEST(name) \
+	static void name(); \
+	static GoogleAnalytics::Tests::Registration name##_Registration(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) GoogleAnalytics::Tests::Fail(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { if (!((expected) == (actual))) GoogleAnalytics::Tests::Fail(__FILE__, __LINE__, #expected " == " #actual); } while (0)
@@ -0,0 +1,51 @@
+//
+// TestMain.cpp
+// Runs the registered tests, or those of the suite named on the command line.
+//
+
+#include <cstdio>
+#include <cstring>
+#include "TestHarness.h"
+
+using namespace GoogleAnalytics::Tests;
+
+namespace
+{
+	int failures = 0;
+}
+
+std::vector<TestCase>& GoogleAnalytics::Tests::GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void GoogleAnalytics::Tests::Fail(const char* file, int line, const char* expression)
+{
+	std::printf("%s(%d): check failed: %s\n", file, line, expression);
+	failures++;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* suite = argc > 1 ? argv[1] : nullptr;
+	size_t suiteLength = suite ? std::strlen(suite) : 0;
+	int run = 0;
+	int failed = 0;
+	auto& tests = GetTests();
+	for (auto it = tests.begin(); it != tests.end(); ++it)
+	{
+		// Suite_Behavior
+		if (suite && (std::strncmp(it->Name, suite, suiteLength) != 0 || it->Name[suiteLength] != '_')) continue;
+		int before = failures;
+		it->Run();
+		run++;
+		if (failures != before)
+		{
+			failed++;
+			std::printf("FAILED %s\n", it->Name);
+		}
+	}
+	std::printf("%d tests, %d failed\n", run, failed);
+	return run == 0 || failed != 0 ? 1 : 0;
+}
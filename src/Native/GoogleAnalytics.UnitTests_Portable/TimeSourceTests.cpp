@@ -0,0 +1,112 @@
+//
+// TimeSourceTests.cpp
+// Tests of the TimeSource wall clock against the system clock, across anchor refreshes, and of monotonic queue time deltas.
+//
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "TimeSource.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	typedef std::chrono::duration<long long, std::ratio<1, 10000000>> Ticks;
+
+	const long long TicksPerMillisecond = 10000;
+
+	// generous enough for a loaded build machine; a torn anchor read is off by up to the anchor's age, about a second
+	const long long Tolerance = 50 * TicksPerMillisecond;
+
+	long long SystemTicks()
+	{
+		return std::chrono::duration_cast<Ticks>(std::chrono::system_clock::now().time_since_epoch()).count() + TimeSource::UnixEpochTicks;
+	}
+
+	// checks that a TimeSource reading falls between two system clock readings taken around it, within Tolerance
+	bool IsBetween(long long before, long long reading, long long after)
+	{
+		return reading >= before - Tolerance && reading <= after + Tolerance;
+	}
+}
+
+TEST(TimeSource_UniversalNowTracksSystemClock)
+{
+	for (int i = 0; i < 10000; i++)
+	{
+		auto before = SystemTicks();
+		auto reading = TimeSource::UniversalNow();
+		auto after = SystemTicks();
+		CHECK(IsBetween(before, reading, after));
+	}
+}
+
+TEST(TimeSource_StaysAccurateAcrossAnchorRefreshes)
+{
+	// readers on several threads for longer than the one second refresh interval, so the anchor is replaced while they read it
+	const int ReaderCount = 4;
+	auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(1200);
+	std::atomic<int> misses(0);
+	std::atomic<long long> reads(0);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < ReaderCount; r++)
+	{
+		readers.push_back(std::thread([&]() {
+			long long count = 0;
+			while (std::chrono::steady_clock::now() < until)
+			{
+				auto before = SystemTicks();
+				auto reading = TimeSource::UniversalNow();
+				auto after = SystemTicks();
+				if (!IsBetween(before, reading, after)) misses++;
+				count++;
+			}
+			reads += count;
+		}));
+	}
+	for (auto it = readers.begin(); it != readers.end(); ++it)
+	{
+		it->join();
+	}
+	CHECK_EQUAL(0, misses.load());
+	CHECK(reads.load() > 0);
+}
+
+TEST(TimeSource_MonotonicNowNeverGoesBackwards)
+{
+	auto previous = TimeSource::MonotonicNow();
+	for (int i = 0; i < 100000; i++)
+	{
+		auto now = TimeSource::MonotonicNow();
+		CHECK(now >= previous);
+		previous = now;
+	}
+}
+
+TEST(TimeSource_MonotonicDeltasGiveQueueTime)
+{
+	// queue time is the monotonic age of a hit in 100 nanosecond ticks, divided down to milliseconds
+	auto started = std::chrono::steady_clock::now();
+	auto created = TimeSource::MonotonicNow();
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	auto age = (TimeSource::MonotonicNow() - created) / 100;
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+	auto queueTime = age / TicksPerMillisecond;
+	CHECK(queueTime >= 30);
+	CHECK(queueTime <= elapsed);
+}
+
+TEST(TimeSource_WallClockAgeAgreesWithMonotonicAge)
+{
+	// hits restored from the persistent queue have no monotonic time stamp and fall back to wall clock ages
+	auto createdMonotonic = TimeSource::MonotonicNow();
+	auto createdUniversal = TimeSource::UniversalNow();
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	auto monotonicAge = (TimeSource::MonotonicNow() - createdMonotonic) / 100;
+	auto universalAge = TimeSource::UniversalNow() - createdUniversal;
+	auto difference = monotonicAge > universalAge ? monotonicAge - universalAge : universalAge - monotonicAge;
+	CHECK(difference < Tolerance);
+}
@@ -0,0 +1,90 @@
+//
+// TokenBucketBenchmarks.cpp
+// Compares admitting a dispatch round through the token bucket one hit at a time with admitting it in one call.
+//
+
+#include <thread>
+#include <vector>
+#include "BenchmarkHarness.h"
+#include "TokenBucket.h"
+
+using namespace GoogleAnalytics;
+using namespace GoogleAnalytics::Benchmarks;
+
+namespace
+{
+	// hits in a dispatch round
+	const size_t RoundSize = 20;
+
+	const int ThreadCount = 4;
+
+	// a bucket that never runs dry during a run, so every call does the full clock read and compare and swap
+	const double Capacity = 1e9;
+	const double FillRate = 1e9;
+
+	size_t ConsumePerHit(TokenBucket& bucket)
+	{
+		size_t admitted = 0;
+		for (size_t i = 0; i < RoundSize; i++)
+		{
+			if (bucket.Consume()) admitted++;
+		}
+		return admitted;
+	}
+
+	// runs ThreadCount threads admitting their share of iterations rounds through one bucket
+	template <typename Admit>
+	void RunContended(size_t iterations, Admit admit)
+	{
+		TokenBucket bucket(Capacity, FillRate);
+		size_t share = iterations / ThreadCount + 1;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < ThreadCount; t++)
+		{
+			threads.push_back(std::thread([&bucket, &admit, share]() {
+				size_t admitted = 0;
+				for (size_t i = 0; i < share; i++)
+				{
+					admitted += admit(bucket);
+				}
+				KeepAlive(&admitted);
+			}));
+		}
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+		{
+			it->join();
+		}
+	}
+}
+
+BENCHMARK(TokenBucket_ConsumePerHit)
+{
+	TokenBucket bucket(Capacity, FillRate);
+	size_t admitted = 0;
+	for (size_t i = 0; i < iterations; i++)
+	{
+		admitted += ConsumePerHit(bucket);
+	}
+	KeepAlive(&admitted);
+}
+
+BENCHMARK(TokenBucket_TryConsumeRound)
+{
+	TokenBucket bucket(Capacity, FillRate);
+	size_t admitted = 0;
+	for (size_t i = 0; i < iterations; i++)
+	{
+		admitted += bucket.TryConsumeN(RoundSize);
+	}
+	KeepAlive(&admitted);
+}
+
+BENCHMARK(TokenBucket_ConsumePerHitContended)
+{
+	RunContended(iterations, [](TokenBucket& bucket) { return ConsumePerHit(bucket); });
+}
+
+BENCHMARK(TokenBucket_TryConsumeRoundContended)
+{
+	RunContended(iterations, [](TokenBucket& bucket) { return bucket.TryConsumeN(RoundSize); });
+}
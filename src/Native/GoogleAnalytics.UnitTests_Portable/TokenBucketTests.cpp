@@ -0,0 +1,98 @@
+//
+// TokenBucketTests.cpp
+// Tests of TokenBucket timing, driven by an injected clock.
+//
+
+#include <memory>
+#include "TestHarness.h"
+#include "TokenBucket.h"
+
+using namespace GoogleAnalytics;
+
+namespace
+{
+	const long long Second = 1000000000LL;
+
+	struct ManualClock
+	{
+		std::shared_ptr<long long> Now = std::make_shared<long long>(1000 * Second);
+
+		TokenBucket::Clock Get() const
+		{
+			auto now = Now;
+			return [now]() { return *now; };
+		}
+
+		void Advance(long long nanoseconds)
+		{
+			*Now += nanoseconds;
+		}
+	};
+}
+
+TEST(TokenBucket_StartsFull)
+{
+	ManualClock clock;
+	TokenBucket bucket(5, 1, clock.Get());
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK(bucket.Consume());
+	}
+	CHECK(!bucket.Consume());
+}
+
+TEST(TokenBucket_RefillsAtFillRate)
+{
+	ManualClock clock;
+	TokenBucket bucket(2, 4, clock.Get());
+	CHECK_EQUAL(2u, bucket.TryConsumeN(2));
+	// one token every quarter of a second
+	clock.Advance(Second / 4 - 1);
+	CHECK(!bucket.Consume());
+	clock.Advance(1);
+	CHECK(bucket.Consume());
+	CHECK(!bucket.Consume());
+	clock.Advance(Second / 2);
+	CHECK_EQUAL(2u, bucket.TryConsumeN(5));
+}
+
+TEST(TokenBucket_DoesNotBankBeyondCapacity)
+{
+	ManualClock clock;
+	TokenBucket bucket(3, 10, clock.Get());
+	bucket.TryConsumeN(3);
+	clock.Advance(3600 * Second);
+	CHECK_EQUAL(3u, bucket.TryConsumeN(100));
+	CHECK(!bucket.Consume());
+}
+
+TEST(TokenBucket_GrantsPartOfRound)
+{
+	ManualClock clock;
+	TokenBucket bucket(10, 1, clock.Get());
+	CHECK_EQUAL(10u, bucket.TryConsumeN(25));
+	CHECK_EQUAL(0u, bucket.TryConsumeN(25));
+	clock.Advance(3 * Second);
+	CHECK_EQUAL(3u, bucket.TryConsumeN(25));
+	CHECK_EQUAL(0u, bucket.TryConsumeN(0));
+}
+
+TEST(TokenBucket_AppliesNewFillRate)
+{
+	ManualClock clock;
+	TokenBucket bucket(1, 1, clock.Get());
+	CHECK(bucket.Consume());
+	bucket.SetFillRate(10);
+	CHECK(bucket.GetFillRate() > 9.99 && bucket.GetFillRate() < 10.01);
+	clock.Advance(Second / 10);
+	CHECK(bucket.Consume());
+}
+
+TEST(TokenBucket_AppliesNewCapacity)
+{
+	ManualClock clock;
+	TokenBucket bucket(2, 1, clock.Get());
+	bucket.SetCapacity(6);
+	clock.Advance(10 * Second);
+	CHECK_EQUAL(6u, bucket.TryConsumeN(10));
+}
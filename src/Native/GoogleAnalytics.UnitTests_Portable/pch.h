@@ -0,0 +1,6 @@
+//
+// pch.h
+// Stands in for the precompiled header of GoogleAnalytics.UWP, without the Windows Runtime headers.
+//
+
+#pragma once